@@ -3,7 +3,7 @@
 #include <boost/tokenizer.hpp>
 
 #include <fstream>
-#include <cassert>
+#include <stdexcept>
 #include <vector>
 
 namespace te {
@@ -13,7 +13,9 @@ Animation_csv::Animation_csv(const std::string& filename)
 	, delay_unit{ 60 }
 {
 	std::ifstream in{ filename.c_str() };
-	assert(in.is_open());
+	if (!in.is_open()) {
+		throw std::runtime_error{ "Cannot open " + filename };
+	}
 	std::string line{};
 
 	std::vector<std::string> tokens{};
@@ -21,13 +23,17 @@ Animation_csv::Animation_csv(const std::string& filename)
 	std::getline(in, line);
 	boost::tokenizer<boost::escaped_list_separator<char>> tokenizer{ line };
 	tokens.assign(tokenizer.begin(), tokenizer.end());
-	assert(tokens.size() == 2 && tokens[0] == "Delay(1/60)" && tokens[1] == "File Name");
+	if (tokens.size() != 2 || tokens[0] != "Delay(1/60)" || tokens[1] != "File Name") {
+		throw std::runtime_error{ filename + ": missing the Delay(1/60),File Name header" };
+	}
 	tokens.clear();
 
 	while (std::getline(in, line)) {
 		boost::tokenizer<boost::escaped_list_separator<char>> tokenizer{ line };
 		tokens.assign(tokenizer.begin(), tokenizer.end());
-		assert(tokens.size() == 2);
+		if (tokens.size() != 2) {
+			throw std::runtime_error{ filename + ": expected a delay and a file name on each line" };
+		}
 		frames.push_back({ std::stoi(tokens[0]), tokens[1] });
 	}
 }
@@ -20,6 +20,7 @@ struct Animation_csv {
 	std::vector<Frame> frames;
 	int delay_unit;
 
+	// Throws std::runtime_error for a file that is missing or malformed.
 	Animation_csv(const std::string& filename);
 };
 
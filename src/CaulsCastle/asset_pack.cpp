@@ -0,0 +1,587 @@
+#include "asset_pack.h"
+#include "game_data.h"
+#include "loaders.h"
+#include "records.h"
+#include "utilities.h"
+#include "profiler.h"
+
+#include <rapidxml.hpp>
+#include <rapidxml_utils.hpp>
+#include <boost/container/flat_map.hpp>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <fstream>
+#include <map>
+#include <vector>
+#include <utility>
+
+namespace te {
+
+namespace {
+
+const char pack_magic[4] = { 'C', 'C', 'A', 'P' };
+const std::uint32_t pack_version = 1;
+
+enum Section_index {
+	String_offsets_section,
+	String_data_section,
+	Sources_section,
+	Images_section,
+	Sprites_section,
+	Animations_section,
+	Frames_section,
+	Groups_section,
+	Group_types_section,
+	Colliders_section,
+	Section_count
+};
+
+// Strings are indices into the string table; every other field is a
+// fixed-size integer so records can be read straight from the mapping.
+struct Pack_section {
+	std::uint32_t offset;
+	std::uint32_t count;
+};
+
+struct Pack_header {
+	char magic[4];
+	std::uint32_t version;
+	Pack_section sections[Section_count];
+};
+
+struct Pack_source {
+	std::uint32_t path;
+	std::uint32_t padding;
+	std::int64_t modified_time;
+};
+
+struct Pack_image {
+	std::uint32_t filename;
+	std::int32_t width;
+	std::int32_t height;
+};
+
+struct Pack_sprite {
+	std::uint32_t filename;
+	std::uint32_t image_filename;
+	std::int32_t x;
+	std::int32_t y;
+	std::int32_t w;
+	std::int32_t h;
+	float px;
+	float py;
+	std::uint32_t first_collider;
+	std::uint32_t collider_count;
+};
+
+struct Pack_animation {
+	std::uint32_t filename;
+	std::uint32_t first_frame;
+	std::uint32_t frame_count;
+};
+
+struct Pack_frame {
+	std::uint32_t animation_filename;
+	std::uint32_t sprite_filename;
+	std::int32_t delay;
+	std::int32_t delay_unit;
+	std::uint32_t frame_index;
+};
+
+struct Pack_group {
+	std::uint32_t name;
+};
+
+struct Pack_group_type {
+	std::uint32_t group_name;
+	std::uint32_t type;
+	std::uint32_t animation_filename;
+};
+
+struct Pack_collider {
+	std::uint32_t image_name;
+	std::int32_t x;
+	std::int32_t y;
+	std::int32_t w;
+	std::int32_t h;
+};
+
+std::int64_t get_modified_time(const std::string& filename)
+{
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) {
+		return -1;
+	}
+	return static_cast<std::int64_t>(info.st_mtime);
+}
+
+// Every file load_image_data reads for `data_filename`.
+std::vector<std::string> get_sources(const std::string& data_filename)
+{
+	const auto dir = get_directory(data_filename);
+
+	rapidxml::file<> file{ data_filename.c_str() };
+	rapidxml::xml_document<> xml;
+	xml.parse<0>(file.data());
+	auto* p_root = xml.first_node("image_data");
+
+	std::vector<std::string> sources{ data_filename };
+	for (auto* p_atlas = p_root->first_node("atlases")->first_node("file"); p_atlas != NULL; p_atlas = p_atlas->next_sibling("file")) {
+		sources.push_back(dir + p_atlas->first_attribute("name")->value());
+	}
+	for (auto* p_animation = p_root->first_node("animations")->first_node("file"); p_animation != NULL; p_animation = p_animation->next_sibling("file")) {
+		sources.push_back(dir + p_animation->first_attribute("name")->value());
+	}
+	return sources;
+}
+
+class Mapped_file {
+public:
+	explicit Mapped_file(const std::string& filename)
+		: mp_data{ nullptr }
+		, m_size{ 0 }
+	{
+#ifdef _WIN32
+		m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		m_mapping = NULL;
+		LARGE_INTEGER size;
+		if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+			return;
+		}
+		m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_mapping == NULL) {
+			return;
+		}
+		mp_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		m_size = mp_data ? static_cast<size_t>(size.QuadPart) : 0;
+#else
+		const int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return;
+		}
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0) {
+			void* p = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				mp_data = static_cast<const char*>(p);
+				m_size = static_cast<size_t>(info.st_size);
+			}
+		}
+		close(fd);
+#endif
+	}
+
+	~Mapped_file()
+	{
+#ifdef _WIN32
+		if (mp_data) UnmapViewOfFile(mp_data);
+		if (m_mapping != NULL) CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#else
+		if (mp_data) munmap(const_cast<char*>(mp_data), m_size);
+#endif
+	}
+
+	Mapped_file(const Mapped_file&) = delete;
+	Mapped_file& operator=(const Mapped_file&) = delete;
+
+	const char* data() const noexcept { return mp_data; }
+	size_t size() const noexcept { return m_size; }
+private:
+	const char* mp_data;
+	size_t m_size;
+#ifdef _WIN32
+	HANDLE m_file;
+	HANDLE m_mapping;
+#endif
+};
+
+class Pack_writer {
+public:
+	Pack_writer()
+		: m_header{}
+		, m_string_ids{}
+		, m_string_offsets{ 0 }
+		, m_string_data{}
+		, m_sections(Section_count)
+	{
+		std::memcpy(m_header.magic, pack_magic, sizeof(pack_magic));
+		m_header.version = pack_version;
+	}
+
+	std::uint32_t intern(const std::string& s)
+	{
+		auto found = m_string_ids.find(s);
+		if (found != m_string_ids.end()) {
+			return found->second;
+		}
+		const auto id = static_cast<std::uint32_t>(m_string_offsets.size() - 1);
+		m_string_data.insert(m_string_data.end(), s.begin(), s.end());
+		m_string_offsets.push_back(static_cast<std::uint32_t>(m_string_data.size()));
+		m_string_ids.insert({ s, id });
+		return id;
+	}
+
+	template <typename Record>
+	void add(Section_index section, const Record& record)
+	{
+		auto& bytes = m_sections[section];
+		const auto* p = reinterpret_cast<const char*>(&record);
+		bytes.insert(bytes.end(), p, p + sizeof(Record));
+		++m_header.sections[section].count;
+	}
+
+	void write(const std::string& filename)
+	{
+		auto& offsets = m_sections[String_offsets_section];
+		const auto* p_offsets = reinterpret_cast<const char*>(m_string_offsets.data());
+		offsets.assign(p_offsets, p_offsets + m_string_offsets.size() * sizeof(std::uint32_t));
+		m_header.sections[String_offsets_section].count = static_cast<std::uint32_t>(m_string_offsets.size());
+		m_sections[String_data_section] = m_string_data;
+		m_header.sections[String_data_section].count = static_cast<std::uint32_t>(m_string_data.size());
+
+		// Sections start on 8-byte boundaries so records can be read in place.
+		size_t offset = align(sizeof(Pack_header));
+		for (size_t i = 0; i < Section_count; ++i) {
+			m_header.sections[i].offset = static_cast<std::uint32_t>(offset);
+			offset = align(offset + m_sections[i].size());
+		}
+
+		std::ofstream out{ filename, std::ios::binary | std::ios::trunc };
+		assert(out.is_open());
+		std::vector<char> padding(8, 0);
+		out.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+		out.write(padding.data(), align(sizeof(m_header)) - sizeof(m_header));
+		for (auto& bytes : m_sections) {
+			out.write(bytes.data(), bytes.size());
+			out.write(padding.data(), align(bytes.size()) - bytes.size());
+		}
+	}
+private:
+	static size_t align(size_t offset)
+	{
+		return (offset + 7) & ~size_t{ 7 };
+	}
+
+	Pack_header m_header;
+	std::map<std::string, std::uint32_t> m_string_ids;
+	std::vector<std::uint32_t> m_string_offsets;
+	std::vector<char> m_string_data;
+	std::vector<std::vector<char>> m_sections;
+};
+
+class Pack_reader {
+public:
+	explicit Pack_reader(const Mapped_file& file)
+		: m_file{ file }
+		, mp_header{ nullptr }
+	{
+		if (file.size() < sizeof(Pack_header)) {
+			return;
+		}
+		const auto* p_header = reinterpret_cast<const Pack_header*>(file.data());
+		if (std::memcmp(p_header->magic, pack_magic, sizeof(pack_magic)) != 0 || p_header->version != pack_version) {
+			return;
+		}
+		const size_t record_sizes[Section_count] = {
+			sizeof(std::uint32_t), 1, sizeof(Pack_source), sizeof(Pack_image), sizeof(Pack_sprite),
+			sizeof(Pack_animation), sizeof(Pack_frame), sizeof(Pack_group), sizeof(Pack_group_type), sizeof(Pack_collider)
+		};
+		for (size_t i = 0; i < Section_count; ++i) {
+			const auto& section = p_header->sections[i];
+			if (section.offset % 8 != 0 || section.offset > file.size() || section.count > (file.size() - section.offset) / record_sizes[i]) {
+				return;
+			}
+		}
+		mp_header = p_header;
+
+		// A corrupt pack is rejected here, like a stale one, rather than
+		// read out of bounds while loading.
+		if (!has_valid_strings() || !has_valid_records()) {
+			mp_header = nullptr;
+		}
+	}
+
+	bool is_valid() const noexcept
+	{
+		return mp_header != nullptr;
+	}
+
+	template <typename Record>
+	std::pair<const Record*, size_t> get(Section_index section) const
+	{
+		const auto& header_section = mp_header->sections[section];
+		return{ reinterpret_cast<const Record*>(m_file.data() + header_section.offset), header_section.count };
+	}
+
+	std::string get_string(std::uint32_t id) const
+	{
+		const auto offsets = get<std::uint32_t>(String_offsets_section);
+		assert(is_string(id));
+		const auto* p_data = m_file.data() + mp_header->sections[String_data_section].offset;
+		return{ p_data + offsets.first[id], p_data + offsets.first[id + 1] };
+	}
+private:
+	bool is_string(std::uint32_t id) const
+	{
+		return id < get<std::uint32_t>(String_offsets_section).second - 1;
+	}
+
+	// Offsets start at 0, never decrease and end inside the string data.
+	bool has_valid_strings() const
+	{
+		const auto offsets = get<std::uint32_t>(String_offsets_section);
+		return offsets.second > 0
+			&& offsets.first[0] == 0
+			&& offsets.first[offsets.second - 1] <= mp_header->sections[String_data_section].count
+			&& std::is_sorted(offsets.first, offsets.first + offsets.second);
+	}
+
+	// Every string id names a string, and every frame and collider range
+	// lies inside its table.
+	bool has_valid_records() const
+	{
+		auto is_range = [](std::uint32_t first, std::uint32_t count, size_t size) {
+			return first <= size && count <= size - first;
+		};
+		const auto frame_count = mp_header->sections[Frames_section].count;
+		const auto collider_count = mp_header->sections[Colliders_section].count;
+		return all_of<Pack_source>(Sources_section, [this](const Pack_source& source) {
+				return is_string(source.path);
+			})
+			&& all_of<Pack_image>(Images_section, [this](const Pack_image& image) {
+				return is_string(image.filename);
+			})
+			&& all_of<Pack_sprite>(Sprites_section, [this, &is_range, collider_count](const Pack_sprite& sprite) {
+				return is_string(sprite.filename)
+					&& is_string(sprite.image_filename)
+					&& is_range(sprite.first_collider, sprite.collider_count, collider_count);
+			})
+			&& all_of<Pack_animation>(Animations_section, [this, &is_range, frame_count](const Pack_animation& animation) {
+				return is_string(animation.filename)
+					&& is_range(animation.first_frame, animation.frame_count, frame_count);
+			})
+			&& all_of<Pack_frame>(Frames_section, [this](const Pack_frame& frame) {
+				return is_string(frame.animation_filename) && is_string(frame.sprite_filename);
+			})
+			&& all_of<Pack_group>(Groups_section, [this](const Pack_group& group) {
+				return is_string(group.name);
+			})
+			&& all_of<Pack_group_type>(Group_types_section, [this](const Pack_group_type& group_type) {
+				return is_string(group_type.group_name)
+					&& is_string(group_type.type)
+					&& is_string(group_type.animation_filename);
+			})
+			&& all_of<Pack_collider>(Colliders_section, [this](const Pack_collider& collider) {
+				return is_string(collider.image_name);
+			});
+	}
+
+	template <typename Record, typename Predicate>
+	bool all_of(Section_index section, Predicate predicate) const
+	{
+		const auto records = get<Record>(section);
+		return std::all_of(records.first, records.first + records.second, predicate);
+	}
+
+	const Mapped_file& m_file;
+	const Pack_header* mp_header;
+};
+
+} // namespace
+
+void bake_asset_pack(const std::string& data_filename, const std::string& pack_filename)
+{
+	Game_data data{};
+	load_image_data(data_filename, data);
+
+	Pack_writer writer{};
+	for (auto& source : get_sources(data_filename)) {
+		writer.add(Sources_section, Pack_source{ writer.intern(source), 0, get_modified_time(source) });
+	}
+	for (auto& image_pair : data.image_table) {
+		const auto& record = image_pair.second;
+		writer.add(Images_section, Pack_image{ writer.intern(record.filename), record.width, record.height });
+	}
+	for (auto& sprite_pair : data.sprite_table) {
+		const auto& record = sprite_pair.second;
+		writer.add(Sprites_section, Pack_sprite{
+			writer.intern(record.filename),
+			writer.intern(record.image_filename),
+			record.x,
+			record.y,
+			record.w,
+			record.h,
+			record.px,
+			record.py,
+			static_cast<std::uint32_t>(record.first_collider),
+			static_cast<std::uint32_t>(record.collider_count)
+		});
+	}
+	for (auto& animation_pair : data.animation_table) {
+		const auto& record = animation_pair.second;
+		writer.add(Animations_section, Pack_animation{
+			writer.intern(record.filename),
+			static_cast<std::uint32_t>(record.first_frame),
+			static_cast<std::uint32_t>(record.frame_count)
+		});
+	}
+	for (auto& record : data.animation_frame_table) {
+		writer.add(Frames_section, Pack_frame{
+			writer.intern(record.animation_filename),
+			writer.intern(record.sprite_filename),
+			record.delay,
+			record.delay_unit,
+			static_cast<std::uint32_t>(record.frame_index)
+		});
+	}
+	for (auto& group_pair : data.animation_group_table) {
+		writer.add(Groups_section, Pack_group{ writer.intern(group_pair.second.name) });
+	}
+	for (auto& record : data.animation_group_type_table) {
+		writer.add(Group_types_section, Pack_group_type{
+			writer.intern(record.group_name),
+			writer.intern(record.type),
+			writer.intern(record.animation_filename)
+		});
+	}
+	for (auto& record : data.collider_table) {
+		writer.add(Colliders_section, Pack_collider{ writer.intern(record.image_name), record.x, record.y, record.w, record.h });
+	}
+	writer.write(pack_filename);
+}
+
+bool load_asset_pack(const std::string& pack_filename, const std::string& data_filename, Game_data& data)
+{
+	TE_PROFILE_ZONE("load_asset_pack");
+	Mapped_file file{ pack_filename };
+	Pack_reader reader{ file };
+	if (!reader.is_valid()) {
+		return false;
+	}
+
+	const auto sources = reader.get<Pack_source>(Sources_section);
+	if (sources.second == 0 || reader.get_string(sources.first[0].path) != data_filename) {
+		return false;
+	}
+	for (size_t i = 0; i < sources.second; ++i) {
+		const auto& source = sources.first[i];
+		if (get_modified_time(reader.get_string(source.path)) != source.modified_time) {
+			return false;
+		}
+	}
+
+	// Frame and collider ranges index from the start of their tables.
+	assert(data.animation_frame_table.empty() && data.collider_table.empty());
+
+	// The baker writes the flat_maps in key order, so they are rebuilt
+	// with ordered_unique_range inserts instead of one sorted insert each.
+	using boost::container::ordered_unique_range;
+
+	const auto images = reader.get<Pack_image>(Images_section);
+	std::vector<decltype(data.image_table)::value_type> image_pairs{};
+	image_pairs.reserve(images.second);
+	for (size_t i = 0; i < images.second; ++i) {
+		const auto& image = images.first[i];
+		auto filename = reader.get_string(image.filename);
+		image_pairs.push_back({ filename, Image_record{ filename, image.width, image.height } });
+	}
+	data.image_table.insert(ordered_unique_range, image_pairs.begin(), image_pairs.end());
+
+	const auto sprites = reader.get<Pack_sprite>(Sprites_section);
+	std::vector<decltype(data.sprite_table)::value_type> sprite_pairs{};
+	sprite_pairs.reserve(sprites.second);
+	for (size_t i = 0; i < sprites.second; ++i) {
+		const auto& sprite = sprites.first[i];
+		auto filename = reader.get_string(sprite.filename);
+		sprite_pairs.push_back({ filename, Sprite_record{
+			filename,
+			reader.get_string(sprite.image_filename),
+			sprite.x,
+			sprite.y,
+			sprite.w,
+			sprite.h,
+			sprite.px,
+			sprite.py,
+			sprite.first_collider,
+			sprite.collider_count
+		} });
+	}
+	data.sprite_table.insert(ordered_unique_range, sprite_pairs.begin(), sprite_pairs.end());
+
+	const auto animations = reader.get<Pack_animation>(Animations_section);
+	std::vector<decltype(data.animation_table)::value_type> animation_pairs{};
+	animation_pairs.reserve(animations.second);
+	for (size_t i = 0; i < animations.second; ++i) {
+		const auto& animation = animations.first[i];
+		auto filename = reader.get_string(animation.filename);
+		animation_pairs.push_back({ filename, Animation_record{ filename, animation.first_frame, animation.frame_count } });
+	}
+	data.animation_table.insert(ordered_unique_range, animation_pairs.begin(), animation_pairs.end());
+
+	const auto frames = reader.get<Pack_frame>(Frames_section);
+	data.animation_frame_table.reserve(data.animation_frame_table.size() + frames.second);
+	for (size_t i = 0; i < frames.second; ++i) {
+		const auto& frame = frames.first[i];
+		data.animation_frame_table.push_back({
+			reader.get_string(frame.animation_filename),
+			reader.get_string(frame.sprite_filename),
+			frame.delay,
+			frame.delay_unit,
+			frame.frame_index
+		});
+	}
+
+	const auto groups = reader.get<Pack_group>(Groups_section);
+	std::vector<decltype(data.animation_group_table)::value_type> group_pairs{};
+	group_pairs.reserve(groups.second);
+	for (size_t i = 0; i < groups.second; ++i) {
+		auto name = reader.get_string(groups.first[i].name);
+		group_pairs.push_back({ name, Animation_group_record{ name } });
+	}
+	data.animation_group_table.insert(ordered_unique_range, group_pairs.begin(), group_pairs.end());
+
+	const auto group_types = reader.get<Pack_group_type>(Group_types_section);
+	data.animation_group_type_table.reserve(data.animation_group_type_table.size() + group_types.second);
+	for (size_t i = 0; i < group_types.second; ++i) {
+		const auto& group_type = group_types.first[i];
+		data.animation_group_type_table.push_back({
+			reader.get_string(group_type.group_name),
+			reader.get_string(group_type.type),
+			reader.get_string(group_type.animation_filename)
+		});
+	}
+
+	const auto colliders = reader.get<Pack_collider>(Colliders_section);
+	data.collider_table.reserve(data.collider_table.size() + colliders.second);
+	for (size_t i = 0; i < colliders.second; ++i) {
+		const auto& collider = colliders.first[i];
+		data.collider_table.push_back({ reader.get_string(collider.image_name), collider.x, collider.y, collider.w, collider.h });
+	}
+
+	return true;
+}
+
+void load_image_data_or_pack(const std::string& data_filename, const std::string& pack_filename, Game_data& data)
+{
+	if (!load_asset_pack(pack_filename, data_filename, data)) {
+		load_image_data(data_filename, data);
+	}
+}
+
+} // namespace te
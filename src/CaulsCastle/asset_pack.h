@@ -0,0 +1,26 @@
+#ifndef TE_ASSET_PACK_H
+#define TE_ASSET_PACK_H
+
+#include <string>
+
+namespace te {
+
+struct Game_data;
+
+// Parses the image data the same way load_image_data does and writes the
+// resulting tables, with their frame and collider ranges, to one binary
+// pack. The pack also records the modification time of every source file.
+void bake_asset_pack(const std::string& data_filename, const std::string& pack_filename);
+
+// Fills the image data tables of `data` from a pack built from
+// `data_filename`. Returns false without touching `data` if the pack is
+// missing, from another version, older than any of its sources, or has a
+// string id or frame or collider range out of bounds.
+bool load_asset_pack(const std::string& pack_filename, const std::string& data_filename, Game_data& data);
+
+// Loads from the pack when it is current and falls back to the XML.
+void load_image_data_or_pack(const std::string& data_filename, const std::string& pack_filename, Game_data& data);
+
+} // namespace te
+
+#endif
@@ -2,9 +2,14 @@
 #define TE_CONDITION_TABLE_H
 
 #include <vector>
+#include <cstddef>
 
 namespace te {
 
+// Query must provide a static key_count and a key() mapping every possible
+// query, wildcards included, into [0, key_count), plus from_key() to invert
+// it. Records are compiled into a table of first matches per key so that a
+// single lookup is O(1).
 template <typename Query, typename Out>
 class Condition_table {
 public:
@@ -16,10 +21,13 @@ public:
 
 	void assign_records(std::initializer_list<std::pair<Query, Out>> pair_list)
 	{
+		m_query_records.clear();
+		m_output_records.clear();
 		for (auto& pair : pair_list) {
 			m_query_records.push_back(std::move(pair.first));
 			m_output_records.push_back(std::move(pair.second));
 		}
+		compile();
 	}
 
 	template <typename Iter>
@@ -36,22 +44,42 @@ public:
 
 	bool get(const Query& query, Out& out) const
 	{
-		size_t i = 0;
-		for (auto& record : m_query_records) {
-			if (record == query) {
-				out = m_output_records[i];
-				return true;
-			}
-			++i;
+		if (m_first_matches.empty()) {
+			return false;
+		}
+		const auto record_index = m_first_matches[query.key()];
+		if (record_index == no_record) {
+			return false;
 		}
-		return false;
+		out = m_output_records[record_index];
+		return true;
 	}
 
 private:
+	static constexpr size_t no_record = static_cast<size_t>(-1);
+
+	void compile()
+	{
+		m_first_matches.assign(Query::key_count, no_record);
+		for (size_t key = 0; key < Query::key_count; ++key) {
+			const auto query = Query::from_key(key);
+			for (size_t i = 0; i < m_query_records.size(); ++i) {
+				if (m_query_records[i] == query) {
+					m_first_matches[key] = i;
+					break;
+				}
+			}
+		}
+	}
+
 	std::vector<Query> m_query_records;
 	std::vector<Out> m_output_records;
+	std::vector<size_t> m_first_matches;
 };
 
+template <typename Query, typename Out>
+constexpr size_t Condition_table<Query, Out>::no_record;
+
 } // namespace te
 
 #endif
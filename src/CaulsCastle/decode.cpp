@@ -0,0 +1,599 @@
+#include "decode.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+namespace te {
+
+namespace {
+
+const int max_code_bits = 15;
+
+class Bit_reader {
+public:
+	Bit_reader(const unsigned char* data, size_t size)
+		: mp_data{ data }
+		, m_size{ size }
+		, m_position{ 0 }
+		, m_bits{ 0 }
+		, m_bit_count{ 0 }
+		, m_overrun{ false }
+	{}
+
+	// Deflate packs bits least significant first.
+	unsigned bits(int count)
+	{
+		std::uint32_t value = m_bits;
+		while (m_bit_count < count) {
+			if (m_position == m_size) {
+				m_overrun = true;
+				return 0;
+			}
+			value |= static_cast<std::uint32_t>(mp_data[m_position++]) << m_bit_count;
+			m_bit_count += 8;
+		}
+		m_bits = value >> count;
+		m_bit_count -= count;
+		return value & ((1u << count) - 1);
+	}
+
+	void align_to_byte()
+	{
+		m_bits = 0;
+		m_bit_count = 0;
+	}
+
+	const unsigned char* take_bytes(size_t count)
+	{
+		if (m_size - m_position < count) {
+			m_overrun = true;
+			return nullptr;
+		}
+		const auto* p = mp_data + m_position;
+		m_position += count;
+		return p;
+	}
+
+	bool overrun() const noexcept { return m_overrun; }
+	size_t position() const noexcept { return m_position; }
+private:
+	const unsigned char* mp_data;
+	size_t m_size;
+	size_t m_position;
+	std::uint32_t m_bits;
+	int m_bit_count;
+	bool m_overrun;
+};
+
+// Canonical Huffman code stored as a count of codes per length and the
+// symbols ordered by code, decoded one bit at a time.
+struct Huffman {
+	std::array<short, max_code_bits + 1> counts;
+	std::array<short, 288> symbols;
+
+	bool build(const short* lengths, int count)
+	{
+		counts.fill(0);
+		for (int i = 0; i < count; ++i) {
+			++counts[lengths[i]];
+		}
+		if (counts[0] == count) {
+			return true;
+		}
+
+		int left = 1;
+		for (int length = 1; length <= max_code_bits; ++length) {
+			left <<= 1;
+			left -= counts[length];
+			if (left < 0) {
+				return false;
+			}
+		}
+
+		std::array<short, max_code_bits + 1> offsets{};
+		for (int length = 1; length < max_code_bits; ++length) {
+			offsets[length + 1] = offsets[length] + counts[length];
+		}
+		for (int i = 0; i < count; ++i) {
+			if (lengths[i] != 0) {
+				symbols[offsets[lengths[i]]++] = static_cast<short>(i);
+			}
+		}
+		return true;
+	}
+
+	int decode(Bit_reader& in) const
+	{
+		int code = 0;
+		int first = 0;
+		int index = 0;
+		for (int length = 1; length <= max_code_bits; ++length) {
+			code |= in.bits(1);
+			const int count = counts[length];
+			if (code - count < first) {
+				return symbols[index + (code - first)];
+			}
+			index += count;
+			first += count;
+			first <<= 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+};
+
+const short length_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+const short length_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+const short distance_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+const short distance_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+bool inflate_codes(Bit_reader& in, const Huffman& lengths, const Huffman& distances, std::vector<unsigned char>& out, size_t out_start)
+{
+	while (true) {
+		int symbol = lengths.decode(in);
+		if (symbol < 0 || in.overrun()) {
+			return false;
+		}
+		if (symbol < 256) {
+			out.push_back(static_cast<unsigned char>(symbol));
+			continue;
+		}
+		if (symbol == 256) {
+			return true;
+		}
+
+		symbol -= 257;
+		if (symbol >= 29) {
+			return false;
+		}
+		const size_t length = length_base[symbol] + in.bits(length_extra[symbol]);
+		const int distance_symbol = distances.decode(in);
+		if (distance_symbol < 0 || distance_symbol >= 30) {
+			return false;
+		}
+		const size_t distance = distance_base[distance_symbol] + in.bits(distance_extra[distance_symbol]);
+		if (in.overrun() || distance > out.size() - out_start) {
+			return false;
+		}
+		// Copies byte by byte since the source may overlap the output.
+		auto from = out.size() - distance;
+		for (size_t i = 0; i < length; ++i) {
+			out.push_back(out[from + i]);
+		}
+	}
+}
+
+bool inflate_stored(Bit_reader& in, std::vector<unsigned char>& out)
+{
+	in.align_to_byte();
+	const auto* p_header = in.take_bytes(4);
+	if (!p_header) {
+		return false;
+	}
+	const unsigned length = p_header[0] | (p_header[1] << 8);
+	const unsigned complement = p_header[2] | (p_header[3] << 8);
+	if (length != (~complement & 0xffff)) {
+		return false;
+	}
+	const auto* p_bytes = in.take_bytes(length);
+	if (!p_bytes) {
+		return false;
+	}
+	out.insert(out.end(), p_bytes, p_bytes + length);
+	return true;
+}
+
+bool inflate_fixed(Bit_reader& in, std::vector<unsigned char>& out, size_t out_start)
+{
+	static Huffman fixed_lengths;
+	static Huffman fixed_distances;
+	static const bool built = [] {
+		short lengths[288];
+		int i = 0;
+		for (; i < 144; ++i) lengths[i] = 8;
+		for (; i < 256; ++i) lengths[i] = 9;
+		for (; i < 280; ++i) lengths[i] = 7;
+		for (; i < 288; ++i) lengths[i] = 8;
+		fixed_lengths.build(lengths, 288);
+		for (i = 0; i < 30; ++i) lengths[i] = 5;
+		fixed_distances.build(lengths, 30);
+		return true;
+	}();
+	(void)built;
+	return inflate_codes(in, fixed_lengths, fixed_distances, out, out_start);
+}
+
+bool inflate_dynamic(Bit_reader& in, std::vector<unsigned char>& out, size_t out_start)
+{
+	static const short code_length_order[19] = {
+		16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+	};
+
+	const int length_count = in.bits(5) + 257;
+	const int distance_count = in.bits(5) + 1;
+	const int code_length_count = in.bits(4) + 4;
+	if (length_count > 286 || distance_count > 30) {
+		return false;
+	}
+
+	short lengths[320] = {};
+	for (int i = 0; i < code_length_count; ++i) {
+		lengths[code_length_order[i]] = static_cast<short>(in.bits(3));
+	}
+	Huffman code_lengths;
+	if (!code_lengths.build(lengths, 19)) {
+		return false;
+	}
+
+	int index = 0;
+	while (index < length_count + distance_count) {
+		const int symbol = code_lengths.decode(in);
+		if (symbol < 0 || in.overrun()) {
+			return false;
+		}
+		if (symbol < 16) {
+			lengths[index++] = static_cast<short>(symbol);
+			continue;
+		}
+		short repeated = 0;
+		int repeat;
+		if (symbol == 16) {
+			if (index == 0) {
+				return false;
+			}
+			repeated = lengths[index - 1];
+			repeat = 3 + in.bits(2);
+		}
+		else if (symbol == 17) {
+			repeat = 3 + in.bits(3);
+		}
+		else {
+			repeat = 11 + in.bits(7);
+		}
+		if (index + repeat > length_count + distance_count) {
+			return false;
+		}
+		while (repeat--) {
+			lengths[index++] = repeated;
+		}
+	}
+	if (lengths[256] == 0) {
+		return false;
+	}
+
+	Huffman literal_lengths;
+	Huffman distances;
+	if (!literal_lengths.build(lengths, length_count) || !distances.build(lengths + length_count, distance_count)) {
+		return false;
+	}
+	return inflate_codes(in, literal_lengths, distances, out, out_start);
+}
+
+std::uint32_t adler32(const unsigned char* data, size_t size)
+{
+	std::uint32_t a = 1;
+	std::uint32_t b = 0;
+	while (size > 0) {
+		// 5552 is the most bytes that can be summed before b overflows.
+		const size_t block = size < 5552 ? size : 5552;
+		for (size_t i = 0; i < block; ++i) {
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += block;
+		size -= block;
+	}
+	return (b << 16) | a;
+}
+
+int base64_value(char c)
+{
+	if (c >= 'A' && c <= 'Z') return c - 'A';
+	if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+	if (c >= '0' && c <= '9') return c - '0' + 52;
+	if (c == '+') return 62;
+	if (c == '/') return 63;
+	return -1;
+}
+
+std::uint32_t read_be32(const unsigned char* p)
+{
+	return (std::uint32_t{ p[0] } << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+int paeth_predictor(int a, int b, int c)
+{
+	const int p = a + b - c;
+	const int pa = std::abs(p - a);
+	const int pb = std::abs(p - b);
+	const int pc = std::abs(p - c);
+	if (pa <= pb && pa <= pc) {
+		return a;
+	}
+	return pb <= pc ? b : c;
+}
+
+// Undoes the per-row filters in place, dropping each row's filter byte.
+bool unfilter_rows(std::vector<unsigned char>& data, size_t row_bytes, size_t row_count, size_t pixel_bytes)
+{
+	const unsigned char* p_previous = nullptr;
+	for (size_t y = 0; y < row_count; ++y) {
+		const auto filter = data[y * (row_bytes + 1)];
+		auto* p_row = data.data() + y * row_bytes;
+		// Rows move down by one byte per row above them.
+		std::copy(data.begin() + y * (row_bytes + 1) + 1, data.begin() + (y + 1) * (row_bytes + 1), p_row);
+		for (size_t i = 0; i < row_bytes; ++i) {
+			const int left = i >= pixel_bytes ? p_row[i - pixel_bytes] : 0;
+			const int up = p_previous ? p_previous[i] : 0;
+			const int up_left = p_previous && i >= pixel_bytes ? p_previous[i - pixel_bytes] : 0;
+			switch (filter) {
+			case 0:
+				break;
+			case 1:
+				p_row[i] += left;
+				break;
+			case 2:
+				p_row[i] += up;
+				break;
+			case 3:
+				p_row[i] += (left + up) / 2;
+				break;
+			case 4:
+				p_row[i] += paeth_predictor(left, up, up_left);
+				break;
+			default:
+				return false;
+			}
+		}
+		p_previous = p_row;
+	}
+	data.resize(row_bytes * row_count);
+	return true;
+}
+
+// The `index`th sample of a row of `depth`-bit samples, packed most
+// significant first below 8 bits and big-endian at 16.
+unsigned read_sample(const unsigned char* p_row, size_t index, int depth)
+{
+	switch (depth) {
+	case 16:
+		return (p_row[index * 2] << 8) | p_row[index * 2 + 1];
+	case 8:
+		return p_row[index];
+	default:
+		const auto bit = index * depth;
+		return (p_row[bit / 8] >> (8 - depth - bit % 8)) & ((1u << depth) - 1);
+	}
+}
+
+} // namespace
+
+bool inflate_zlib(const unsigned char* data, size_t size, std::vector<unsigned char>& out)
+{
+	if (size < 6) {
+		return false;
+	}
+	const unsigned cmf = data[0];
+	const unsigned flg = data[1];
+	if ((cmf & 0x0f) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) {
+		return false;
+	}
+
+	const auto out_start = out.size();
+	Bit_reader in{ data + 2, size - 2 };
+	bool last_block = false;
+	while (!last_block) {
+		last_block = in.bits(1) != 0;
+		bool ok = false;
+		switch (in.bits(2)) {
+		case 0:
+			ok = inflate_stored(in, out);
+			break;
+		case 1:
+			ok = inflate_fixed(in, out, out_start);
+			break;
+		case 2:
+			ok = inflate_dynamic(in, out, out_start);
+			break;
+		}
+		if (!ok || in.overrun()) {
+			return false;
+		}
+	}
+
+	in.align_to_byte();
+	const auto* p_checksum = in.take_bytes(4);
+	if (!p_checksum) {
+		return false;
+	}
+	const std::uint32_t expected = (std::uint32_t{ p_checksum[0] } << 24) | (p_checksum[1] << 16) | (p_checksum[2] << 8) | p_checksum[3];
+	return adler32(out.data() + out_start, out.size() - out_start) == expected;
+}
+
+bool decode_base64(const char* first, const char* last, std::vector<unsigned char>& out)
+{
+	std::uint32_t accumulator = 0;
+	int bit_count = 0;
+	for (; first != last; ++first) {
+		const char c = *first;
+		if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+			continue;
+		}
+		if (c == '=') {
+			break;
+		}
+		const int value = base64_value(c);
+		if (value < 0) {
+			return false;
+		}
+		accumulator = (accumulator << 6) | value;
+		bit_count += 6;
+		if (bit_count >= 8) {
+			bit_count -= 8;
+			out.push_back(static_cast<unsigned char>(accumulator >> bit_count));
+		}
+	}
+	return true;
+}
+
+bool decode_png(const unsigned char* data, size_t size, std::vector<unsigned char>& rgba, int& width, int& height)
+{
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	if (size < sizeof(signature) || !std::equal(signature, signature + sizeof(signature), data)) {
+		return false;
+	}
+
+	std::uint32_t image_width = 0;
+	std::uint32_t image_height = 0;
+	int depth = 0;
+	int colour_type = -1;
+	std::vector<unsigned char> palette;
+	std::vector<unsigned char> transparency;
+	std::vector<unsigned char> compressed;
+	bool ended = false;
+	// Chunk CRCs are not checked; damage to the image data still fails
+	// the zlib checksum.
+	for (size_t offset = sizeof(signature); !ended;) {
+		if (size - offset < 12) {
+			return false;
+		}
+		const auto length = read_be32(data + offset);
+		if (length > size - offset - 12) {
+			return false;
+		}
+		const auto* p_type = data + offset + 4;
+		const auto* p_chunk = data + offset + 8;
+		offset += 12 + length;
+
+		if (std::equal(p_type, p_type + 4, "IHDR")) {
+			if (length != 13) {
+				return false;
+			}
+			image_width = read_be32(p_chunk);
+			image_height = read_be32(p_chunk + 4);
+			depth = p_chunk[8];
+			colour_type = p_chunk[9];
+			// Compression, filter and interlace method; only 0 is read.
+			if (p_chunk[10] != 0 || p_chunk[11] != 0 || p_chunk[12] != 0) {
+				return false;
+			}
+		}
+		else if (std::equal(p_type, p_type + 4, "PLTE")) {
+			palette.assign(p_chunk, p_chunk + length);
+		}
+		else if (std::equal(p_type, p_type + 4, "tRNS")) {
+			transparency.assign(p_chunk, p_chunk + length);
+		}
+		else if (std::equal(p_type, p_type + 4, "IDAT")) {
+			compressed.insert(compressed.end(), p_chunk, p_chunk + length);
+		}
+		else if (std::equal(p_type, p_type + 4, "IEND")) {
+			ended = true;
+		}
+	}
+
+	int channels;
+	switch (colour_type) {
+	case 0: channels = 1; break;
+	case 2: channels = 3; break;
+	case 3: channels = 1; break;
+	case 4: channels = 2; break;
+	case 6: channels = 4; break;
+	default: return false;
+	}
+	const bool sub_byte_allowed = colour_type == 0 || colour_type == 3;
+	const bool valid_depth = depth == 8
+		|| (depth == 16 && colour_type != 3)
+		|| (sub_byte_allowed && (depth == 1 || depth == 2 || depth == 4));
+	// At most 2^28 pixels, so the RGBA size fits in 32 bits.
+	if (!valid_depth || image_width == 0 || image_height == 0 || std::uint64_t{ image_width } * image_height > (1u << 28)) {
+		return false;
+	}
+	if (colour_type == 3 && (palette.empty() || palette.size() % 3 != 0)) {
+		return false;
+	}
+
+	const size_t bits_per_pixel = static_cast<size_t>(channels) * depth;
+	const size_t row_bytes = (image_width * bits_per_pixel + 7) / 8;
+	const size_t pixel_bytes = std::max<size_t>(bits_per_pixel / 8, 1);
+	std::vector<unsigned char> rows;
+	rows.reserve((row_bytes + 1) * image_height);
+	if (!inflate_zlib(compressed.data(), compressed.size(), rows) || rows.size() != (row_bytes + 1) * image_height) {
+		return false;
+	}
+	if (!unfilter_rows(rows, row_bytes, image_height, pixel_bytes)) {
+		return false;
+	}
+
+	const unsigned max_sample = (1u << depth) - 1;
+	auto to_byte = [depth, max_sample](unsigned sample) {
+		return static_cast<unsigned char>(depth == 16 ? sample >> 8 : sample * 255 / max_sample);
+	};
+	// The tRNS colour key of grey and RGB images, in raw samples.
+	const bool has_key = (colour_type == 0 && transparency.size() >= 2) || (colour_type == 2 && transparency.size() >= 6);
+	unsigned key[3] = {};
+	for (int c = 0; has_key && c < (colour_type == 0 ? 1 : 3); ++c) {
+		key[c] = (transparency[c * 2] << 8) | transparency[c * 2 + 1];
+	}
+
+	rgba.resize(static_cast<size_t>(image_width) * image_height * 4);
+	auto* p_out = rgba.data();
+	for (std::uint32_t y = 0; y < image_height; ++y) {
+		const auto* p_row = rows.data() + y * row_bytes;
+		for (std::uint32_t x = 0; x < image_width; ++x, p_out += 4) {
+			const size_t first = static_cast<size_t>(x) * channels;
+			switch (colour_type) {
+			case 0:
+			case 4: {
+				const auto grey = read_sample(p_row, first, depth);
+				p_out[0] = p_out[1] = p_out[2] = to_byte(grey);
+				p_out[3] = colour_type == 4 ? to_byte(read_sample(p_row, first + 1, depth)) : has_key && grey == key[0] ? 0 : 255;
+				break;
+			}
+			case 2:
+			case 6: {
+				unsigned samples[4];
+				for (int c = 0; c < channels; ++c) {
+					samples[c] = read_sample(p_row, first + c, depth);
+					p_out[c] = to_byte(samples[c]);
+				}
+				if (colour_type == 2) {
+					const bool keyed = has_key && samples[0] == key[0] && samples[1] == key[1] && samples[2] == key[2];
+					p_out[3] = keyed ? 0 : 255;
+				}
+				break;
+			}
+			case 3: {
+				const auto index = read_sample(p_row, first, depth);
+				if (index * 3 >= palette.size()) {
+					return false;
+				}
+				std::copy_n(palette.begin() + index * 3, 3, p_out);
+				p_out[3] = index < transparency.size() ? transparency[index] : 255;
+				break;
+			}
+			}
+		}
+	}
+	width = static_cast<int>(image_width);
+	height = static_cast<int>(image_height);
+	return true;
+}
+
+} // namespace te
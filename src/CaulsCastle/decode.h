@@ -0,0 +1,24 @@
+#ifndef TE_DECODE_H
+#define TE_DECODE_H
+
+#include <vector>
+#include <cstddef>
+
+namespace te {
+
+// Decompresses a zlib stream (RFC 1950 wrapping RFC 1951 deflate) and
+// appends the result to `out`. Returns false on malformed input or a
+// checksum mismatch.
+bool inflate_zlib(const unsigned char* data, size_t size, std::vector<unsigned char>& out);
+
+// Decodes base64, skipping whitespace, and appends the bytes to `out`.
+bool decode_base64(const char* first, const char* last, std::vector<unsigned char>& out);
+
+// Decodes a non-interlaced PNG of any colour type and bit depth into 8-bit
+// RGBA rows, top row first, replacing `rgba`. Returns false on malformed
+// input and on interlaced images.
+bool decode_png(const unsigned char* data, size_t size, std::vector<unsigned char>& rgba, int& width, int& height);
+
+} // namespace te
+
+#endif
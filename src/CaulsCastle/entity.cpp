@@ -2,47 +2,74 @@
 #include "game_data.h"
 #include "entity_states.h"
 #include "utilities.h"
+#include "physics_manager.h"
+#include "profiler.h"
 
 #include <rapidxml.hpp>
 #include <rapidxml_utils.hpp>
 #include <Box2D/Box2D.h>
 
+#include <algorithm>
 #include <memory>
+#include <stdexcept>
 
 namespace te {
 
+namespace {
+
+rapidxml::xml_node<>& required_node(rapidxml::xml_node<>& parent, const char* name, const std::string& filename)
+{
+	auto* p_node = parent.first_node(name);
+	if (p_node == nullptr) {
+		throw std::runtime_error{ filename + ": missing <" + name + ">" };
+	}
+	return *p_node;
+}
+
+const char* required_value(rapidxml::xml_node<>& node, const char* attribute, const std::string& filename)
+{
+	auto* p_attribute = node.first_attribute(attribute);
+	if (p_attribute == nullptr) {
+		throw std::runtime_error{ filename + ": <" + node.name() + "> has no " + attribute };
+	}
+	return p_attribute->value();
+}
+
+} // namespace
+
 Entity_xml::Entity_xml(const std::string& filename)
+	: stats{}
 {
 	rapidxml::file<> file{ filename.c_str() };
 	rapidxml::xml_document<> xml;
 	xml.parse<0>(file.data());
-	auto* p_root = xml.first_node("entity");
+	auto& root = required_node(xml, "entity", filename);
 
-	name = p_root->first_attribute("name")->value();
-	animation_group = p_root->first_node("animationgroup")->first_attribute("value")->value();
-	max_speed = std::stof(p_root->first_node("speed")->first_attribute("value")->value());
-	initial_state = p_root->first_node("state")->first_attribute("value")->value();
+	name = required_value(root, "name", filename);
+	animation_group = required_value(required_node(root, "animationgroup", filename), "value", filename);
+	max_speed = std::stof(required_value(required_node(root, "speed", filename), "value", filename));
+	initial_state = required_value(required_node(root, "state", filename), "value", filename);
 
-	if (auto* p_rigid_body = p_root->first_node("rigidbody")) {
-		rigid_body_type = p_rigid_body->first_attribute("type")->value();
+	if (auto* p_rigid_body = root.first_node("rigidbody")) {
+		rigid_body_type = required_value(*p_rigid_body, "type", filename);
 		for (auto* p_fixture = p_rigid_body->first_node("fixture"); p_fixture != NULL; p_fixture = p_fixture->next_sibling("fixture")) {
-			if (p_fixture->first_attribute("type")->value() == std::string{ "rect" }) {
+			if (required_value(*p_fixture, "type", filename) == std::string{ "rect" }) {
 				auto* hitbox_node = p_fixture->first_attribute("is-hitbox");
 				rect_fixtures.push_back({
-					std::stof(p_fixture->first_attribute("halfwidth")->value()),
-					std::stof(p_fixture->first_attribute("halfheight")->value()),
+					std::stof(required_value(*p_fixture, "halfwidth", filename)),
+					std::stof(required_value(*p_fixture, "halfheight", filename)),
 					hitbox_node && hitbox_node->value() == std::string{"true"} ? true : false
 				});
 			}
 		}
 	}
 
-	if (auto* p_stats = p_root->first_node("stats")) {
-		for (auto* p_stat = p_root->first_node("stat");
+	if (auto* p_stats = root.first_node("stats")) {
+		for (auto* p_stat = p_stats->first_node("stat");
 		     p_stat != NULL;
 		     p_stat = p_stat->next_sibling("stat")) {
-			std::string type = p_stat->first_attribute("type")->value();
-			int value = std::stoi(p_stat->first_attribute("value")->value());
+			std::string type = required_value(*p_stat, "type", filename);
+			int value = std::stoi(required_value(*p_stat, "value", filename));
 			if (type == "vitality") {
 				stats.vitality = value;
 			}
@@ -56,7 +83,7 @@ Entity_xml::Entity_xml(const std::string& filename)
 				stats.dexterity = value;
 			}
 			else {
-				assert(false && "Unsupported stat type");
+				throw std::runtime_error{ filename + ": unsupported stat type " + type };
 			}
 		}
 	}
@@ -72,57 +99,241 @@ void load_entity_xml(const std::string& filename, Game_data& data)
 	}));
 }
 
+Entity_prefab::Entity_prefab(const Entity_xml& entity_xml, Game_data& data)
+	: p_entity_xml{ &entity_xml }
+	, animation{ entity_xml.animation_group, data }
+	, initial_mesh{ data.animations2.get(animation.idle_down).frames[0].mesh_id }
+	, max_speed{ entity_xml.max_speed }
+	, starts_normal{ entity_xml.initial_state == "normal" }
+	, is_dynamic{ entity_xml.rigid_body_type == "dynamic" }
+	, fixtures{}
+	, stats(entity_xml.stats)
+{
+	for (const auto& rect_fixture : entity_xml.rect_fixtures) {
+		fixtures.push_back({ b2PolygonShape{}, rect_fixture.is_hitbox });
+		fixtures.back().shape.SetAsBox(rect_fixture.half_width, rect_fixture.half_height);
+	}
+}
+
+const Entity_prefab& get_prefab(const Entity_xml& entity_xml, Game_data& data)
+{
+	auto found = data.entity_prefabs.find(&entity_xml);
+	if (found == data.entity_prefabs.end()) {
+		found = data.entity_prefabs.insert(decltype(data.entity_prefabs)::value_type{
+			&entity_xml,
+			std::make_unique<Entity_prefab>(entity_xml, data)
+		}).first;
+	}
+	return *found->second;
+}
+
+namespace {
+
+Game_data::Stats to_stats(const Entity_xml::Stats& stats)
+{
+	return{ stats.vitality, stats.endurance, stats.strength, stats.dexterity };
+}
+
+bool is_same_fixture(const Entity_prefab::Fixture& lhs, const Entity_prefab::Fixture& rhs)
+{
+	if (lhs.is_sensor != rhs.is_sensor
+	    || lhs.shape.m_count != rhs.shape.m_count
+	    || lhs.shape.m_radius != rhs.shape.m_radius) {
+		return false;
+	}
+	for (int i = 0; i < lhs.shape.m_count; ++i) {
+		if (!(lhs.shape.m_vertices[i] == rhs.shape.m_vertices[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void create_fixtures(const Entity_prefab& prefab, b2Body& body)
+{
+	for (const auto& fixture : prefab.fixtures) {
+		b2FixtureDef fixture_def;
+		fixture_def.shape = &fixture.shape;
+		fixture_def.density = 1;
+		fixture_def.isSensor = fixture.is_sensor;
+		body.CreateFixture(&fixture_def);
+	}
+}
+
+void add_rigid_body(const Entity_prefab& prefab, Entity_id entity_id, vec2 position, Game_data& data)
+{
+	b2BodyDef body_def;
+	body_def.type = b2_dynamicBody;
+	body_def.position = {
+		position.x,
+		position.y
+	};
+	// A reused body keeps the fixtures made for the same Entity_xml.
+	auto acquired = data.physics_manager.acquire_rigid_body(entity_id, body_def, prefab.p_entity_xml);
+	if (!acquired.second) {
+		create_fixtures(prefab, *acquired.first);
+	}
+}
+
+// `ids` are ascending, so the batch goes into `component` as one sorted
+// range: a single merge instead of a shift per entity.
+template <typename Component, typename Make_value>
+void insert_batch(Component& component, const std::vector<Entity_id>& ids, const Make_value& make_value)
+{
+	std::vector<typename Component::value_type> values;
+	values.reserve(ids.size());
+	for (size_t i = 0; i < ids.size(); ++i) {
+		values.push_back({ ids[i], make_value(i) });
+	}
+	component.insert(boost::container::ordered_unique_range, values.begin(), values.end());
+}
+
+} // namespace
+
+void reload_prefab(const Entity_xml& entity_xml, Game_data& data)
+{
+	auto found = data.entity_prefabs.find(&entity_xml);
+	if (found == data.entity_prefabs.end()) {
+		return;
+	}
+	auto& prefab = *found->second;
+	Entity_prefab reloaded{ entity_xml, data };
+	const bool fixtures_changed = !std::equal(prefab.fixtures.begin(), prefab.fixtures.end(),
+						  reloaded.fixtures.begin(), reloaded.fixtures.end(),
+						  is_same_fixture);
+	prefab = std::move(reloaded);
+
+	if (fixtures_changed) {
+		data.physics_manager.clear_pool(&entity_xml);
+	}
+	for (const auto& entity_pair : data.entity_xmls) {
+		if (entity_pair.second != &entity_xml) {
+			continue;
+		}
+		const auto entity_id = entity_pair.first;
+		data.max_speeds[entity_id] = prefab.max_speed;
+		auto body_found = data.physics_manager.find_rigid_body(entity_id);
+		if (fixtures_changed && body_found != data.physics_manager.end()) {
+			auto& body = *body_found->second;
+			while (auto* p_fixture = body.GetFixtureList()) {
+				body.DestroyFixture(p_fixture);
+			}
+			create_fixtures(prefab, body);
+		}
+	}
+}
+
 Entity_id make_entity(const Entity_xml& entity_xml, Game_data& data, vec2 position)
 {
 	auto entity_id = data.entity_manager.get_free_id();
+	respawn_entity(entity_xml, data, entity_id, position);
+	return entity_id;
+}
+
+std::vector<Entity_id> spawn_batch(const Entity_prefab& prefab, const std::vector<vec2>& positions, Game_data& data)
+{
+	TE_PROFILE_ZONE("spawn_batch");
+	std::vector<Entity_id> ids(positions.size());
+	for (auto& entity_id : ids) {
+		entity_id = data.entity_manager.get_free_id();
+	}
+
+	insert_batch(data.entity_xmls, ids, [&prefab](size_t) { return prefab.p_entity_xml; });
+	insert_batch(data.entity_animation_groups, ids, [&prefab](size_t) { return &prefab.animation; });
+	insert_batch(data.entity_animations2, ids, [&prefab](size_t) {
+		return Game_data::Animation_data<Mesh2>{ prefab.animation.idle_down };
+	});
+	insert_batch(data.max_speeds, ids, [&prefab](size_t) { return prefab.max_speed; });
+	insert_batch(data.positions, ids, [&positions](size_t i) { return positions[i]; });
+	insert_batch(data.stats, ids, [&prefab](size_t) { return to_stats(prefab.stats); });
+	for (size_t i = 0; i < ids.size(); ++i) {
+		data.entity_meshes2.insert({ ids[i], { prefab.initial_mesh } });
+		if (prefab.starts_normal) {
+			data.normal_state_table.insert(ids[i]);
+		}
+		if (prefab.is_dynamic) {
+			add_rigid_body(prefab, ids[i], positions[i], data);
+		}
+	}
+	return ids;
+}
 
-	data.entity_animation_groups.insert(decltype(data.entity_animation_groups)::value_type{
+void respawn_entity(const Entity_xml& entity_xml, Game_data& data, Entity_id entity_id, vec2 position)
+{
+	const auto& prefab = get_prefab(entity_xml, data);
+	data.entity_xmls.insert(decltype(data.entity_xmls)::value_type{ entity_id, prefab.p_entity_xml });
+	data.entity_animation_groups.insert(decltype(data.entity_animation_groups)::value_type{ entity_id, &prefab.animation });
+	data.entity_animations2.insert(decltype(data.entity_animations2)::value_type{
 		entity_id,
-		Entity_animation{ entity_xml.animation_group, data }
+		Game_data::Animation_data<Mesh2>{ prefab.animation.idle_down }
 	});
-	auto group_found = data.entity_animation_groups.find(entity_id);
-	assert(group_found != data.entity_animation_groups.end());
-	set_animation(data,
-		      entity_id,
-		      group_found->second.idle_down);
-	data.max_speeds.insert(decltype(data.max_speeds)::value_type{ entity_id, entity_xml.max_speed });
-
-	if (entity_xml.initial_state == "normal") {
+	data.entity_meshes2.insert({ entity_id, { prefab.initial_mesh } });
+	data.max_speeds.insert(decltype(data.max_speeds)::value_type{ entity_id, prefab.max_speed });
+
+	if (prefab.starts_normal) {
 		data.normal_state_table.insert(entity_id);
 	}
 
 	data.positions[entity_id] = position;
 
-	b2Body* p_rigid_body = nullptr;
-	if (entity_xml.rigid_body_type == "dynamic") {
-		b2BodyDef body_def;
-		body_def.type = b2_dynamicBody;
-		body_def.position = {
-			position.x,
-			position.y
-		};
-		p_rigid_body = &data.physics_manager.add_rigid_body(entity_id, body_def);
-	}
-	if (p_rigid_body) {
-		for (const auto& rect_fixture : entity_xml.rect_fixtures) {
-			b2PolygonShape rect_shape{};
-			rect_shape.SetAsBox(rect_fixture.half_width, rect_fixture.half_height);
-			auto* p_fixture = p_rigid_body->CreateFixture(&rect_shape, 1);
-			p_fixture->SetSensor(rect_fixture.is_hitbox);
-		}
+	if (prefab.is_dynamic) {
+		add_rigid_body(prefab, entity_id, position, data);
 	}
 
-	auto& stats = data.stats[entity_id];
-	stats.vitality = entity_xml.stats.vitality;
-	stats.endurance = entity_xml.stats.endurance;
-	stats.strength = entity_xml.stats.strength;
-	stats.dexterity = entity_xml.stats.dexterity;
+	data.stats[entity_id] = to_stats(prefab.stats);
+}
 
-	return entity_id;
+void despawn(Game_data& data, Entity_id entity_id)
+{
+	data.despawn_queue.push_back(entity_id);
+}
+
+void despawn_entities(Game_data& data)
+{
+	auto& ids = data.despawn_queue;
+	if (ids.empty()) {
+		return;
+	}
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	auto is_despawned = [&ids](Entity_id entity_id) {
+		return std::binary_search(ids.begin(), ids.end(), entity_id);
+	};
+
+	erase_keys(data.entity_xmls, ids.begin(), ids.end());
+	erase_keys(data.max_speeds, ids.begin(), ids.end());
+	erase_keys(data.speeds, ids.begin(), ids.end());
+	erase_keys(data.headings, ids.begin(), ids.end());
+	erase_keys(data.positions, ids.begin(), ids.end());
+	erase_keys(data.entity_team_masks, ids.begin(), ids.end());
+	erase_keys(data.stats, ids.begin(), ids.end());
+	erase_keys(data.entity_animation_groups, ids.begin(), ids.end());
+	erase_keys(data.entity_animations2, ids.begin(), ids.end());
+	data.entity_meshes2.erase_keys(ids.begin(), ids.end());
+	data.entity_meshes3.erase_keys(ids.begin(), ids.end());
+
+	for (auto entity_id : ids) {
+		data.normal_state_table.erase(entity_id);
+		data.light_attack_state_table.erase(entity_id);
+	}
+	data.physics_manager.remove_rigid_bodies(ids);
+
+	data.avatars.erase(std::remove_if(data.avatars.begin(), data.avatars.end(), [&is_despawned](const decltype(data.avatars)::value_type& avatar_pair) {
+		return is_despawned(avatar_pair.second);
+	}), data.avatars.end());
+	data.attack_queries.erase(std::remove_if(data.attack_queries.begin(), data.attack_queries.end(), [&is_despawned](const Game_data::Attack_query& query) {
+		return is_despawned(query.entity_id);
+	}), data.attack_queries.end());
+	data.pending_hits.erase(std::remove_if(data.pending_hits.begin(), data.pending_hits.end(), [&is_despawned](const Game_data::Pending_hits& hit) {
+		return is_despawned(hit.entity_id);
+	}), data.pending_hits.end());
+
+	ids.clear();
 }
 
 void load_entities_xml(const std::string& filename, Game_data& data)
 {
+	TE_PROFILE_ZONE("load_entities_xml");
 	const auto dir = get_directory(filename);
 
 	rapidxml::file<> file{ filename.c_str() };
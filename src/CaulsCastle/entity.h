@@ -2,6 +2,10 @@
 #define TE_ENTITY_H
 
 #include "types.h"
+#include "entity_animation.h"
+
+#include <Box2D/Box2D.h>
+
 #include <string>
 #include <vector>
 
@@ -28,12 +32,52 @@ struct Entity_xml {
 		int dexterity;
 	} stats;
 
+	// Throws rapidxml::parse_error for malformed XML and std::runtime_error
+	// for a missing node or attribute.
 	Entity_xml(const std::string& filename);
 };
 
-struct Game_data;
+// An Entity_xml compiled for spawning: its animation group resolved to
+// resource ids and its fixtures to shapes, so no name is looked up per
+// entity. Entities share the prefab's animation lookup table.
+struct Entity_prefab {
+	struct Fixture {
+		b2PolygonShape shape;
+		bool is_sensor;
+	};
+
+	const Entity_xml* p_entity_xml;
+	Entity_animation animation;
+	Resource_id<Mesh2> initial_mesh;
+	float max_speed;
+	bool starts_normal;
+	bool is_dynamic;
+	std::vector<Fixture> fixtures;
+	Entity_xml::Stats stats;
+
+	Entity_prefab(const Entity_xml& entity_xml, Game_data& data);
+};
+
 void load_entity_xml(const std::string& filename, Game_data& data);
+// Compiles the prefab of `entity_xml` on first use.
+const Entity_prefab& get_prefab(const Entity_xml& entity_xml, Game_data& data);
+// Compiles the prefab again in place after `entity_xml` or the animations
+// it names changed. Live entities made from it take the new animations,
+// max speed and fixtures; their other state is left alone. Fixtures are
+// only made again on live bodies when their shapes changed.
+void reload_prefab(const Entity_xml& entity_xml, Game_data& data);
 Entity_id make_entity(const Entity_xml& entity_xml, Game_data& data, vec2 position = {});
+// Makes one entity per position, inserting into each component once for
+// the whole batch. Returns the new ids in the order of `positions`.
+std::vector<Entity_id> spawn_batch(const Entity_prefab& prefab, const std::vector<vec2>& positions, Game_data& data);
+// make_entity under an id the entity had before, e.g. when a snapshot is
+// restored after it was despawned.
+void respawn_entity(const Entity_xml& entity_xml, Game_data& data, Entity_id entity_id, vec2 position = {});
+// Queues the entity for removal by despawn_entities at the end of the tick.
+void despawn(Game_data& data, Entity_id entity_id);
+// Removes every queued entity from all components, state tables and the
+// physics world.
+void despawn_entities(Game_data& data);
 
 void load_entities_xml(const std::string& entity_listing_filename, Game_data& data);
 
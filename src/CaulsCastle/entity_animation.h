@@ -49,6 +49,37 @@ struct Entity_animation {
 			, y_is_positive(y_is_positive)
 		{}
 
+		// Every combination of the six Tri_bool fields, wildcards included,
+		// maps to a distinct key in [0, key_count).
+		static constexpr size_t key_count = Tri_bool::state_count
+			* Tri_bool::state_count
+			* Tri_bool::state_count
+			* Tri_bool::state_count
+			* Tri_bool::state_count
+			* Tri_bool::state_count;
+
+		constexpr size_t key() const noexcept
+		{
+			return ((((is_light_attacking.index() * Tri_bool::state_count
+				   + is_moving.index()) * Tri_bool::state_count
+				  + high_speed.index()) * Tri_bool::state_count
+				 + mag_x_gt_mag_y.index()) * Tri_bool::state_count
+				+ x_is_positive.index()) * Tri_bool::state_count
+				+ y_is_positive.index();
+		}
+
+		static constexpr Query from_key(size_t key) noexcept
+		{
+			return Query{
+				Tri_bool::from_index(key / (Tri_bool::state_count * Tri_bool::state_count * Tri_bool::state_count * Tri_bool::state_count * Tri_bool::state_count) % Tri_bool::state_count),
+				Tri_bool::from_index(key / (Tri_bool::state_count * Tri_bool::state_count * Tri_bool::state_count * Tri_bool::state_count) % Tri_bool::state_count),
+				Tri_bool::from_index(key / (Tri_bool::state_count * Tri_bool::state_count * Tri_bool::state_count) % Tri_bool::state_count),
+				Tri_bool::from_index(key / (Tri_bool::state_count * Tri_bool::state_count) % Tri_bool::state_count),
+				Tri_bool::from_index(key / Tri_bool::state_count % Tri_bool::state_count),
+				Tri_bool::from_index(key % Tri_bool::state_count)
+			};
+		}
+
 		constexpr bool operator==(const Query& rhs) const noexcept
 		{
 			return is_light_attacking == rhs.is_light_attacking
@@ -2,13 +2,22 @@
 #define TE_ENTITY_STATES_H
 
 #include "types.h"
+#include <algorithm>
 #include <vector>
-#include <cassert>
+#include <unordered_map>
 
 namespace te {
 
 struct Game_data;
 
+inline Entity_id get_entity_id(Entity_id id)
+{
+	return id;
+}
+
+// Records live in one dense vector with an entity -> index map beside it,
+// so membership tests and removals are O(1). Removal swaps the last record
+// into the hole, so record order is not preserved across ticks.
 template <class Derived_table, class Record = Entity_id>
 class State_table {
 public:
@@ -26,35 +35,77 @@ public:
 		for (auto& record : m_entering_records) {
 			static_cast<Derived_table*>(this)->step_entering(record, data, dt);
 		}
-		m_records.insert(m_records.end(), m_entering_records.begin(), m_entering_records.end());
+		// An entity entering again while it has a record starts over: the
+		// entering record replaces the old one in its slot.
+		for (auto& record : m_entering_records) {
+			auto inserted = m_record_indices.insert({ get_entity_id(record), m_records.size() });
+			if (inserted.second) {
+				m_records.push_back(std::move(record));
+			}
+			else {
+				m_records[inserted.first->second] = std::move(record);
+			}
+		}
 		m_entering_records.clear();
 
-		for (auto& record : m_records) {
-			static_cast<Derived_table*>(this)->step_records(record, data, dt);
+		for (size_t i = 0; i < m_records.size(); ++i) {
+			static_cast<Derived_table*>(this)->step_records(m_records[i], data, dt);
 		}
 
-		if (m_pending_removals.size() > 0) {
-			auto remove = std::remove_if(m_records.begin(),
-						     m_records.end(),
-						     [this](const auto& removal_record) {
-				return std::find(m_pending_removals.begin(),
-						 m_pending_removals.end(),
-						 removal_record) != m_pending_removals.end();
-			});
-			assert(remove != m_records.end());
-			m_records.erase(remove, m_records.end());
-			m_pending_removals.clear();
+		for (auto entity_id : m_pending_removals) {
+			remove_record(entity_id);
 		}
+		m_pending_removals.clear();
 
-		for (auto& record : m_records) {
+		for (auto& record : m_exiting_records) {
 			static_cast<Derived_table*>(this)->step_exiting(record, data, dt);
 		}
 		m_exiting_records.clear();
 	}
+
+	// Drops the entity's record, entering or not, without step_exiting.
+	void erase(Entity_id entity_id)
+	{
+		m_entering_records.erase(std::remove_if(m_entering_records.begin(), m_entering_records.end(), [entity_id](const Record_type& record) {
+			return get_entity_id(record) == entity_id;
+		}), m_entering_records.end());
+		remove_record(entity_id);
+	}
+
+	// Every record list, in order, for snapshots.
+	template <typename Writer>
+	void save(Writer& writer) const
+	{
+		writer.write_vector(m_entering_records);
+		writer.write_vector(m_records);
+		writer.write_vector(m_pending_removals);
+		writer.write_vector(m_exiting_records);
+	}
+	template <typename Reader>
+	void restore(Reader& reader)
+	{
+		reader.read_vector(m_entering_records);
+		reader.read_vector(m_records);
+		reader.read_vector(m_pending_removals);
+		reader.read_vector(m_exiting_records);
+		m_record_indices.clear();
+		for (size_t i = 0; i < m_records.size(); ++i) {
+			m_record_indices.insert({ get_entity_id(m_records[i]), i });
+		}
+	}
+
+	bool contains(Entity_id entity_id) const
+	{
+		return m_record_indices.find(entity_id) != m_record_indices.end();
+	}
+	const std::vector<Record_type>& get_records() const noexcept
+	{
+		return m_records;
+	}
 protected:
 	void exit_state(const Record_type& record)
 	{
-		m_pending_removals.push_back(record);
+		m_pending_removals.push_back(get_entity_id(record));
 		m_exiting_records.push_back(record);
 	}
 private:
@@ -63,9 +114,25 @@ private:
 	inline void step_entering(const Record_type&, Game_data&, float) {}
 	inline void step_exiting(const Record_type&, Game_data&, float) {}
 
+	void remove_record(Entity_id entity_id)
+	{
+		auto found = m_record_indices.find(entity_id);
+		if (found == m_record_indices.end()) {
+			return;
+		}
+		const auto index = found->second;
+		m_record_indices.erase(found);
+		if (index != m_records.size() - 1) {
+			m_records[index] = std::move(m_records.back());
+			m_record_indices[get_entity_id(m_records[index])] = index;
+		}
+		m_records.pop_back();
+	}
+
 	std::vector<Record_type> m_entering_records;
 	std::vector<Record_type> m_records;
-	std::vector<Record_type> m_pending_removals;
+	std::unordered_map<Entity_id, size_t> m_record_indices;
+	std::vector<Entity_id> m_pending_removals;
 	std::vector<Record_type> m_exiting_records;
 };
 
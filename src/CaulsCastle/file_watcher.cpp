@@ -0,0 +1,136 @@
+#include "file_watcher.h"
+#include "utilities.h"
+
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <cassert>
+
+namespace te {
+
+namespace {
+
+#ifndef __linux__
+std::int64_t get_modified_time(const std::string& path)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) {
+		return -1;
+	}
+	return static_cast<std::int64_t>(info.st_mtime);
+}
+#endif
+
+} // namespace
+
+#ifdef __linux__
+
+File_watcher::File_watcher()
+	: m_paths{}
+	, m_fd{ inotify_init1(IN_NONBLOCK | IN_CLOEXEC) }
+	, m_directories{}
+{
+	assert(m_fd >= 0);
+}
+
+File_watcher::~File_watcher()
+{
+	if (m_fd >= 0) {
+		close(m_fd);
+	}
+}
+
+void File_watcher::watch(const std::string& path)
+{
+	if (is_watched(path)) {
+		return;
+	}
+	m_paths.insert(std::upper_bound(m_paths.begin(), m_paths.end(), path), path);
+
+	// Adding a directory twice returns the same descriptor.
+	const auto directory = get_directory(path);
+	const int wd = inotify_add_watch(m_fd, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (wd >= 0) {
+		m_directories[wd] = directory;
+	}
+}
+
+void File_watcher::poll(std::vector<std::string>& changed_paths)
+{
+	const auto first_changed = changed_paths.size();
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		const auto length = read(m_fd, buffer, sizeof(buffer));
+		if (length <= 0) {
+			assert(length == 0 || errno == EAGAIN);
+			break;
+		}
+		for (auto* p = buffer; p < buffer + length;) {
+			const auto& event = *reinterpret_cast<const inotify_event*>(p);
+			p += sizeof(inotify_event) + event.len;
+			auto found = m_directories.find(event.wd);
+			if (event.len == 0 || found == m_directories.end()) {
+				continue;
+			}
+			auto path = found->second + event.name;
+			if (is_watched(path)) {
+				changed_paths.push_back(std::move(path));
+			}
+		}
+	}
+	std::sort(changed_paths.begin() + first_changed, changed_paths.end());
+	changed_paths.erase(std::unique(changed_paths.begin() + first_changed, changed_paths.end()), changed_paths.end());
+}
+
+#else
+
+File_watcher::File_watcher()
+	: m_paths{}
+	, m_modified_times{}
+	, m_last_poll{}
+{}
+
+File_watcher::~File_watcher() = default;
+
+void File_watcher::watch(const std::string& path)
+{
+	if (is_watched(path)) {
+		return;
+	}
+	auto it = std::upper_bound(m_paths.begin(), m_paths.end(), path);
+	m_modified_times.insert(m_modified_times.begin() + (it - m_paths.begin()), get_modified_time(path));
+	m_paths.insert(it, path);
+}
+
+void File_watcher::poll(std::vector<std::string>& changed_paths)
+{
+	const auto now = std::chrono::steady_clock::now();
+	if (now - m_last_poll < std::chrono::milliseconds{ 500 }) {
+		return;
+	}
+	m_last_poll = now;
+	for (size_t i = 0; i < m_paths.size(); ++i) {
+		const auto modified_time = get_modified_time(m_paths[i]);
+		if (modified_time != m_modified_times[i]) {
+			m_modified_times[i] = modified_time;
+			// A file being replaced may be missing for a moment.
+			if (modified_time >= 0) {
+				changed_paths.push_back(m_paths[i]);
+			}
+		}
+	}
+}
+
+#endif
+
+bool File_watcher::is_watched(const std::string& path) const
+{
+	return std::binary_search(m_paths.begin(), m_paths.end(), path);
+}
+
+} // namespace te
@@ -0,0 +1,43 @@
+#ifndef TE_FILE_WATCHER_H
+#define TE_FILE_WATCHER_H
+
+#include "types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace te {
+
+// Reports watched files that were written since the last poll. On Linux
+// this reads inotify events for the files' directories, which also catches
+// editors that save by renaming a new file over the old one; elsewhere it
+// compares modification times, at most twice a second.
+class File_watcher {
+public:
+	File_watcher();
+	~File_watcher();
+	File_watcher(const File_watcher&) = delete;
+	File_watcher& operator=(const File_watcher&) = delete;
+
+	void watch(const std::string& path);
+	bool is_watched(const std::string& path) const;
+
+	// Never blocks. Appends each changed path once, spelled as given to
+	// watch().
+	void poll(std::vector<std::string>& changed_paths);
+private:
+	std::vector<std::string> m_paths;
+#ifdef __linux__
+	int m_fd;
+	flat_map<int, std::string> m_directories;
+#else
+	std::vector<std::int64_t> m_modified_times;
+	std::chrono::steady_clock::time_point m_last_poll;
+#endif
+};
+
+} // namespace te
+
+#endif
@@ -1,12 +1,20 @@
 #include "game.h"
 #include "game_data.h"
 #include "xbox_controller.h"
+#include "sprite_batch.h"
+#include "system_scheduler.h"
+#include "level_streamer.h"
+#include "render_frame.h"
+#include "profiler.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/transform.hpp>
 #include <Box2D/Box2D.h>
 
 #include <type_traits>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace te {
 
@@ -51,28 +59,32 @@ void input_game(Game_data& data, const SDL_Event& evt)
 	}
 }
 
-static inline void step_controllers(Game_data& data)
+static inline void sample_controllers(const Game_data& data, Player_inputs& inputs)
 {
 	for (const auto& controller_pair : data.controllers) {
 		const auto player_id = controller_pair.first;
-		const auto& controllermap = data.controllermaps[player_id];
-		auto& input = data.inputs[player_id];
+		const auto& controllermap = data.controllermaps.at(player_id);
+		auto& input = inputs[player_id];
 
-		input.x_movement = SDL_GameControllerGetAxis(controller_pair.second.get(), data.controllermaps[player_id].x_movement) / 32767.f;
+		input.x_movement = SDL_GameControllerGetAxis(controller_pair.second.get(), controllermap.x_movement) / 32767.f;
 		if (std::abs(input.x_movement) < 0.3f) input.x_movement = 0;
-		input.y_movement = SDL_GameControllerGetAxis(controller_pair.second.get(), data.controllermaps[player_id].y_movement) / 32767.f;
+		input.y_movement = SDL_GameControllerGetAxis(controller_pair.second.get(), controllermap.y_movement) / 32767.f;
 		if (std::abs(input.y_movement) < 0.3f) input.y_movement = 0;
 	}
 }
 
-static inline void step_keyboard(Game_data& data)
+static inline void sample_keyboard(const Game_data& data, Player_inputs& inputs)
 {
 	if (data.controllers.find(0) != data.controllers.end()) {
 		return;
 	}
+	auto keymap_found = data.keymaps.find(0);
+	if (keymap_found == data.keymaps.end()) {
+		return;
+	}
 
-	const auto& keymap = data.keymaps[0];
-	auto& input = data.inputs[0];
+	const auto& keymap = keymap_found->second;
+	auto& input = inputs[0];
 	const auto* key_states = SDL_GetKeyboardState(NULL);
 
 	input.x_movement = (float)key_states[keymap.right] - key_states[keymap.left];
@@ -84,20 +96,56 @@ static inline void step_keyboard(Game_data& data)
 	}
 }
 
+void sample_inputs(const Game_data& data, Player_inputs& inputs)
+{
+	inputs.clear();
+	sample_controllers(data, inputs);
+	sample_keyboard(data, inputs);
+}
+
+void input_game(Game_data& data, const Player_inputs& inputs)
+{
+	for (const auto& input_pair : inputs) {
+		auto& input = data.inputs[input_pair.first];
+		input.x_movement = input_pair.second.x_movement;
+		input.y_movement = input_pair.second.y_movement;
+	}
+}
+
+static const size_t step_chunk_size = 256;
+
 static inline void step_velocities(Game_data& data, float dt)
 {
-	for (auto& heading_pair : data.headings) {
-		const auto entity_id = heading_pair.first;
-		const auto speed = data.speeds[entity_id];
-		const auto velocity = speed * heading_pair.second;
-
-		auto found = data.physics_manager.find_rigid_body(entity_id);
-		if (found != data.physics_manager.end()) {
-			found->second->SetLinearVelocity({ velocity.x, velocity.y });
-		}
-		else {
-			data.positions[entity_id] += (float)dt * velocity;
+	std::mutex unplaced_mutex;
+	std::vector<std::pair<Entity_id, vec2>> unplaced_moves;
+
+	data.system_scheduler->parallel_for(data.headings.size(), step_chunk_size, [&](size_t first, size_t last) {
+		for (auto heading_it = data.headings.begin() + first; heading_it != data.headings.begin() + last; ++heading_it) {
+			const auto entity_id = heading_it->first;
+			const auto speed_found = data.speeds.find(entity_id);
+			const auto speed = speed_found != data.speeds.end() ? speed_found->second : 0.f;
+			const auto velocity = speed * heading_it->second;
+
+			auto found = data.physics_manager.find_rigid_body(entity_id);
+			if (found != data.physics_manager.end()) {
+				found->second->SetLinearVelocity({ velocity.x, velocity.y });
+				continue;
+			}
+			auto position_found = data.positions.find(entity_id);
+			if (position_found != data.positions.end()) {
+				position_found->second += (float)dt * velocity;
+			}
+			else {
+				std::lock_guard<std::mutex> lock{ unplaced_mutex };
+				unplaced_moves.push_back({ entity_id, (float)dt * velocity });
+			}
 		}
+	});
+
+	// Inserting shifts the flat_map, so entities without a position yet are
+	// placed once the chunks are done.
+	for (const auto& move : unplaced_moves) {
+		data.positions[move.first] += move.second;
 	}
 }
 
@@ -116,77 +164,74 @@ static inline void step_rigid_bodies(Game_data& data)
 
 static inline void step_animations(Game_data& data, float dt)
 {
-	for (auto& animation_pair : data.entity_animations2) {
-		auto entity_id = animation_pair.first;
-		auto& entity_animation = animation_pair.second;
-		auto& animation = data.animations2.get(animation_pair.second.id);
-
-		entity_animation.t += dt * animation.delay_unit;
-		auto& curr_frame = animation.frames[entity_animation.frame_index];
-		if (entity_animation.t > curr_frame.delay) {
-			entity_animation.t -= curr_frame.delay;
-			entity_animation.frame_index = (entity_animation.frame_index + 1) % animation.frames.size();
+	data.system_scheduler->parallel_for(data.entity_animations2.size(), step_chunk_size, [&data, dt](size_t first, size_t last) {
+		for (auto animation_it = data.entity_animations2.begin() + first; animation_it != data.entity_animations2.begin() + last; ++animation_it) {
+			auto entity_id = animation_it->first;
+			auto& entity_animation = animation_it->second;
+			auto& animation = data.animations2.get(entity_animation.id);
+
+			entity_animation.t += dt * animation.delay_unit;
+			auto& curr_frame = animation.frames[entity_animation.frame_index];
+			if (entity_animation.t > curr_frame.delay) {
+				entity_animation.t -= curr_frame.delay;
+				entity_animation.frame_index = (entity_animation.frame_index + 1) % animation.frames.size();
+			}
+
+			auto found = data.entity_meshes2.find(entity_id);
+			assert(found != data.entity_meshes2.end());
+			found->second.resource_id = animation.frames[entity_animation.frame_index].mesh_id;
 		}
+	});
+}
 
-		auto found = std::find_if(data.entity_meshes2.begin(), data.entity_meshes2.end(), [entity_id](auto& mesh_pair) {
-			return mesh_pair.first == entity_id;
-		});
-		assert(found != data.entity_meshes2.end());
-		found->second.resource_id = animation.frames[entity_animation.frame_index].mesh_id;
+// The union of the collision masks of every team bit set in `team_mask`.
+static inline Team_mask get_collision_mask(const Game_data& data, Team_mask team_mask)
+{
+	Team_mask collision_mask = 0;
+	for (Team_mask bits = team_mask; bits != 0; bits &= bits - 1) {
+		const Team_mask team_bit = bits & (~bits + 1);
+		auto found = data.team_masks.find(static_cast<int>(team_bit));
+		if (found != data.team_masks.end()) {
+			collision_mask |= found->second;
+		}
 	}
+	return collision_mask;
 }
 
 static inline void step_attack_queries(Game_data& data)
 {
-	struct Callback : public b2QueryCallback {
-		Entity_id attacker_id;
-		Team_mask collision_mask;
-		int damage;
-		Game_data& data;
-
-		Callback(Entity_id attacker_id, Team_mask collision_mask, int damage, Game_data& data)
-			: attacker_id{ attacker_id }
-			, collision_mask{ collision_mask }
-			, damage{ damage }
-			, data{ data }
-		{}
-
-		bool ReportFixture(b2Fixture* fixture) override
-		{
-			Entity_id id = *static_cast<Entity_id*>(fixture->GetBody()->GetUserData());
-			if (id != attacker_id && fixture->IsSensor()) {
-				Team_mask team_mask = data.entity_team_masks[id];
-				if (collision_mask & team_mask) {
-					data.pending_hits.push_back({ id, damage });
-				}
-			}
-			return true;
-		}
-	};
+	if (data.attack_queries.empty()) {
+		return;
+	}
 
+	auto& broadphase = data.hitbox_broadphase;
+	broadphase.gather_hurtboxes(data.physics_manager, data.entity_team_masks);
 	for (const auto& query : data.attack_queries) {
-		Entity_id attacker_id = query.entity_id;
-		auto attacker_mask_iter = data.entity_team_masks.find(attacker_id);
+		auto attacker_mask_iter = data.entity_team_masks.find(query.entity_id);
 		assert(attacker_mask_iter != data.entity_team_masks.end());
-		Team_mask attacker_mask = attacker_mask_iter->second;
-		Team_mask collision_mask = 0;
-		unsigned team_bit = 1;
-		while (team_bit <= attacker_mask) {
-			if (team_bit & attacker_mask) {
-				collision_mask |= data.team_masks[team_bit];
-				team_bit = team_bit << 1;
-			}
-		}
-
-		Callback query_callback{ attacker_id, collision_mask, query.damage, data };
-		data.physics_manager.query_aabb(query_callback, query.aabb);
+		const vec2 min{ query.aabb.lowerBound.x, query.aabb.lowerBound.y };
+		const vec2 max{ query.aabb.upperBound.x, query.aabb.upperBound.y };
+		broadphase.add_attack(query.entity_id, min, max, get_collision_mask(data, attacker_mask_iter->second), query.damage);
 	}
+	broadphase.find_hits([&data](Entity_id, Entity_id target_id, int damage) {
+		data.pending_hits.push_back({ target_id, damage });
+	});
 	data.attack_queries.clear();
 }
 
 static inline void step_pending_hits(Game_data& data)
 {
 	for (auto hit : data.pending_hits) {
+		auto stats_found = data.stats.find(hit.entity_id);
+		if (stats_found == data.stats.end()) {
+			continue;
+		}
+		auto& vitality = stats_found->second.vitality;
+		const bool was_alive = vitality > 0;
+		vitality -= hit.damage;
+		if (was_alive && vitality <= 0) {
+			despawn(data, hit.entity_id);
+		}
 	}
 	data.pending_hits.clear();
 }
@@ -211,68 +256,129 @@ static inline void clear_inputs(Game_data& data)
 	}
 }
 
-void step_game(Game_data& data, float dt)
+static std::unique_ptr<System_scheduler> make_system_scheduler()
 {
-	step_controllers(data);
-	step_keyboard(data);
-	data.normal_state_table.step(data, dt);
-	data.light_attack_state_table.step(data, dt);
-	step_velocities(data, dt);
-	step_physics_world(data, dt);
-	step_rigid_bodies(data);
-	step_animations(data, dt);
-	step_attack_queries(data);
-	step_pending_hits(data);
-	set_view(data);
-	clear_inputs(data);
+	auto p_scheduler = std::make_unique<System_scheduler>();
+	auto& scheduler = *p_scheduler;
+	scheduler.add("normal_state_table",
+		      Inputs_component | Resources_component,
+		      Avatars_component | Max_speeds_component | Speeds_component | Headings_component
+		      | Animation_groups_component | Animations_component | State_tables_component,
+		      [](Game_data& data, float dt) {
+		data.normal_state_table.step(data, dt);
+	});
+	scheduler.add("light_attack_state_table",
+		      Meshes_component | Resources_component,
+		      Speeds_component | Headings_component | Positions_component | Stats_component
+		      | Animation_groups_component | Animations_component | State_tables_component | Attack_queries_component,
+		      [](Game_data& data, float dt) {
+		data.light_attack_state_table.step(data, dt);
+	});
+	scheduler.add("step_velocities",
+		      Headings_component | Speeds_component,
+		      Positions_component | Physics_component,
+		      step_velocities);
+	scheduler.add("step_physics_world", 0, Physics_component, step_physics_world);
+	scheduler.add("step_rigid_bodies", Physics_component, Positions_component, [](Game_data& data, float) {
+		step_rigid_bodies(data);
+	});
+	scheduler.add("step_animations",
+		      Resources_component,
+		      Animations_component | Meshes_component,
+		      step_animations);
+	scheduler.add("step_attack_queries",
+		      Physics_component,
+		      Team_masks_component | Attack_queries_component | Pending_hits_component,
+		      [](Game_data& data, float) {
+		step_attack_queries(data);
+	});
+	scheduler.add("step_pending_hits", 0, Pending_hits_component | Stats_component | Despawns_component, [](Game_data& data, float) {
+		step_pending_hits(data);
+	});
+	scheduler.add("set_view", Avatars_component | Positions_component, View_component, [](Game_data& data, float) {
+		set_view(data);
+	});
+	scheduler.add("clear_inputs", 0, Inputs_component, [](Game_data& data, float) {
+		clear_inputs(data);
+	});
+	// Touches every component, so it runs after all other steps.
+	scheduler.add("despawn_entities", 0, All_components, [](Game_data& data, float) {
+		despawn_entities(data);
+	});
+	return p_scheduler;
 }
 
-namespace {
-
-template <typename Resource_component>
-inline void draw(Game_data& game_data, Resource_component& render_data, const glm::mat4& model_view, const glm::mat4& post_translate)
+void step_game(Game_data& data, float dt)
 {
-	std::sort(std::begin(render_data), std::end(render_data), [](auto& a, auto& b) {
-		return a.second.draw_order < b.second.draw_order;
-	});
-
-	for (auto& data_pair : render_data) {
-		auto position = game_data.positions[data_pair.first];
-		glLoadMatrixf(glm::value_ptr(model_view
-					     * glm::translate(glm::vec3{ position.x, position.y, 0 })
-					     * post_translate
-					     * data_pair.second.transform));
-		draw(get_resource(game_data, data_pair.second.resource_id));
+	TE_PROFILE_ZONE("step_game");
+	if (!data.system_scheduler) {
+		data.system_scheduler = make_system_scheduler();
 	}
+	data.system_scheduler->set_serial(data.serial_stepping);
+	data.system_scheduler->run(data, dt);
 }
 
-template <typename Resource>
-inline Resource& get_resource(Game_data& game_data, Resource_id<Resource> id);
-template <>
-inline Mesh2& get_resource(Game_data& game_data, Resource_id<Mesh2> id)
+void stream_level(Game_data& data)
 {
-	return game_data.meshes2.get(id);
+	auto avatar_found = data.avatars.find(0);
+	if (data.level_streamer && avatar_found != data.avatars.end()) {
+		data.level_streamer->update(data.positions[avatar_found->second], data);
+	}
 }
-template <>
-inline Mesh3& get_resource(Game_data& game_data, Resource_id<Mesh3> id)
+
+namespace {
+
+void submit(Sprite_batch& sprite_batch, const Render_frame& frame, const std::vector<Render_frame::Sprite>& sprites, float alpha)
 {
-	return game_data.meshes3.get(id);
+	for (const auto& sprite : sprites) {
+		sprite_batch.submit(frame.vertices.data() + sprite.first_vertex,
+				    sprite.vertex_count,
+				    sprite.texture_id,
+				    sprite.mode,
+				    sprite.draw_order,
+				    glm::mix(sprite.previous_position, sprite.position, alpha));
+	}
 }
 
 } // namespace
 
-void draw_game(Game_data& data)
+void draw_game(Game_data& data, const Render_frame& frame, float alpha)
 {
+	TE_PROFILE_ZONE("draw_game");
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
 	glOrtho(0, data.resolution.x / data.pixel_to_world_scale.x, data.resolution.y / data.pixel_to_world_scale.y, 0, -10000.0, 10000.0);
 
+	// View matrices only translate, so mixing them element-wise is exact.
+	const auto view_matrix = frame.previous_view_matrix + (frame.view_matrix - frame.previous_view_matrix) * alpha;
 	glMatrixMode(GL_MODELVIEW);
-	auto pixel_scale = glm::scale(glm::vec3(1 / data.pixel_to_world_scale.x,
-					       1 / data.pixel_to_world_scale.y,
-					       1));
-	draw(data, data.entity_meshes3, data.view_matrix, pixel_scale);
-	draw(data, data.entity_meshes2, data.view_matrix, pixel_scale);
+	glLoadMatrixf(glm::value_ptr(view_matrix));
+	auto& sprite_batch = *data.sprite_batch;
+	sprite_batch.reset_stats();
+
+	{
+		TE_PROFILE_ZONE("draw_meshes3");
+		submit(sprite_batch, frame, frame.sprites3, alpha);
+		sprite_batch.flush();
+	}
+
+	{
+		TE_PROFILE_ZONE("draw_tile_chunks");
+		const vec2 view_min{ -view_matrix[3].x, -view_matrix[3].y };
+		const vec2 view_max{ view_min + data.resolution / data.pixel_to_world_scale };
+		data.tile_chunk_stats = {
+			submit_visible_tile_chunks(data.tile_chunks, view_min, view_max, sprite_batch),
+			data.tile_chunks.size()
+		};
+		if (data.level_streamer) {
+			data.tile_chunk_stats.visible += data.level_streamer->submit_visible(view_min, view_max, sprite_batch);
+			data.tile_chunk_stats.total += data.level_streamer->get_chunk_count();
+		}
+	}
+
+	TE_PROFILE_ZONE("draw_meshes2");
+	submit(sprite_batch, frame, frame.sprites2, alpha);
+	sprite_batch.flush();
 }
 
 } // namespace te
@@ -1,15 +1,34 @@
 #ifndef TE_GAME_H
 #define TE_GAME_H
 
+#include "types.h"
+#include "input.h"
+
 #include <SDL.h>
 
 namespace te {
 
 struct Game_data;
+struct Render_frame;
+
+// Movement held on each player's controller or keyboard.
+using Player_inputs = flat_map<Player_id, Player_input>;
 
 void input_game(Game_data& data, const SDL_Event&);
+// Sets the movement of each player in `inputs`.
+void input_game(Game_data& data, const Player_inputs& inputs);
+// Reads controller axes and key states into `inputs`. SDL updates them in
+// SDL_PollEvent without locking, so this runs on the thread that polls,
+// after it. Reads only the controllers and maps set up before the
+// simulation starts.
+void sample_inputs(const Game_data& data, Player_inputs& inputs);
 void step_game(Game_data& data, float dms);
-void draw_game(Game_data& data);
+// Loads and unloads level regions around player 0's avatar. Regions make
+// GL buffers, so this runs on the thread that draws, between steps.
+void stream_level(Game_data& data);
+// Draws `frame` with entities and the view `alpha` of the way from the
+// tick before it to its own.
+void draw_game(Game_data& data, const Render_frame& frame, float alpha);
 
 } // namespace te
 
@@ -1,4 +1,7 @@
 #include "game_data.h"
+#include "sprite_batch.h"
+#include "system_scheduler.h"
+#include "level_streamer.h"
 
 #include <glm/gtx/transform.hpp>
 #include <Box2D/Box2D.h>
@@ -14,8 +17,20 @@ Entity_id Entity_manager::get_free_id()
 	return m_next_id++;
 }
 
+Entity_id Entity_manager::get_next_id() const noexcept
+{
+	return m_next_id;
+}
+
+void Entity_manager::restore_next_id(Entity_id next_id) noexcept
+{
+	m_next_id = next_id;
+}
+
 Game_data::Game_data()
 	: physics_manager{ *this }
+	, serial_stepping{ false }
+	, headless{ false }
 {}
 Game_data::~Game_data() = default;
 
@@ -33,11 +48,9 @@ void set_animation(Game_data& data, Entity_id entity_id, Resource_id<Animation2>
 	}
 
 	auto mesh_id = data.animations2.get(animation_id).frames[0].mesh_id;
-	auto mesh_found = std::find_if(data.entity_meshes2.begin(), data.entity_meshes2.end(), [entity_id](auto& mesh) {
-		return mesh.first == entity_id;
-	});
+	auto mesh_found = data.entity_meshes2.find(entity_id);
 	if (mesh_found == data.entity_meshes2.end()) {
-		data.entity_meshes2.push_back({ entity_id, { mesh_id } });
+		data.entity_meshes2.insert({ entity_id, { mesh_id } });
 	}
 	else {
 		mesh_found->second.resource_id = mesh_id;
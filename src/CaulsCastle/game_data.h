@@ -15,10 +15,14 @@
 #include "mappings.h"
 #include "physics_manager.h"
 #include "collider.h"
+#include "tile_chunks.h"
+#include "texture_loader.h"
+#include "hitbox_broadphase.h"
 
 #include <Box2D/Box2D.h>
 #include <boost/container/flat_map.hpp>
 
+#include <map>
 #include <memory>
 #include <vector>
 #include <type_traits>
@@ -26,10 +30,17 @@
 
 namespace te {
 
+class Sprite_batch;
+class System_scheduler;
+class Level_streamer;
+
 class Entity_manager {
 public:
 	Entity_manager();
 	Entity_id get_free_id();
+	// Ids from the restored one on are handed out again.
+	Entity_id get_next_id() const noexcept;
+	void restore_next_id(Entity_id next_id) noexcept;
 private:
 	Entity_id m_next_id;
 };
@@ -43,7 +54,11 @@ struct Game_data {
 	flat_map<std::string, Animation_group_record> animation_group_table;
 	std::vector<Animation_group_type_record> animation_group_type_table;
 	std::vector<Collider_record> collider_table;
-	flat_map<std::string, Entity_xml> entity_table;
+	// Node based, so the Entity_xml that prefabs and entities point to stay
+	// put as entities are loaded later, e.g. by a hot reload.
+	std::map<std::string, Entity_xml> entity_table;
+	// Compiled on first spawn; boxed so references stay valid as it grows.
+	flat_map<const Entity_xml*, std::unique_ptr<Entity_prefab>> entity_prefabs;
 
 	flat_map<std::string, Resource_record<Texture>> texture_table;
 	flat_map<std::string, Resource_record<Mesh2>> mesh2_table;
@@ -56,6 +71,8 @@ struct Game_data {
 
 	Physics_manager physics_manager;
 
+	// Outlives textures, which cancel their pending uploads as they go.
+	std::unique_ptr<Texture_loader> texture_loader;
 	Resource_holder<Texture> textures;
 	Resource_holder<Mesh2> meshes2;
 	Resource_holder<Mesh3> meshes3;
@@ -64,6 +81,8 @@ struct Game_data {
 	flat_map<int, Team_mask> team_masks;
 
 	Entity_manager entity_manager;
+	// What each entity was made from, so it can be made again.
+	component<Entity_id, const Entity_xml*> entity_xmls;
 
 	flat_map<Player_id, std::unique_ptr<SDL_GameController, decltype(&SDL_GameControllerClose)>> controllers;
 	flat_map<Player_id, Controllermap> controllermaps;
@@ -85,7 +104,8 @@ struct Game_data {
 	};
 	component<Entity_id, Stats> stats;
 
-	component<Entity_id, Entity_animation> entity_animation_groups;
+	// Shared by every entity of a prefab.
+	component<Entity_id, const Entity_animation*> entity_animation_groups;
 
 	Normal_state_table normal_state_table;
 	Light_attack_state_table light_attack_state_table;
@@ -96,11 +116,13 @@ struct Game_data {
 		int damage;
 	};
 	std::vector<Attack_query> attack_queries;
+	Hitbox_broadphase hitbox_broadphase;
 	struct Pending_hits {
 		Entity_id entity_id;
 		int damage;
 	};
 	std::vector<Pending_hits> pending_hits;
+	std::vector<Entity_id> despawn_queue;
 
 	template <typename Mesh>
 	struct Animation_data {
@@ -128,8 +150,20 @@ struct Game_data {
 	Multi_component<Entity_id, Render_data<Mesh2>> entity_meshes2;
 	Multi_component<Entity_id, Render_data<Mesh3>> entity_meshes3;
 
+	std::vector<Tile_chunk> tile_chunks;
+	Tile_chunk_stats tile_chunk_stats;
+	std::unique_ptr<Level_streamer> level_streamer;
+
 	glm::mat4 view_matrix;
 
+	std::unique_ptr<Sprite_batch> sprite_batch;
+
+	std::unique_ptr<System_scheduler> system_scheduler;
+	bool serial_stepping;
+	// Skips texture uploads and tile chunk buffers so the simulation can be
+	// loaded and stepped without a GL context.
+	bool headless;
+
 	Game_data();
 	~Game_data();
 };
@@ -158,8 +192,40 @@ Resource_id<Resource> get_or_create(const std::string& name, Game_data& data)
 	return resource_id;
 }
 
+// Frees the named resource and forgets its id. Ids still held elsewhere go
+// stale rather than dangling; resources built from this one are untouched.
+template <typename Resource>
+void unload(const std::string& name, Game_data& data)
+{
+	auto& resource_table = detail::get_resource_table<Resource>(data);
+	auto resource_found = resource_table.find(name);
+	if (resource_found == resource_table.end()) {
+		return;
+	}
+	detail::get_resource_holder<Resource>(data).erase(resource_found->second.id);
+	resource_table.erase(resource_found);
+}
+
 namespace detail {
 
+template <typename Resource>
+inline auto& get_resource_holder(Game_data& data);
+template <>
+inline auto& get_resource_holder<Texture>(Game_data& data)
+{
+	return data.textures;
+}
+template <>
+inline auto& get_resource_holder<Mesh2>(Game_data& data)
+{
+	return data.meshes2;
+}
+template <>
+inline auto& get_resource_holder<Animation2>(Game_data& data)
+{
+	return data.animations2;
+}
+
 template <typename Resource>
 inline auto& get_resource_table(Game_data& data);
 template <>
@@ -196,43 +262,55 @@ inline auto& get_data_table<Animation2>(Game_data& data)
 	return data.animation_table;
 }
 
+inline void add_colliders(const Sprite_record& record, Resource_id<Mesh2> mesh_id, Game_data& data)
+{
+	const vec2 origin{ record.w * record.px, record.h * record.py };
+	for (size_t i = record.first_collider; i < record.first_collider + record.collider_count; ++i) {
+		const auto& collider_record = data.collider_table[i];
+		data.colliders.push_back({ mesh_id, collider_record.x - (int)origin.x, collider_record.y - (int)origin.y, collider_record.w, collider_record.h });
+	}
+}
+
+inline Animation<Mesh2> make_animation(const Animation_record& record, Game_data& data)
+{
+	assert(record.frame_count > 0);
+	const auto first = data.animation_frame_table.begin() + record.first_frame;
+	const auto last = first + record.frame_count;
+	Animation<Mesh2> animation{ {}, first->delay_unit };
+	for (auto frame = first; frame != last; ++frame) {
+		auto mesh_id = get_or_create<Mesh2>(frame->sprite_filename, data);
+		animation.frames.push_back({ frame->delay, mesh_id });
+	}
+	return animation;
+}
+
 template <typename Resource, typename Record>
 inline Resource_id<Resource> create_resource(const Record& record, Game_data& data);
 template <>
 inline Resource_id<Texture> create_resource(const Image_record& record, Game_data& data)
 {
-	return data.textures.insert({ load_texture32(data.image_root + record.filename) });
+	if (data.headless) {
+		return data.textures.insert(Texture{ 0 });
+	}
+	return data.textures.insert({ load_texture(data.texture_loader.get(), data.image_root + record.filename), data.texture_loader.get() });
 }
 template <>
 inline Resource_id<Mesh2> create_resource(const Sprite_record& record, Game_data& data)
 {
 	auto texture_id = get_or_create<Texture>(record.image_filename, data);
-	auto mesh_id = data.meshes2.insert(make_mesh(record, data.textures.get(texture_id).get_texture_id()));
-
-	std::vector<decltype(data.collider_table)::value_type> colliders{};
-	std::for_each(data.collider_table.begin(), data.collider_table.end(), [record, mesh_id, &data](const auto& collider_record) {
-		if (collider_record.image_name == record.filename) {
-			vec2 origin{ record.w * record.px, record.h * record.py };
-			data.colliders.push_back({ mesh_id, collider_record.x - (int)origin.x, collider_record.y - (int)origin.y, collider_record.w, collider_record.h });
-		}
-	});
-
+	auto image_found = data.image_table.find(record.image_filename);
+	assert(image_found != data.image_table.end());
+	auto mesh_id = data.meshes2.insert(make_mesh(record,
+						     data.textures.get(texture_id).get_texture_id(),
+						     pow2up(image_found->second.width),
+						     pow2up(image_found->second.height)));
+	add_colliders(record, mesh_id, data);
 	return mesh_id;
 }
 template <>
 inline Resource_id<Animation2> create_resource(const Animation_record& record, Game_data& data)
 {
-	std::vector<decltype(Game_data::animation_frame_table)::value_type> frames;
-	std::copy_if(data.animation_frame_table.begin(), data.animation_frame_table.end(), std::back_inserter(frames), [&record](auto& frame_record) {
-		return frame_record.animation_filename == record.filename;
-	});
-	assert(frames.size() > 0);
-	Animation<Mesh2> animation{ {}, frames[0].delay_unit };
-	for (auto& frame : frames) {
-		auto mesh_id = get_or_create<Mesh2>(frame.sprite_filename, data);
-		animation.frames.push_back({ frame.delay, mesh_id });
-	}
-	return data.animations2.insert(std::move(animation));
+	return data.animations2.insert(make_animation(record, data));
 }
 
 } // namespace detail
@@ -0,0 +1,93 @@
+#include "gl_buffer.h"
+
+#include <SDL.h>
+
+#include <cassert>
+
+namespace te {
+
+namespace {
+
+struct Buffer_functions {
+	PFNGLGENBUFFERSPROC gen_buffers;
+	PFNGLDELETEBUFFERSPROC delete_buffers;
+	PFNGLBINDBUFFERPROC bind_buffer;
+	PFNGLBUFFERDATAPROC buffer_data;
+	PFNGLBUFFERSUBDATAPROC buffer_sub_data;
+
+	Buffer_functions()
+		: gen_buffers{ reinterpret_cast<PFNGLGENBUFFERSPROC>(SDL_GL_GetProcAddress("glGenBuffers")) }
+		, delete_buffers{ reinterpret_cast<PFNGLDELETEBUFFERSPROC>(SDL_GL_GetProcAddress("glDeleteBuffers")) }
+		, bind_buffer{ reinterpret_cast<PFNGLBINDBUFFERPROC>(SDL_GL_GetProcAddress("glBindBuffer")) }
+		, buffer_data{ reinterpret_cast<PFNGLBUFFERDATAPROC>(SDL_GL_GetProcAddress("glBufferData")) }
+		, buffer_sub_data{ reinterpret_cast<PFNGLBUFFERSUBDATAPROC>(SDL_GL_GetProcAddress("glBufferSubData")) }
+	{
+		assert(gen_buffers && delete_buffers && bind_buffer && buffer_data && buffer_sub_data);
+	}
+};
+
+const Buffer_functions& gl()
+{
+	static const Buffer_functions functions{};
+	return functions;
+}
+
+} // namespace
+
+Gl_buffer::Gl_buffer()
+	: m_buffer_id{ 0 }
+{
+	gl().gen_buffers(1, &m_buffer_id);
+}
+
+Gl_buffer::~Gl_buffer()
+{
+	destroy_buffer();
+}
+
+Gl_buffer::Gl_buffer(Gl_buffer&& rhs) noexcept
+	: m_buffer_id{ rhs.m_buffer_id }
+{
+	rhs.m_buffer_id = 0;
+}
+
+Gl_buffer& Gl_buffer::operator=(Gl_buffer&& rhs) noexcept
+{
+	destroy_buffer();
+	m_buffer_id = rhs.m_buffer_id;
+	rhs.m_buffer_id = 0;
+	return *this;
+}
+
+void Gl_buffer::bind(GLenum target) const
+{
+	gl().bind_buffer(target, m_buffer_id);
+}
+
+void Gl_buffer::unbind(GLenum target)
+{
+	gl().bind_buffer(target, 0);
+}
+
+void Gl_buffer::upload(GLenum target, const void* data, size_t size, GLenum usage)
+{
+	gl().buffer_data(target, size, data, usage);
+}
+
+void Gl_buffer::stream(GLenum target, const void* data, size_t size)
+{
+	gl().buffer_data(target, size, nullptr, GL_STREAM_DRAW);
+	gl().buffer_sub_data(target, 0, size, data);
+}
+
+GLuint Gl_buffer::get_buffer_id() const
+{
+	return m_buffer_id;
+}
+
+void Gl_buffer::destroy_buffer() noexcept
+{
+	if (m_buffer_id > 0) gl().delete_buffers(1, &m_buffer_id);
+}
+
+} // namespace te
@@ -0,0 +1,40 @@
+#ifndef TE_GL_BUFFER_H
+#define TE_GL_BUFFER_H
+
+#include <SDL_opengl.h>
+
+#include <cstddef>
+
+namespace te {
+
+// Owns a GL buffer object. Buffer entry points are beyond GL 1.1, so they
+// are resolved through SDL_GL_GetProcAddress the first time a buffer is
+// created; a current GL context is required.
+class Gl_buffer {
+public:
+	Gl_buffer();
+	~Gl_buffer();
+	Gl_buffer(Gl_buffer&& rhs) noexcept;
+	Gl_buffer& operator=(Gl_buffer&& rhs) noexcept;
+	Gl_buffer(const Gl_buffer&) = delete;
+	Gl_buffer& operator=(const Gl_buffer&) = delete;
+
+	void bind(GLenum target = GL_ARRAY_BUFFER) const;
+	static void unbind(GLenum target = GL_ARRAY_BUFFER);
+
+	// Replaces the whole store; the buffer must be bound to `target`.
+	void upload(GLenum target, const void* data, size_t size, GLenum usage);
+	// Detaches the old store before writing so the driver never waits on
+	// draws still reading it; the buffer must be bound to `target`.
+	void stream(GLenum target, const void* data, size_t size);
+
+	GLuint get_buffer_id() const;
+private:
+	void destroy_buffer() noexcept;
+
+	GLuint m_buffer_id;
+};
+
+} // namespace te
+
+#endif
@@ -0,0 +1,164 @@
+#include "hitbox_broadphase.h"
+#include "physics_manager.h"
+
+#include <Box2D/Box2D.h>
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+namespace te {
+
+Hitbox_broadphase::Hitbox_broadphase()
+	: m_hurtboxes{}
+	, m_team_groups{}
+	, m_attacks{}
+	, m_attack_damages{}
+	, m_hits{}
+	, m_indices{}
+	, m_sorted{}
+{}
+
+void Hitbox_broadphase::gather_hurtboxes(const Physics_manager& physics_manager, const component<Entity_id, Team_mask>& team_masks)
+{
+	m_hurtboxes.clear();
+	for (const auto& body_pair : physics_manager) {
+		auto mask_found = team_masks.find(body_pair.first);
+		if (mask_found == team_masks.end() || mask_found->second == 0) {
+			continue;
+		}
+		const auto& transform = body_pair.second->GetTransform();
+		for (const auto* p_fixture = body_pair.second->GetFixtureList(); p_fixture != nullptr; p_fixture = p_fixture->GetNext()) {
+			if (!p_fixture->IsSensor()) {
+				continue;
+			}
+			// GetAABB spans the fixture's sweep over the last step, so the
+			// box is taken from the shape at the body's current transform.
+			// It is widened by the margin Box2D fattens its proxies by, as
+			// world queries matched against those.
+			b2AABB aabb;
+			p_fixture->GetShape()->ComputeAABB(&aabb, transform, 0);
+			const vec2 min{ aabb.lowerBound.x - b2_aabbExtension, aabb.lowerBound.y - b2_aabbExtension };
+			const vec2 max{ aabb.upperBound.x + b2_aabbExtension, aabb.upperBound.y + b2_aabbExtension };
+			m_hurtboxes.push_back(min, max, body_pair.first, mask_found->second);
+		}
+	}
+	m_hurtboxes.sort_by_mask_and_min_x(m_indices, m_sorted);
+
+	m_team_groups.clear();
+	const auto hurtbox_count = static_cast<std::uint32_t>(m_hurtboxes.size());
+	for (std::uint32_t i = 0; i < hurtbox_count; ++i) {
+		const auto mask = m_hurtboxes.masks[i];
+		if (m_team_groups.empty() || m_team_groups.back().mask != mask) {
+			m_team_groups.push_back({ mask, i, i, 0.f });
+		}
+		auto& group = m_team_groups.back();
+		group.last = i + 1;
+		group.max_width = std::max(group.max_width, m_hurtboxes.max_x[i] - m_hurtboxes.min_x[i]);
+	}
+}
+
+void Hitbox_broadphase::add_attack(Entity_id attacker_id, vec2 min, vec2 max, Team_mask collision_mask, int damage)
+{
+	m_attacks.push_back(min, max, attacker_id, collision_mask);
+	m_attack_damages.push_back(damage);
+}
+
+size_t Hitbox_broadphase::get_hurtbox_count() const noexcept
+{
+	return m_hurtboxes.size();
+}
+
+// No hurtbox of a group is wider than its widest one, so the hurtboxes that
+// can reach an attack start between its min x less that width and its max
+// x. Each candidate is written as a hit and kept only if it passes, which
+// avoids a branch per candidate. Hits of an attack are put in body order
+// as they are found, so neither the attacks nor the hit list are sorted.
+void Hitbox_broadphase::sweep()
+{
+	m_hits.clear();
+	const auto first_min_x = m_hurtboxes.min_x.begin();
+	const auto attack_count = static_cast<std::uint32_t>(m_attacks.size());
+	for (std::uint32_t attack = 0; attack < attack_count; ++attack) {
+		const auto min_x = m_attacks.min_x[attack];
+		const auto min_y = m_attacks.min_y[attack];
+		const auto max_x = m_attacks.max_x[attack];
+		const auto max_y = m_attacks.max_y[attack];
+		const auto attacker_id = m_attacks.entity_ids[attack];
+		const auto first_hit = m_hits.size();
+		for (const auto& group : m_team_groups) {
+			if ((group.mask & m_attacks.masks[attack]) == 0) {
+				continue;
+			}
+			const auto group_first = first_min_x + group.first;
+			const auto group_last = first_min_x + group.last;
+			const auto first = static_cast<std::uint32_t>(std::lower_bound(group_first, group_last, min_x - group.max_width) - first_min_x);
+			const auto last = static_cast<std::uint32_t>(std::upper_bound(first_min_x + first, group_last, max_x) - first_min_x);
+
+			auto hit_count = m_hits.size();
+			m_hits.resize(hit_count + (last - first));
+			for (auto hurtbox = first; hurtbox < last; ++hurtbox) {
+				// Boxes that only touch count as overlapping, as in b2TestOverlap.
+				const bool overlaps = (min_x <= m_hurtboxes.max_x[hurtbox])
+					& (min_y <= m_hurtboxes.max_y[hurtbox])
+					& (m_hurtboxes.min_y[hurtbox] <= max_y)
+					& (attacker_id != m_hurtboxes.entity_ids[hurtbox]);
+				m_hits[hit_count] = { attack, hurtbox };
+				hit_count += overlaps;
+			}
+			m_hits.resize(hit_count);
+		}
+		std::sort(m_hits.begin() + first_hit, m_hits.end(), [this](const Hit& lhs, const Hit& rhs) {
+			return m_hurtboxes.orders[lhs.hurtbox] < m_hurtboxes.orders[rhs.hurtbox];
+		});
+	}
+}
+
+void Hitbox_broadphase::Boxes::push_back(vec2 min, vec2 max, Entity_id entity_id, Team_mask mask)
+{
+	orders.push_back(static_cast<std::uint32_t>(size()));
+	min_x.push_back(min.x);
+	min_y.push_back(min.y);
+	max_x.push_back(max.x);
+	max_y.push_back(max.y);
+	entity_ids.push_back(entity_id);
+	masks.push_back(mask);
+}
+
+// Reorders through `sorted`, whose storage is kept between ticks.
+void Hitbox_broadphase::Boxes::sort_by_mask_and_min_x(std::vector<std::uint32_t>& indices, Boxes& sorted)
+{
+	indices.resize(size());
+	std::iota(indices.begin(), indices.end(), 0);
+	std::sort(indices.begin(), indices.end(), [this](std::uint32_t lhs, std::uint32_t rhs) {
+		if (masks[lhs] != masks[rhs]) {
+			return masks[lhs] < masks[rhs];
+		}
+		return min_x[lhs] < min_x[rhs];
+	});
+
+	sorted.clear();
+	for (auto index : indices) {
+		sorted.min_x.push_back(min_x[index]);
+		sorted.min_y.push_back(min_y[index]);
+		sorted.max_x.push_back(max_x[index]);
+		sorted.max_y.push_back(max_y[index]);
+		sorted.entity_ids.push_back(entity_ids[index]);
+		sorted.masks.push_back(masks[index]);
+		sorted.orders.push_back(orders[index]);
+	}
+	std::swap(*this, sorted);
+}
+
+void Hitbox_broadphase::Boxes::clear() noexcept
+{
+	min_x.clear();
+	min_y.clear();
+	max_x.clear();
+	max_y.clear();
+	entity_ids.clear();
+	masks.clear();
+	orders.clear();
+}
+
+} // namespace te
@@ -0,0 +1,86 @@
+#ifndef TE_HITBOX_BROADPHASE_H
+#define TE_HITBOX_BROADPHASE_H
+
+#include "types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace te {
+
+class Physics_manager;
+
+// Tests a tick's attack boxes against the hurtboxes, the sensor fixtures of
+// rigid bodies widened by b2_aabbExtension, gathered once per tick into
+// packed arrays grouped by team mask and sorted by min x within a group.
+// Each attack scans only the groups its collision mask intersects, and in
+// them only the hurtboxes that can reach its x range.
+class Hitbox_broadphase {
+public:
+	Hitbox_broadphase();
+
+	// Packs the sensor fixtures of every body with its entity's team mask;
+	// entities without one are never hit.
+	void gather_hurtboxes(const Physics_manager& physics_manager, const component<Entity_id, Team_mask>& team_masks);
+	void add_attack(Entity_id attacker_id, vec2 min, vec2 max, Team_mask collision_mask, int damage);
+
+	// Calls fn(attacker_id, target_id, damage) for every attack overlapping
+	// a hurtbox of another entity whose team mask intersects its collision
+	// mask, ordered by attack and then by body, and clears the attacks.
+	template <typename Fn>
+	void find_hits(Fn fn)
+	{
+		sweep();
+		for (const auto& hit : m_hits) {
+			fn(m_attacks.entity_ids[hit.attack], m_hurtboxes.entity_ids[hit.hurtbox], m_attack_damages[hit.attack]);
+		}
+		m_attacks.clear();
+		m_attack_damages.clear();
+	}
+
+	size_t get_hurtbox_count() const noexcept;
+private:
+	struct Boxes {
+		std::vector<float> min_x;
+		std::vector<float> min_y;
+		std::vector<float> max_x;
+		std::vector<float> max_y;
+		std::vector<Entity_id> entity_ids;
+		// Team mask for hurtboxes, collision mask for attacks.
+		std::vector<Team_mask> masks;
+		// Index before sorting, so hits can be reported in insertion order.
+		std::vector<std::uint32_t> orders;
+
+		void push_back(vec2 min, vec2 max, Entity_id entity_id, Team_mask mask);
+		void sort_by_mask_and_min_x(std::vector<std::uint32_t>& indices, Boxes& sorted);
+		void clear() noexcept;
+		size_t size() const noexcept { return entity_ids.size(); }
+	};
+	// Hurtboxes [first, last) share a team mask, and none is wider than
+	// max_width.
+	struct Team_group {
+		Team_mask mask;
+		std::uint32_t first;
+		std::uint32_t last;
+		float max_width;
+	};
+	// Indices into the attacks and the sorted hurtboxes.
+	struct Hit {
+		std::uint32_t attack;
+		std::uint32_t hurtbox;
+	};
+
+	void sweep();
+
+	Boxes m_hurtboxes;
+	std::vector<Team_group> m_team_groups;
+	Boxes m_attacks;
+	std::vector<int> m_attack_damages;
+	std::vector<Hit> m_hits;
+	std::vector<std::uint32_t> m_indices;
+	Boxes m_sorted;
+};
+
+} // namespace te
+
+#endif
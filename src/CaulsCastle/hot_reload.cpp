@@ -0,0 +1,331 @@
+#include "hot_reload.h"
+#include "game_data.h"
+#include "loaders.h"
+#include "records.h"
+#include "entity.h"
+#include "texture_loader.h"
+#include "profiler.h"
+#include "utilities.h"
+
+#include <rapidxml.hpp>
+#include <rapidxml_utils.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace te {
+
+namespace {
+
+void rebuild_colliders(Game_data& data)
+{
+	data.colliders.clear();
+	for (const auto& mesh_pair : data.mesh2_table) {
+		auto sprite_found = data.sprite_table.find(mesh_pair.first);
+		if (sprite_found != data.sprite_table.end()) {
+			detail::add_colliders(sprite_found->second, mesh_pair.second.id, data);
+		}
+	}
+}
+
+// Names of the animation groups whose records differ between the tables,
+// sorted. Prefabs see image_data.xml only through their group's records.
+std::vector<std::string> get_changed_groups(std::vector<Animation_group_type_record> old_types, std::vector<Animation_group_type_record> new_types)
+{
+	auto is_less = [](const Animation_group_type_record& lhs, const Animation_group_type_record& rhs) {
+		return std::tie(lhs.group_name, lhs.type, lhs.animation_filename) < std::tie(rhs.group_name, rhs.type, rhs.animation_filename);
+	};
+	std::sort(old_types.begin(), old_types.end(), is_less);
+	std::sort(new_types.begin(), new_types.end(), is_less);
+	std::vector<Animation_group_type_record> changed;
+	std::set_symmetric_difference(old_types.begin(), old_types.end(), new_types.begin(), new_types.end(), std::back_inserter(changed), is_less);
+
+	std::vector<std::string> group_names;
+	for (const auto& group_type : changed) {
+		group_names.push_back(group_type.group_name);
+	}
+	group_names.erase(std::unique(group_names.begin(), group_names.end()), group_names.end());
+	return group_names;
+}
+
+} // namespace
+
+Hot_reloader::Hot_reloader(const std::string& image_data_filename, const std::string& entity_listing_filename, Game_data& data)
+	: m_image_data_filename{ image_data_filename }
+	, m_entity_listing_filename{ entity_listing_filename }
+	, m_watcher{}
+	, m_files{}
+	, m_changed_paths{}
+{
+	watch(m_image_data_filename, File_kind::image_data);
+	reload_image_data(data, true);
+	for (const auto& image_pair : data.image_table) {
+		watch(data.image_root + image_pair.first, File_kind::image, image_pair.first);
+	}
+	watch(m_entity_listing_filename, File_kind::entity_listing);
+	reload_entity_listing(data, true);
+}
+
+size_t Hot_reloader::update(Game_data& data)
+{
+	m_changed_paths.clear();
+	m_watcher.poll(m_changed_paths);
+	size_t reloaded = 0;
+	for (const auto& path : m_changed_paths) {
+		TE_PROFILE_ZONE("hot_reload");
+		auto found = m_files.find(path);
+		if (found == m_files.end()) {
+			continue;
+		}
+		// Each file is parsed before its tables are touched, so a file
+		// saved half-edited leaves the game as it was. Copied, since a
+		// reload can watch new files.
+		try {
+			const auto file = found->second;
+			reload(path, file, data);
+			++reloaded;
+		}
+		catch (const std::exception&) {
+		}
+	}
+	return reloaded;
+}
+
+void Hot_reloader::watch(const std::string& path, File_kind kind, const std::string& key)
+{
+	m_watcher.watch(path);
+	m_files[path] = { kind, key };
+}
+
+void Hot_reloader::reload(const std::string& path, const Watched_file& file, Game_data& data)
+{
+	switch (file.kind) {
+	case File_kind::image_data:
+		reload_image_data(data, false);
+		break;
+	case File_kind::atlas:
+		reload_atlas(path, data);
+		break;
+	case File_kind::animation:
+		reload_animation(file.key, data);
+		break;
+	case File_kind::image:
+		reload_image(file.key, data);
+		break;
+	case File_kind::entity_listing:
+		reload_entity_listing(data, false);
+		break;
+	case File_kind::entity:
+		reload_entity(path, data);
+		break;
+	}
+}
+
+void Hot_reloader::reload_image_data(Game_data& data, bool is_initial)
+{
+	const auto dir = get_directory(m_image_data_filename);
+
+	rapidxml::file<> file{ m_image_data_filename.c_str() };
+	rapidxml::xml_document<> xml;
+	xml.parse<0>(file.data());
+	auto* p_root = xml.first_node("image_data");
+
+	std::vector<std::string> new_atlases;
+	for (auto* p_atlas = p_root->first_node("atlases")->first_node("file"); p_atlas != NULL; p_atlas = p_atlas->next_sibling("file")) {
+		auto path = dir + p_atlas->first_attribute("name")->value();
+		if (m_files.find(path) == m_files.end()) {
+			new_atlases.push_back(std::move(path));
+		}
+	}
+	std::vector<std::string> new_animations;
+	std::vector<Animation_group_type_record> group_types;
+	for (auto* p_animation = p_root->first_node("animations")->first_node("file"); p_animation != NULL; p_animation = p_animation->next_sibling("file")) {
+		std::string animation_filename{ p_animation->first_attribute("name")->value() };
+		if (m_files.find(dir + animation_filename) == m_files.end()) {
+			new_animations.push_back(animation_filename);
+		}
+		for (auto* p_group = p_animation->first_node("group"); p_group != NULL; p_group = p_group->next_sibling("group")) {
+			group_types.push_back({
+				p_group->first_attribute("name")->value(),
+				p_group->first_attribute("type")->value(),
+				animation_filename
+			});
+		}
+	}
+	std::vector<Collider_record> colliders;
+	for (auto* p_collider = p_root->first_node("colliders")->first_node("collider"); p_collider != NULL; p_collider = p_collider->next_sibling("collider")) {
+		colliders.push_back({
+			p_collider->first_attribute("image")->value(),
+			std::stoi(p_collider->first_attribute("x")->value()),
+			std::stoi(p_collider->first_attribute("y")->value()),
+			std::stoi(p_collider->first_attribute("w")->value()),
+			std::stoi(p_collider->first_attribute("h")->value())
+		});
+	}
+
+	std::vector<std::string> changed_groups;
+	if (!is_initial) {
+		changed_groups = get_changed_groups(data.animation_group_type_table, group_types);
+		for (const auto& group_type : group_types) {
+			if (data.animation_group_table.find(group_type.group_name) == data.animation_group_table.end()) {
+				data.animation_group_table.insert(decltype(data.animation_group_table)::value_type{
+					group_type.group_name, { group_type.group_name }
+				});
+			}
+		}
+		data.animation_group_type_table = std::move(group_types);
+		data.collider_table = std::move(colliders);
+		index_image_data(data);
+		rebuild_colliders(data);
+	}
+	for (const auto& path : new_atlases) {
+		if (!is_initial) {
+			reload_atlas(path, data);
+		}
+		watch(path, File_kind::atlas);
+	}
+	for (const auto& animation_filename : new_animations) {
+		if (!is_initial) {
+			reload_animation(animation_filename, data);
+		}
+		watch(dir + animation_filename, File_kind::animation, animation_filename);
+	}
+	// Group changes reach live entities through their prefabs; the others
+	// are left alone.
+	for (const auto& prefab_pair : data.entity_prefabs) {
+		if (std::binary_search(changed_groups.begin(), changed_groups.end(), prefab_pair.first->animation_group)) {
+			reload_prefab(*prefab_pair.first, data);
+		}
+	}
+}
+
+void Hot_reloader::reload_atlas(const std::string& path, Game_data& data)
+{
+	std::vector<std::pair<std::string, Image_record>> images;
+	std::vector<std::pair<std::string, Sprite_record>> sprites;
+	load_atlas(path, std::back_inserter(images), std::back_inserter(sprites));
+	assert(images.size() == 1);
+	const auto image = images.front().second;
+	std::sort(sprites.begin(), sprites.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.first < rhs.first;
+	});
+
+	// Sprites gone from the atlas lose their records; meshes already made
+	// from them stay as they were.
+	data.image_table[image.filename] = image;
+	for (auto it = data.sprite_table.begin(); it != data.sprite_table.end();) {
+		const bool is_removed = it->second.image_filename == image.filename
+			&& !std::binary_search(sprites.begin(), sprites.end(), *it, [](const auto& lhs, const auto& rhs) {
+				return lhs.first < rhs.first;
+			});
+		it = is_removed ? data.sprite_table.erase(it) : std::next(it);
+	}
+	for (auto& sprite_pair : sprites) {
+		data.sprite_table[sprite_pair.first] = std::move(sprite_pair.second);
+	}
+	index_image_data(data);
+	watch(data.image_root + image.filename, File_kind::image, image.filename);
+
+	const auto texture_id = get_or_create<Texture>(image.filename, data);
+	const auto gl_texture_id = data.textures.get(texture_id).get_texture_id();
+	for (const auto& sprite_pair : sprites) {
+		auto mesh_found = data.mesh2_table.find(sprite_pair.first);
+		if (mesh_found != data.mesh2_table.end()) {
+			const auto& record = data.sprite_table.find(sprite_pair.first)->second;
+			data.meshes2.get(mesh_found->second.id) = make_mesh(record, gl_texture_id, pow2up(image.width), pow2up(image.height));
+		}
+	}
+	rebuild_colliders(data);
+}
+
+void Hot_reloader::reload_animation(const std::string& csv_filename, Game_data& data)
+{
+	std::vector<std::pair<std::string, Animation_record>> animations;
+	std::vector<Animation_frame_record> frames;
+	load_animation(get_directory(m_image_data_filename), csv_filename, std::back_inserter(animations), std::back_inserter(frames));
+	// Animations need a first frame, so an empty csv keeps the old one.
+	if (animations.empty() || frames.empty()) {
+		throw std::runtime_error{ csv_filename + " has no frames" };
+	}
+
+	auto& frame_table = data.animation_frame_table;
+	frame_table.erase(std::remove_if(frame_table.begin(), frame_table.end(), [&csv_filename](const Animation_frame_record& record) {
+		return record.animation_filename == csv_filename;
+	}), frame_table.end());
+	frame_table.insert(frame_table.end(), frames.begin(), frames.end());
+	data.animation_table[csv_filename] = animations.front().second;
+	index_image_data(data);
+
+	auto animation_found = data.animation2_table.find(csv_filename);
+	if (animation_found == data.animation2_table.end()) {
+		return;
+	}
+	const auto animation_id = animation_found->second.id;
+	auto& animation = data.animations2.get(animation_id);
+	animation = detail::make_animation(data.animation_table.find(csv_filename)->second, data);
+	// Entities past the new last frame start the animation over.
+	for (auto& animation_pair : data.entity_animations2) {
+		auto& entity_animation = animation_pair.second;
+		if (entity_animation.id == animation_id && entity_animation.frame_index >= animation.frames.size()) {
+			entity_animation.frame_index = 0;
+			entity_animation.t = 0.f;
+		}
+	}
+}
+
+void Hot_reloader::reload_image(const std::string& image_filename, Game_data& data)
+{
+	auto texture_found = data.texture_table.find(image_filename);
+	if (texture_found == data.texture_table.end() || data.headless) {
+		return;
+	}
+	const auto gl_texture_id = data.textures.get(texture_found->second.id).get_texture_id();
+	reload_texture(data.texture_loader.get(), gl_texture_id, data.image_root + image_filename);
+}
+
+void Hot_reloader::reload_entity_listing(Game_data& data, bool is_initial)
+{
+	const auto dir = get_directory(m_entity_listing_filename);
+
+	rapidxml::file<> file{ m_entity_listing_filename.c_str() };
+	rapidxml::xml_document<> xml;
+	xml.parse<0>(file.data());
+	auto* p_root = xml.first_node("entities");
+
+	for (auto* p_file = p_root->first_node("file"); p_file != NULL; p_file = p_file->next_sibling("file")) {
+		const auto path = dir + p_file->first_attribute("name")->value();
+		if (m_files.find(path) != m_files.end()) {
+			continue;
+		}
+		if (!is_initial) {
+			reload_entity(path, data);
+		}
+		watch(path, File_kind::entity);
+	}
+}
+
+void Hot_reloader::reload_entity(const std::string& path, Game_data& data)
+{
+	// Parsed before the table is touched; a file that does not parse
+	// throws and the old definition stays.
+	Entity_xml entity_xml{ path };
+	auto found = data.entity_table.find(entity_xml.name);
+	if (found == data.entity_table.end()) {
+		std::string entity_name{ entity_xml.name };
+		data.entity_table.insert(decltype(data.entity_table)::value_type{
+			entity_name,
+			std::move(entity_xml)
+		});
+		return;
+	}
+	// Assigned in place: prefabs and entities hold its address.
+	found->second = std::move(entity_xml);
+	reload_prefab(found->second, data);
+}
+
+} // namespace te
@@ -0,0 +1,61 @@
+#ifndef TE_HOT_RELOAD_H
+#define TE_HOT_RELOAD_H
+
+#include "types.h"
+#include "file_watcher.h"
+
+#include <string>
+#include <vector>
+
+namespace te {
+
+struct Game_data;
+
+// Watches image_data.xml with the atlases, animations and images it lists,
+// and the entity listing with its entity files. A saved file rebuilds only
+// its own records, and the meshes, animations, textures and prefabs made
+// from them are rebuilt under the ids they already have, so live entities
+// pick up the change on their next frame.
+class Hot_reloader {
+public:
+	Hot_reloader(const std::string& image_data_filename, const std::string& entity_listing_filename, Game_data& data);
+
+	// Applies the files saved since the last call and returns how many were
+	// applied. A file that fails to parse is skipped until it is saved
+	// again. Textures are replaced through the texture loader, so this runs
+	// where GL calls are made.
+	size_t update(Game_data& data);
+private:
+	enum class File_kind {
+		image_data,
+		atlas,
+		animation,
+		image,
+		entity_listing,
+		entity
+	};
+	struct Watched_file {
+		File_kind kind;
+		// The name the file's records are keyed by, where that is not its path.
+		std::string key;
+	};
+
+	void watch(const std::string& path, File_kind kind, const std::string& key = {});
+	void reload(const std::string& path, const Watched_file& file, Game_data& data);
+	void reload_image_data(Game_data& data, bool is_initial);
+	void reload_atlas(const std::string& path, Game_data& data);
+	void reload_animation(const std::string& csv_filename, Game_data& data);
+	void reload_image(const std::string& image_filename, Game_data& data);
+	void reload_entity_listing(Game_data& data, bool is_initial);
+	void reload_entity(const std::string& path, Game_data& data);
+
+	std::string m_image_data_filename;
+	std::string m_entity_listing_filename;
+	File_watcher m_watcher;
+	flat_map<std::string, Watched_file> m_files;
+	std::vector<std::string> m_changed_paths;
+};
+
+} // namespace te
+
+#endif
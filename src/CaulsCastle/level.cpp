@@ -4,46 +4,104 @@
 #include "texture.h"
 #include "tile_map_layer.h"
 #include "entity.h"
+#include "tile_chunks.h"
+#include "profiler.h"
 
 #include <Box2D/Box2D.h>
 #include <glm/gtx/transform.hpp>
 
 #include <iterator>
 #include <array>
+#include <memory>
 #include <regex>
 
 namespace te {
 
 static const std::regex team_mask_regex{ "team_mask_(\\d+)" };
+static const int tile_chunk_size = 16;
 
-void load_level(const std::string& tmx_filename, Game_data& data)
+void read_team_masks(const Tmx& tmx, Game_data& data)
 {
-	Tmx tmx{ tmx_filename };
-
 	for (auto& prop : tmx.properties) {
 		std::smatch number_match;
 		if (std::regex_match(prop.first, number_match, team_mask_regex)) {
 			data.team_masks[std::stoi(number_match[1].str())] = std::stoul(prop.second, nullptr, 16);
 		}
 	}
+}
+
+void add_collision_fixture(b2Body& body, const Tmx::Object& object, vec2 pixel_to_world_scale)
+{
+	b2PolygonShape shape{};
+	const std::array<b2Vec2, 4> points = {
+		b2Vec2{ object.x / pixel_to_world_scale.x, object.y / pixel_to_world_scale.y },
+		b2Vec2{ (object.x + object.width) / pixel_to_world_scale.x, object.y / pixel_to_world_scale.y },
+		b2Vec2{ (object.x + object.width) / pixel_to_world_scale.x, (object.y + object.height) / pixel_to_world_scale.y },
+		b2Vec2{ object.x / pixel_to_world_scale.x, (object.y + object.height) / pixel_to_world_scale.y }
+	};
+	shape.Set(points.data(), 4);
+	body.CreateFixture(&shape, 0);
+}
+
+Entity_id spawn_level_entity(const Tmx::Object& object, Tmx::Index draw_order, Game_data& data)
+{
+	const std::string type = object.type.length() > 0 ? object.type : "hero";
+	auto entity_found = data.entity_table.find(type);
+	assert(entity_found != data.entity_table.end());
+	auto entity_id = make_entity(entity_found->second, data, {
+		(object.x + (object.width * 0.5f)) / data.pixel_to_world_scale.x,
+		(object.y + (object.height * 0.5f)) / data.pixel_to_world_scale.y
+	});
+	auto mesh_range = data.entity_meshes2.equal_range(entity_id);
+	for (auto it = mesh_range.first; it != mesh_range.second; ++it) {
+		it->second.draw_order = static_cast<int>(draw_order);
+	}
+	for (auto& prop : object.properties) {
+		if (prop.first == "team_mask") {
+			data.entity_team_masks[entity_id] = std::stoi(prop.second, nullptr, 16);
+		}
+	}
 
+	if (object.name == "Player") {
+		data.avatars[0] = entity_id;
+	}
+	return entity_id;
+}
+
+static std::vector<GLuint> load_tileset_texture_ids(const Tmx& tmx, Game_data& data)
+{
 	std::vector<GLuint> tileset_texture_ids;
-	load_tileset_textures(tmx, std::back_inserter(tileset_texture_ids));
+	load_tileset_textures(tmx, std::back_inserter(tileset_texture_ids), [&data](const std::string& path) {
+		return load_texture(data.texture_loader.get(), path);
+	});
 	for (auto id : tileset_texture_ids) {
-		data.textures.insert({ id });
+		data.textures.insert({ id, data.texture_loader.get() });
 	}
+	return tileset_texture_ids;
+}
+
+void load_level(const std::string& tmx_filename, Game_data& data)
+{
+	TE_PROFILE_ZONE("load_level");
+	Tmx tmx{ tmx_filename };
+	read_team_masks(tmx, data);
 
 	auto map_id = data.entity_manager.get_free_id();
-	iterate_layers_and_tilesets(tmx, [map_id, &data, &tmx, &tileset_texture_ids](size_t layer_i, size_t tileset_i) {
-		Vertex_array<vec2, vec2> vertices{};
-		get_tile_map_layer_vertices(tmx, layer_i, tileset_i, std::back_inserter(vertices));
-		auto id = data.meshes2.insert({
-			std::move(vertices),
-			tileset_texture_ids[tileset_i],
-			GL_QUADS
+	if (!data.headless) {
+		const auto tileset_texture_ids = load_tileset_texture_ids(tmx, data);
+
+		const vec2 chunk_size{ tmx.tilewidth * tile_chunk_size, tmx.tileheight * tile_chunk_size };
+		iterate_layers_and_tilesets(tmx, [chunk_size, &data, &tmx, &tileset_texture_ids](size_t layer_i, size_t tileset_i) {
+			Vertex_array<vec2, vec2> vertices{};
+			get_tile_map_layer_vertices(tmx, layer_i, tileset_i, std::back_inserter(vertices));
+			auto chunks = make_tile_chunks(vertices,
+						       tileset_texture_ids[tileset_i],
+						       static_cast<int>(layer_i),
+						       chunk_size,
+						       data.pixel_to_world_scale);
+			std::move(chunks.begin(), chunks.end(), std::back_inserter(data.tile_chunks));
 		});
-		data.entity_meshes2.push_back({ map_id, { id, {}, static_cast<int>(layer_i) } });
-	});
+	}
 
 	for (auto& group : tmx.objectgroups) {
 		if (group.name == "Collisions") {
@@ -51,47 +109,42 @@ void load_level(const std::string& tmx_filename, Game_data& data)
 
 			b2BodyDef body_def{};
 			body_def.type = b2_staticBody;
-			b2Body& p_body = data.physics_manager.add_rigid_body(map_id, body_def);
-
-			for (auto& polygon : group.objects) {
-				b2PolygonShape shape{};
-				const std::array<b2Vec2, 4> points = {
-					b2Vec2{ polygon.x / data.pixel_to_world_scale.x, polygon.y / data.pixel_to_world_scale.y },
-					b2Vec2{ (polygon.x + polygon.width) / data.pixel_to_world_scale.x, polygon.y / data.pixel_to_world_scale.y },
-					b2Vec2{ (polygon.x + polygon.width) / data.pixel_to_world_scale.x, (polygon.y + polygon.height) / data.pixel_to_world_scale.y },
-					b2Vec2{ polygon.x / data.pixel_to_world_scale.x, (polygon.y + polygon.height) / data.pixel_to_world_scale.y }
-				};
-				shape.Set(points.data(), 4);
-				p_body.CreateFixture(&shape, 0);
+			b2Body& body = data.physics_manager.add_rigid_body(map_id, body_def);
+			for (auto& object : group.objects) {
+				add_collision_fixture(body, object, data.pixel_to_world_scale);
 			}
 		}
 
 		if (group.name == "Entities") {
-			for (auto& entity : group.objects) {
-				const std::string type = entity.type.length() > 0 ? entity.type : "hero";
-				auto entity_found = data.entity_table.find(type);
-				assert(entity_found != data.entity_table.end());
-				auto entity_id = make_entity(entity_found->second, data, {
-					(entity.x + (entity.width * 0.5f)) / data.pixel_to_world_scale.x,
-					(entity.y + (entity.height * 0.5f)) / data.pixel_to_world_scale.y
-				});
-				for (auto& mesh_pair : data.entity_meshes2) {
-					if (mesh_pair.first == entity_id) {
-						mesh_pair.second.draw_order = group.index;
-					}
-				}
-				for (auto& prop : entity.properties) {
-					if (prop.first == "team_mask") {
-						data.entity_team_masks[entity_id] = std::stoi(prop.second, nullptr, 16);
-					}
-				}
-
-				if (entity.name == "Player") {
-					data.avatars[0] = entity_id;
-				}
+			for (auto& object : group.objects) {
+				spawn_level_entity(object, group.index, data);
 			}
 		}
 	}
 }
 
+void load_streamed_level(const std::string& tmx_filename, Game_data& data, const Streaming_settings& settings)
+{
+	TE_PROFILE_ZONE("load_streamed_level");
+	Tmx tmx{ tmx_filename };
+	read_team_masks(tmx, data);
+
+	std::vector<GLuint> tileset_texture_ids;
+	if (!data.headless) {
+		tileset_texture_ids = load_tileset_texture_ids(tmx, data);
+	}
+
+	auto p_streamer = std::make_unique<Level_streamer>(std::move(tmx), std::move(tileset_texture_ids), settings, data);
+	// The avatar is the streaming focus, so it can't wait for its region.
+	p_streamer->spawn_named("Player", data);
+
+	vec2 focus{};
+	auto avatar_found = data.avatars.find(0);
+	if (avatar_found != data.avatars.end()) {
+		focus = data.positions[avatar_found->second];
+	}
+	p_streamer->load_around(focus, data);
+	data.level_streamer = std::move(p_streamer);
+}
+
 } // namespace te
@@ -1,14 +1,30 @@
 #ifndef TE_LEVEL_H
 #define TE_LEVEL_H
 
+#include "types.h"
+#include "tmx.h"
+#include "level_streamer.h"
+
 #include <string>
 
+class b2Body;
+
 namespace te {
 
 struct Game_data;
 
 void load_level(const std::string& tmx_filename, Game_data& data);
 
+// Loads the level into a Level_streamer, spawns the player and loads the
+// regions around it. Everything else is paged in by step_game.
+void load_streamed_level(const std::string& tmx_filename, Game_data& data, const Streaming_settings& settings = {});
+
+void read_team_masks(const Tmx& tmx, Game_data& data);
+// Adds a box fixture for an object of the Collisions group.
+void add_collision_fixture(b2Body& body, const Tmx::Object& object, vec2 pixel_to_world_scale);
+// Spawns an object of the Entities group; "Player" becomes avatar 0.
+Entity_id spawn_level_entity(const Tmx::Object& object, Tmx::Index draw_order, Game_data& data);
+
 } // namespace te
 
 #endif
@@ -0,0 +1,325 @@
+#include "level_streamer.h"
+#include "level.h"
+#include "game_data.h"
+#include "tile_map_layer.h"
+#include "sprite_batch.h"
+#include "profiler.h"
+
+#include <Box2D/Box2D.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <cassert>
+
+namespace te {
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double seconds_since(Clock::time_point start)
+{
+	const std::chrono::duration<double> elapsed = Clock::now() - start;
+	return elapsed.count();
+}
+
+} // namespace
+
+Level_streamer::Level_streamer(Tmx&& tmx, std::vector<GLuint> tileset_texture_ids, const Streaming_settings& settings, Game_data& data)
+	: m_tmx{ std::move(tmx) }
+	, m_tileset_texture_ids{ std::move(tileset_texture_ids) }
+	, m_settings{ settings }
+	, m_pixel_to_world_scale{ data.pixel_to_world_scale }
+	, m_headless{ data.headless }
+	, m_columns{ (m_tmx.width + settings.region_tiles - 1) / settings.region_tiles }
+	, m_rows{ (m_tmx.height + settings.region_tiles - 1) / settings.region_tiles }
+	, m_regions{}
+	, m_resident{}
+	, m_spawned_objects{}
+	, m_pool{ settings.thread_count }
+	, m_group{}
+	, m_built_mutex{}
+	, m_built{}
+{
+	assert(settings.region_tiles > 0 && settings.chunk_tiles > 0);
+	assert(settings.load_distance < settings.unload_distance);
+
+	m_regions.reserve(m_columns * m_rows);
+	for (int y = 0; y < m_rows; ++y) {
+		for (int x = 0; x < m_columns; ++x) {
+			m_regions.push_back({ Region_state::Unloaded, 0, {}, {}, {}, 0, { x, y, 0, 0, 0, 0.0, 0.0 } });
+		}
+	}
+
+	// Objects belong to the region holding their centre.
+	for (size_t group_i = 0; group_i < m_tmx.objectgroups.size(); ++group_i) {
+		const auto& group = m_tmx.objectgroups[group_i];
+		const bool collisions = group.name == "Collisions";
+		if (!collisions && group.name != "Entities") {
+			continue;
+		}
+		for (size_t object_i = 0; object_i < group.objects.size(); ++object_i) {
+			const auto& object = group.objects[object_i];
+			const int tile_x = (object.x + object.width / 2) / m_tmx.tilewidth;
+			const int tile_y = (object.y + object.height / 2) / m_tmx.tileheight;
+			const int x = std::min(std::max(tile_x / settings.region_tiles, 0), m_columns - 1);
+			const int y = std::min(std::max(tile_y / settings.region_tiles, 0), m_rows - 1);
+			auto& region = m_regions[get_region_index(x, y)];
+			(collisions ? region.collisions : region.spawns).push_back({ group_i, object_i });
+		}
+	}
+}
+
+Level_streamer::~Level_streamer()
+{
+	m_pool.wait(m_group);
+}
+
+void Level_streamer::update(vec2 focus, Game_data& data)
+{
+	TE_PROFILE_ZONE("update_level_streamer");
+	m_resident.erase(std::remove_if(m_resident.begin(), m_resident.end(), [this, focus, &data](size_t region_index) {
+		if (get_distance(region_index, focus) <= m_settings.unload_distance) {
+			return false;
+		}
+		unload(region_index, data);
+		return true;
+	}), m_resident.end());
+
+	const vec2 region_size{
+		static_cast<float>(m_settings.region_tiles * m_tmx.tilewidth) / m_pixel_to_world_scale.x,
+		static_cast<float>(m_settings.region_tiles * m_tmx.tileheight) / m_pixel_to_world_scale.y
+	};
+	const int x_begin = std::max(static_cast<int>(std::floor((focus.x - m_settings.load_distance) / region_size.x)), 0);
+	const int y_begin = std::max(static_cast<int>(std::floor((focus.y - m_settings.load_distance) / region_size.y)), 0);
+	const int x_end = std::min(static_cast<int>(std::floor((focus.x + m_settings.load_distance) / region_size.x)) + 1, m_columns);
+	const int y_end = std::min(static_cast<int>(std::floor((focus.y + m_settings.load_distance) / region_size.y)) + 1, m_rows);
+	for (int y = y_begin; y < y_end; ++y) {
+		for (int x = x_begin; x < x_end; ++x) {
+			const auto region_index = get_region_index(x, y);
+			if (m_regions[region_index].state == Region_state::Unloaded
+			    && get_distance(region_index, focus) <= m_settings.load_distance) {
+				request(region_index);
+				m_resident.push_back(region_index);
+			}
+		}
+	}
+
+	// Without workers the builds only run while someone waits on them.
+	if (m_pool.get_thread_count() == 0) {
+		m_pool.wait(m_group);
+	}
+	finish_builds(data);
+}
+
+void Level_streamer::load_around(vec2 focus, Game_data& data)
+{
+	update(focus, data);
+	m_pool.wait(m_group);
+	finish_builds(data);
+}
+
+void Level_streamer::spawn_named(const std::string& name, Game_data& data)
+{
+	for (const auto& group : m_tmx.objectgroups) {
+		if (group.name != "Entities") {
+			continue;
+		}
+		for (const auto& object : group.objects) {
+			if (object.name == name && m_spawned_objects.insert(object.id).second) {
+				spawn_level_entity(object, group.index, data);
+			}
+		}
+	}
+}
+
+size_t Level_streamer::submit_visible(vec2 view_min, vec2 view_max, Sprite_batch& sprite_batch) const
+{
+	size_t visible = 0;
+	for (auto region_index : m_resident) {
+		visible += submit_visible_tile_chunks(m_regions[region_index].chunks, view_min, view_max, sprite_batch);
+	}
+	return visible;
+}
+
+size_t Level_streamer::get_region_count() const noexcept
+{
+	return m_regions.size();
+}
+
+size_t Level_streamer::get_loaded_count() const noexcept
+{
+	return std::count_if(m_resident.begin(), m_resident.end(), [this](size_t region_index) {
+		return m_regions[region_index].state == Region_state::Loaded;
+	});
+}
+
+size_t Level_streamer::get_chunk_count() const noexcept
+{
+	size_t count = 0;
+	for (auto region_index : m_resident) {
+		count += m_regions[region_index].chunks.size();
+	}
+	return count;
+}
+
+std::vector<Region_stats> Level_streamer::get_loaded_stats() const
+{
+	std::vector<Region_stats> stats;
+	for (auto region_index : m_resident) {
+		if (m_regions[region_index].state == Region_state::Loaded) {
+			stats.push_back(m_regions[region_index].stats);
+		}
+	}
+	return stats;
+}
+
+size_t Level_streamer::get_region_index(int x, int y) const noexcept
+{
+	return static_cast<size_t>(y * m_columns + x);
+}
+
+float Level_streamer::get_distance(size_t region_index, vec2 focus) const
+{
+	const auto& stats = m_regions[region_index].stats;
+	const vec2 tile_size{
+		m_tmx.tilewidth / m_pixel_to_world_scale.x,
+		m_tmx.tileheight / m_pixel_to_world_scale.y
+	};
+	const vec2 min{
+		stats.x * m_settings.region_tiles * tile_size.x,
+		stats.y * m_settings.region_tiles * tile_size.y
+	};
+	const vec2 max{
+		std::min((stats.x + 1) * m_settings.region_tiles, m_tmx.width) * tile_size.x,
+		std::min((stats.y + 1) * m_settings.region_tiles, m_tmx.height) * tile_size.y
+	};
+	return glm::distance(focus, glm::clamp(focus, min, max));
+}
+
+void Level_streamer::request(size_t region_index)
+{
+	auto& region = m_regions[region_index];
+	assert(region.state == Region_state::Unloaded);
+	region.state = Region_state::Building;
+	const auto generation = ++region.generation;
+	m_pool.submit(m_group, [this, region_index, generation] {
+		TE_PROFILE_ZONE("build_region");
+		const auto start = Clock::now();
+		Built_region built{ region_index, generation, build(region_index), 0 };
+		built.build_seconds = seconds_since(start);
+		std::lock_guard<std::mutex> lock{ m_built_mutex };
+		m_built.push_back(std::move(built));
+	});
+}
+
+// Runs on a worker and only reads the Tmx, which never changes.
+std::vector<Tile_chunk_vertices> Level_streamer::build(size_t region_index) const
+{
+	const auto& stats = m_regions[region_index].stats;
+	const int x_begin = stats.x * m_settings.region_tiles;
+	const int y_begin = stats.y * m_settings.region_tiles;
+	const int x_end = std::min(x_begin + m_settings.region_tiles, m_tmx.width);
+	const int y_end = std::min(y_begin + m_settings.region_tiles, m_tmx.height);
+	const vec2 chunk_size{ m_tmx.tilewidth * m_settings.chunk_tiles, m_tmx.tileheight * m_settings.chunk_tiles };
+
+	// Headless levels build geometry they never upload, so the stats
+	// still show what a region costs.
+	std::vector<Tile_chunk_vertices> chunks;
+	iterate_layers_and_tilesets(m_tmx, [&](size_t layer_i, size_t tileset_i) {
+		Vertex_array<vec2, vec2> vertices{};
+		get_tile_map_region_vertices(m_tmx, layer_i, tileset_i, x_begin, y_begin, x_end, y_end, std::back_inserter(vertices));
+		if (vertices.size() == 0) {
+			return;
+		}
+		auto layer_chunks = make_tile_chunk_vertices(vertices,
+							     m_headless ? 0 : m_tileset_texture_ids[tileset_i],
+							     static_cast<int>(layer_i),
+							     chunk_size,
+							     m_pixel_to_world_scale);
+		std::move(layer_chunks.begin(), layer_chunks.end(), std::back_inserter(chunks));
+	});
+	return chunks;
+}
+
+void Level_streamer::finish_builds(Game_data& data)
+{
+	while (true) {
+		Built_region built;
+		{
+			std::lock_guard<std::mutex> lock{ m_built_mutex };
+			if (m_built.empty()) {
+				break;
+			}
+			built = std::move(m_built.front());
+			m_built.pop_front();
+		}
+		const auto& region = m_regions[built.region_index];
+		if (region.state == Region_state::Building && region.generation == built.generation) {
+			finish(built, data);
+		}
+	}
+}
+
+void Level_streamer::finish(Built_region& built, Game_data& data)
+{
+	const auto start = Clock::now();
+	auto& region = m_regions[built.region_index];
+	auto& stats = region.stats;
+	stats.vertex_bytes = 0;
+	stats.fixture_count = 0;
+	stats.entity_count = 0;
+
+	for (const auto& chunk : built.chunks) {
+		stats.vertex_bytes += chunk.vertices.size() * sizeof(Sprite_batch::Vertex);
+		if (!m_headless) {
+			region.chunks.push_back(upload_tile_chunk(chunk));
+		}
+	}
+
+	if (!region.collisions.empty()) {
+		// Negative ids never clash with entities, whose ids a restored
+		// snapshot hands out again.
+		region.body_id = -static_cast<Entity_id>(built.region_index) - 1;
+		b2BodyDef body_def{};
+		body_def.type = b2_staticBody;
+		b2Body& body = data.physics_manager.add_rigid_body(region.body_id, body_def);
+		for (const auto& ref : region.collisions) {
+			add_collision_fixture(body, m_tmx.objectgroups[ref.group_index].objects[ref.object_index], m_pixel_to_world_scale);
+			++stats.fixture_count;
+		}
+	}
+
+	for (const auto& ref : region.spawns) {
+		const auto& group = m_tmx.objectgroups[ref.group_index];
+		const auto& object = group.objects[ref.object_index];
+		if (m_spawned_objects.insert(object.id).second) {
+			spawn_level_entity(object, group.index, data);
+			++stats.entity_count;
+		}
+	}
+
+	stats.build_seconds = built.build_seconds;
+	stats.finalize_seconds = seconds_since(start);
+	region.state = Region_state::Loaded;
+}
+
+void Level_streamer::unload(size_t region_index, Game_data& data)
+{
+	auto& region = m_regions[region_index];
+	if (region.state == Region_state::Loaded) {
+		region.chunks.clear();
+		if (!region.collisions.empty()) {
+			data.physics_manager.remove_rigid_body(region.body_id);
+			data.positions.erase(region.body_id);
+		}
+	}
+	else {
+		++region.generation;
+	}
+	region.state = Region_state::Unloaded;
+}
+
+} // namespace te
@@ -0,0 +1,126 @@
+#ifndef TE_LEVEL_STREAMER_H
+#define TE_LEVEL_STREAMER_H
+
+#include "types.h"
+#include "tmx.h"
+#include "tile_chunks.h"
+#include "thread_pool.h"
+
+#include <SDL_opengl.h>
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace te {
+
+struct Game_data;
+class Sprite_batch;
+
+struct Streaming_settings {
+	// Side of a square region, in tiles.
+	int region_tiles = 32;
+	int chunk_tiles = 16;
+	// In world units from the focus to the nearest point of a region. The
+	// gap between the two keeps a focus near a region edge from thrashing.
+	float load_distance = 24.f;
+	float unload_distance = 40.f;
+	unsigned thread_count = 1;
+};
+
+struct Region_stats {
+	int x;
+	int y;
+	size_t vertex_bytes;
+	size_t fixture_count;
+	size_t entity_count;
+	// Tile geometry on the worker, then buffers, bodies and spawns on the
+	// main thread.
+	double build_seconds;
+	double finalize_seconds;
+};
+
+// Splits a level into square regions and keeps only those near a focus
+// point resident: their tile chunks and a static body holding their
+// Collisions fixtures. Entities objects are spawned the first time their
+// region loads and are not despawned with it.
+class Level_streamer {
+public:
+	Level_streamer(Tmx&& tmx, std::vector<GLuint> tileset_texture_ids, const Streaming_settings& settings, Game_data& data);
+	~Level_streamer();
+	Level_streamer(const Level_streamer&) = delete;
+	Level_streamer& operator=(const Level_streamer&) = delete;
+
+	// Queues builds for regions that came within load distance, unloads
+	// those beyond unload distance and finishes builds that are ready.
+	void update(vec2 focus, Game_data& data);
+	// As update, but waits for every queued build.
+	void load_around(vec2 focus, Game_data& data);
+
+	// Spawns the Entities objects with this name now, ahead of their region.
+	void spawn_named(const std::string& name, Game_data& data);
+
+	size_t submit_visible(vec2 view_min, vec2 view_max, Sprite_batch& sprite_batch) const;
+
+	size_t get_region_count() const noexcept;
+	size_t get_loaded_count() const noexcept;
+	size_t get_chunk_count() const noexcept;
+	std::vector<Region_stats> get_loaded_stats() const;
+private:
+	enum class Region_state {
+		Unloaded,
+		Building,
+		Loaded
+	};
+	struct Object_ref {
+		size_t group_index;
+		size_t object_index;
+	};
+	struct Region {
+		Region_state state;
+		// Bumped whenever a build is queued or abandoned, so builds that
+		// finish after their region was unloaded are dropped.
+		unsigned generation;
+		std::vector<Object_ref> collisions;
+		std::vector<Object_ref> spawns;
+		std::vector<Tile_chunk> chunks;
+		Entity_id body_id;
+		Region_stats stats;
+	};
+	struct Built_region {
+		size_t region_index;
+		unsigned generation;
+		std::vector<Tile_chunk_vertices> chunks;
+		double build_seconds;
+	};
+
+	size_t get_region_index(int x, int y) const noexcept;
+	float get_distance(size_t region_index, vec2 focus) const;
+	void request(size_t region_index);
+	std::vector<Tile_chunk_vertices> build(size_t region_index) const;
+	void finish_builds(Game_data& data);
+	void finish(Built_region& built, Game_data& data);
+	void unload(size_t region_index, Game_data& data);
+
+	const Tmx m_tmx;
+	const std::vector<GLuint> m_tileset_texture_ids;
+	const Streaming_settings m_settings;
+	const vec2 m_pixel_to_world_scale;
+	const bool m_headless;
+	int m_columns;
+	int m_rows;
+	std::vector<Region> m_regions;
+	std::vector<size_t> m_resident;
+	std::unordered_set<int> m_spawned_objects;
+
+	Thread_pool m_pool;
+	Thread_pool::Task_group m_group;
+	std::mutex m_built_mutex;
+	std::deque<Built_region> m_built;
+};
+
+} // namespace te
+
+#endif
@@ -1,11 +1,13 @@
 #include "light_attack_state.h"
 #include "game_data.h"
 
+#include <iterator>
+
 namespace te {
 
 void Light_attack_state_table::step_entering(Record_type& record, Game_data& data, float dt)
 {
-	const auto& animation_group = data.entity_animation_groups[record.id];
+	const auto& animation_group = *data.entity_animation_groups[record.id];
 	auto& animation = data.entity_animations2[record.id];
 	auto heading = data.headings[record.id];
 
@@ -36,10 +38,9 @@ void Light_attack_state_table::step_entering(Record_type& record, Game_data& dat
 void Light_attack_state_table::step_records(Record_type& record, Game_data& data, float dt)
 {
 	Resource_id<Mesh2> mesh_id{};
-	for (const auto& mesh_pair : data.entity_meshes2) {
-		if (record.id == mesh_pair.first) {
-			mesh_id = mesh_pair.second.resource_id;
-		}
+	auto mesh_range = data.entity_meshes2.equal_range(record.id);
+	if (mesh_range.first != mesh_range.second) {
+		mesh_id = std::prev(mesh_range.second)->second.resource_id;
 	}
 	for (const auto& collider : data.colliders) {
 		if (collider.mesh_id == mesh_id) {
@@ -25,6 +25,11 @@ struct Light_attack_state_record {
 	}
 };
 
+inline Entity_id get_entity_id(const Light_attack_state_record& record)
+{
+	return record.id;
+}
+
 class Light_attack_state_table : public State_table<Light_attack_state_table, Light_attack_state_record> {
 	friend class State_table<Light_attack_state_table, Light_attack_state_record>;
 
@@ -1,11 +1,49 @@
 #include "loaders.h"
 #include "records.h"
+#include "profiler.h"
 #include <iterator>
+#include <algorithm>
 
 namespace te {
 
+namespace {
+
+inline const std::string& get_key(const Animation_frame_record& record) { return record.animation_filename; }
+inline const std::string& get_key(const Collider_record& record) { return record.image_name; }
+inline const std::string& get_key(const std::string& key) { return key; }
+
+struct Record_less {
+	template <typename Lhs, typename Rhs>
+	bool operator()(const Lhs& lhs, const Rhs& rhs) const
+	{
+		return get_key(lhs) < get_key(rhs);
+	}
+};
+
+} // namespace
+
+void index_image_data(Game_data& data)
+{
+	std::stable_sort(data.animation_frame_table.begin(), data.animation_frame_table.end(), Record_less{});
+	for (auto& animation_pair : data.animation_table) {
+		auto& record = animation_pair.second;
+		auto range = std::equal_range(data.animation_frame_table.begin(), data.animation_frame_table.end(), record.filename, Record_less{});
+		record.first_frame = range.first - data.animation_frame_table.begin();
+		record.frame_count = range.second - range.first;
+	}
+
+	std::stable_sort(data.collider_table.begin(), data.collider_table.end(), Record_less{});
+	for (auto& sprite_pair : data.sprite_table) {
+		auto& record = sprite_pair.second;
+		auto range = std::equal_range(data.collider_table.begin(), data.collider_table.end(), record.filename, Record_less{});
+		record.first_collider = range.first - data.collider_table.begin();
+		record.collider_count = range.second - range.first;
+	}
+}
+
 void load_image_data(const std::string& data_filename, Game_data& data)
 {
+	TE_PROFILE_ZONE("load_image_data");
 	auto dir = get_directory(data_filename);
 
 	rapidxml::file<> file{ data_filename.c_str() };
@@ -50,6 +88,8 @@ void load_image_data(const std::string& data_filename, Game_data& data)
 		};
 		data.collider_table.push_back(std::move(collider_record));
 	}
+
+	index_image_data(data);
 }
 
 } // namespace te
@@ -60,6 +60,10 @@ void load_animations(const std::string& animations_filename, Game_data& data, It
 }
 
 void load_image_data(const std::string& data_filename, Game_data& data);
+// Groups frames by animation and colliders by sprite, and records each
+// group's range so resources are built without scanning whole tables. Run
+// again after those tables change.
+void index_image_data(Game_data& data);
 
 }
 
@@ -8,6 +8,11 @@
 #include "records.h"
 #include "entity_animation.h"
 #include "entity.h"
+#include "sprite_batch.h"
+#include "asset_pack.h"
+#include "profiler.h"
+#include "render_frame.h"
+#include "hot_reload.h"
 
 #include <SDL.h>
 #include <SDL_opengl.h>
@@ -15,9 +20,16 @@
 #include <IL/ilu.h>
 #include <IL/ilut.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <cassert>
 #include <map>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace {
 
@@ -95,6 +107,11 @@ int main(int argc, char** argv)
 {
 	using namespace te;
 
+	if (argc > 1 && argv[1] == std::string{ "--bake" }) {
+		bake_asset_pack("assets/spritesheets/image_data.xml", "assets/spritesheets/image_data.pack");
+		return 0;
+	}
+
 	Lib_init sdl{SDL_INIT_VIDEO|SDL_INIT_GAMECONTROLLER};
 
 	std::unique_ptr<SDL_GameController, void(*)(SDL_GameController*)> p_joystick{nullptr, &SDL_GameControllerClose};
@@ -133,6 +150,24 @@ int main(int argc, char** argv)
 	glClearColor(0, 0, 0, 1.f);
 
 	Game_data data{};
+	data.sprite_batch = std::make_unique<Sprite_batch>();
+	data.texture_loader = std::make_unique<Texture_loader>();
+	bool streamed = false;
+	bool watched = false;
+	for (int i = 1; i < argc; ++i) {
+		if (argv[i] == std::string{ "--serial" }) {
+			data.serial_stepping = true;
+		}
+		if (argv[i] == std::string{ "--stream" }) {
+			streamed = true;
+		}
+		if (argv[i] == std::string{ "--profile" }) {
+			set_profiling(true);
+		}
+		if (argv[i] == std::string{ "--watch" }) {
+			watched = true;
+		}
+	}
 
 	data.keymaps.insert(decltype(data.keymaps)::value_type{ 0, Keymap{} });
 	if (p_joystick) {
@@ -144,41 +179,121 @@ int main(int argc, char** argv)
 	data.resolution = { resolution_width, resolution_height };
 	data.image_root = "assets/spritesheets/";
 
-	load_image_data("assets/spritesheets/image_data.xml", data);
+	load_image_data_or_pack("assets/spritesheets/image_data.xml", "assets/spritesheets/image_data.pack", data);
 	load_entities_xml("assets/entities/entities.xml", data);
+	std::unique_ptr<Hot_reloader> p_hot_reloader;
+	if (watched) {
+		p_hot_reloader = std::make_unique<Hot_reloader>("assets/spritesheets/image_data.xml", "assets/entities/entities.xml", data);
+	}
 
-	load_level("assets/maps/arena.tmx", data);
+	if (streamed) {
+		load_streamed_level("assets/maps/arena.tmx", data);
+	}
+	else {
+		load_level("assets/maps/arena.tmx", data);
+	}
 
-	auto last_ticks = SDL_GetTicks();
-	decltype(last_ticks) time_since_last_update = 0;
-	decltype(last_ticks) time_per_frame = 1000 / 60;
-	float time_per_frame_s = time_per_frame / 1000.f;
+	using Clock = std::chrono::steady_clock;
+	const auto time_per_tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{ 1.0 / 60.0 });
+	const float time_per_tick_s = 1.f / 60.f;
+	const double texture_upload_budget_s = 0.002;
+
+	// Without vsync, frames are paced to the display so the loop does not
+	// spin; the simulation sleeps between ticks either way.
+	const bool vsync = SDL_GL_SetSwapInterval(1) == 0;
+	SDL_DisplayMode display_mode{};
+	const int refresh_rate = SDL_GetCurrentDisplayMode(0, &display_mode) == 0 && display_mode.refresh_rate > 0 ? display_mode.refresh_rate : 60;
+	const auto time_per_frame = vsync ? Clock::duration::zero() : std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{ 1.0 / refresh_rate });
+
+	// The simulation runs on its own thread and hands each tick to the
+	// renderer through render_frames. This thread keeps the window, events,
+	// input sampling, GL and level streaming, and takes sim_mutex whenever
+	// it touches simulation state.
+	Render_frames render_frames;
+	std::mutex sim_mutex;
+	std::mutex event_mutex;
+	std::vector<SDL_Event> pending_events;
+	// The newest sample of held movement, kept until the next one since a
+	// key stays down across ticks.
+	Player_inputs pending_inputs;
+	std::atomic<bool> run{ true };
+
+	std::thread sim_thread{ [&] {
+		std::vector<SDL_Event> events;
+		Player_inputs inputs;
+		auto next_tick = Clock::now();
+		while (run) {
+			std::this_thread::sleep_until(next_tick);
+			// Drops ticks after a long stall, e.g. a window drag, rather
+			// than running them back to back.
+			const auto now = Clock::now();
+			if (now - next_tick > 5 * time_per_tick) {
+				next_tick = now;
+			}
+			{
+				std::lock_guard<std::mutex> lock{ event_mutex };
+				events.swap(pending_events);
+				inputs = pending_inputs;
+			}
+			std::lock_guard<std::mutex> lock{ sim_mutex };
+			for (const auto& evt : events) {
+				input_game(data, evt);
+			}
+			events.clear();
+			input_game(data, inputs);
+			step_game(data, time_per_tick_s);
+			render_frames.publish(data, next_tick);
+			next_tick += time_per_tick;
+		}
+	} };
 
-	bool run = true;
 	while (run) {
-		glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
-
-		auto curr_ticks = SDL_GetTicks();
-		auto dt = curr_ticks - last_ticks;
-		time_since_last_update += dt;
-
-		while (time_since_last_update > time_per_frame) {
-			time_since_last_update -= time_per_frame;
+		const auto frame_start = Clock::now();
+		{
+			TE_PROFILE_ZONE("poll_events");
 			SDL_Event evt;
 			while (SDL_PollEvent(&evt)) {
 				if (evt.type == SDL_QUIT || (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_ESCAPE)) {
 					run = false;
 				}
-				input_game(data, evt);
+				// Dumps the zones still buffered, about the last 18 seconds,
+				// holding the simulation so its ring is not lapped mid-dump.
+				if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F9 && is_profiling()) {
+					std::lock_guard<std::mutex> lock{ sim_mutex };
+					write_chrome_trace("trace.json");
+				}
+				std::lock_guard<std::mutex> lock{ event_mutex };
+				pending_events.push_back(evt);
 			}
-			step_game(data, time_per_frame_s);
+			Player_inputs inputs;
+			sample_inputs(data, inputs);
+			std::lock_guard<std::mutex> lock{ event_mutex };
+			pending_inputs.swap(inputs);
+		}
+		if (data.level_streamer) {
+			std::lock_guard<std::mutex> lock{ sim_mutex };
+			stream_level(data);
+		}
+		if (p_hot_reloader) {
+			std::lock_guard<std::mutex> lock{ sim_mutex };
+			p_hot_reloader->update(data);
 		}
 
-		draw_game(data);
-		SDL_GL_SwapWindow(pWindow);
+		data.texture_loader->upload(texture_upload_budget_s);
+		const auto& frame = render_frames.acquire();
+		const std::chrono::duration<float> since_tick = Clock::now() - frame.tick_time;
+		const auto alpha = std::min(std::max(since_tick.count() / time_per_tick_s, 0.f), 1.f);
+		glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+		draw_game(data, frame, alpha);
+		{
+			TE_PROFILE_ZONE("swap_window");
+			SDL_GL_SwapWindow(pWindow);
+		}
+		mark_profile_frame();
 
-		last_ticks = curr_ticks;
+		std::this_thread::sleep_until(frame_start + time_per_frame);
 	}
+	sim_thread.join();
 
 	return 0;
 }
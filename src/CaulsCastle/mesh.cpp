@@ -5,10 +5,6 @@ namespace te {
 
 Mesh2 make_mesh(const Sprite_record& record, GLuint gl_texture_id)
 {
-	using Vertex = decltype(Mesh2::vertices)::value_type;
-	using Position_coord = decltype(Vertex::position_value_type::x);
-	using Tex_coord = decltype(Vertex::tex_value_type::x);
-
 	glBindTexture(GL_TEXTURE_2D, gl_texture_id);
 
 	GLint tex_width, tex_height;
@@ -17,6 +13,15 @@ Mesh2 make_mesh(const Sprite_record& record, GLuint gl_texture_id)
 
 	glBindTexture(GL_TEXTURE_2D, NULL);
 
+	return make_mesh(record, gl_texture_id, tex_width, tex_height);
+}
+
+Mesh2 make_mesh(const Sprite_record& record, GLuint gl_texture_id, GLint tex_width, GLint tex_height)
+{
+	using Vertex = decltype(Mesh2::vertices)::value_type;
+	using Position_coord = decltype(Vertex::position_value_type::x);
+	using Tex_coord = decltype(Vertex::tex_value_type::x);
+
 	decltype(Mesh2::vertices) quad(4);
 	quad[0].tex_coords = { (Tex_coord)(record.x) / tex_width,
 			       (Tex_coord)(record.y) / tex_height };
@@ -0,0 +1,178 @@
+#ifndef TE_MULTI_COMPONENT_H
+#define TE_MULTI_COMPONENT_H
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cassert>
+
+namespace te {
+
+// Several values per key, stored contiguously and grouped by key so that
+// all entries of a key form a single range that can be looked up in O(1).
+template <typename K, typename V>
+class Multi_component {
+public:
+	using key_type = K;
+	using mapped_type = V;
+	using value_type = std::pair<K, V>;
+	using size_type = size_t;
+	using iterator = typename std::vector<value_type>::iterator;
+	using const_iterator = typename std::vector<value_type>::const_iterator;
+
+	template <typename T = value_type>
+	iterator insert(T&& value)
+	{
+		const auto key = value.first;
+		auto found = m_index.find(key);
+		if (found == m_index.end()) {
+			m_index.insert({ key, Range{ m_entries.size(), 1u } });
+			m_entries.push_back(std::forward<T>(value));
+			return m_entries.end() - 1;
+		}
+
+		auto& range = found->second;
+		const auto slot = range.first + range.count;
+		++range.count;
+		if (slot == m_entries.size()) {
+			m_entries.push_back(std::forward<T>(value));
+			return m_entries.end() - 1;
+		}
+		auto inserted = m_entries.insert(m_entries.begin() + slot, std::forward<T>(value));
+		shift_ranges(slot + 1, 1);
+		return inserted;
+	}
+
+	size_type erase(const K& key)
+	{
+		auto found = m_index.find(key);
+		if (found == m_index.end()) {
+			return 0;
+		}
+		const auto range = found->second;
+		m_index.erase(found);
+		m_entries.erase(m_entries.begin() + range.first, m_entries.begin() + range.first + range.count);
+		shift_ranges(range.first, -static_cast<std::ptrdiff_t>(range.count));
+		return range.count;
+	}
+
+	// Erases several keys with a single compaction of the entries.
+	template <typename Iter>
+	size_type erase_keys(Iter first, Iter last)
+	{
+		size_type erased = 0;
+		for (; first != last; ++first) {
+			auto found = m_index.find(*first);
+			if (found != m_index.end()) {
+				erased += found->second.count;
+				m_index.erase(found);
+			}
+		}
+		if (erased == 0) {
+			return 0;
+		}
+
+		m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [this](const value_type& entry) {
+			return m_index.find(entry.first) == m_index.end();
+		}), m_entries.end());
+		for (size_type i = 0; i < m_entries.size();) {
+			auto& range = m_index.find(m_entries[i].first)->second;
+			range.first = i;
+			i += range.count;
+		}
+		return erased;
+	}
+
+	// Replaces the contents with entries grouped by key, e.g. as iterated
+	// from another Multi_component.
+	template <typename Iter>
+	void assign(Iter first, Iter last)
+	{
+		m_entries.assign(first, last);
+		m_index.clear();
+		for (size_type i = 0; i < m_entries.size(); ++i) {
+			auto inserted = m_index.insert({ m_entries[i].first, Range{ i, 0u } });
+			auto& range = inserted.first->second;
+			assert(range.first + range.count == i);
+			++range.count;
+		}
+	}
+
+	std::pair<iterator, iterator> equal_range(const K& key)
+	{
+		auto found = m_index.find(key);
+		if (found == m_index.end()) {
+			return{ m_entries.end(), m_entries.end() };
+		}
+		auto first = m_entries.begin() + found->second.first;
+		return{ first, first + found->second.count };
+	}
+	std::pair<const_iterator, const_iterator> equal_range(const K& key) const
+	{
+		auto found = m_index.find(key);
+		if (found == m_index.end()) {
+			return{ m_entries.end(), m_entries.end() };
+		}
+		auto first = m_entries.begin() + found->second.first;
+		return{ first, first + found->second.count };
+	}
+
+	iterator find(const K& key) { return equal_range(key).first; }
+	const_iterator find(const K& key) const { return equal_range(key).first; }
+
+	size_type count(const K& key) const
+	{
+		auto found = m_index.find(key);
+		return found != m_index.end() ? found->second.count : 0;
+	}
+
+	value_type& operator[](size_type slot) { return m_entries[slot]; }
+	const value_type& operator[](size_type slot) const { return m_entries[slot]; }
+
+	iterator begin() noexcept { return m_entries.begin(); }
+	const_iterator begin() const noexcept { return m_entries.begin(); }
+	iterator end() noexcept { return m_entries.end(); }
+	const_iterator end() const noexcept { return m_entries.end(); }
+
+	size_type size() const noexcept { return m_entries.size(); }
+	bool empty() const noexcept { return m_entries.empty(); }
+
+	void reserve(size_type capacity)
+	{
+		m_entries.reserve(capacity);
+		m_index.reserve(capacity);
+	}
+
+	void clear() noexcept
+	{
+		m_entries.clear();
+		m_index.clear();
+	}
+
+private:
+	struct Range {
+		size_type first;
+		size_type count;
+	};
+
+	// Ranges are contiguous, so every range starting at or after `slot` is
+	// found by walking the entries once and skipping each range in turn.
+	void shift_ranges(size_type slot, std::ptrdiff_t offset)
+	{
+		for (auto i = slot; i < m_entries.size();) {
+			auto& range = m_index.find(m_entries[i].first)->second;
+			assert(range.first == i - offset);
+			range.first = i;
+			i += range.count;
+		}
+	}
+
+	std::vector<value_type> m_entries;
+	std::unordered_map<K, Range> m_index;
+};
+
+} // namespace te
+
+#endif
@@ -9,7 +9,7 @@ void Normal_state_table::step_entering(Entity_id entity_id, Game_data& data, flo
 	const auto heading = data.headings[entity_id];
 	const auto x_mag = std::abs(heading.x);
 	const auto y_mag = std::abs(heading.y);
-	const auto& animation_group = data.entity_animation_groups[entity_id];
+	const auto& animation_group = *data.entity_animation_groups[entity_id];
 	auto& animator = data.entity_animations2[entity_id];
 
 	animation_group.lookup_table.get(
@@ -25,9 +25,9 @@ void Normal_state_table::step_input(Entity_id entity_id, Game_data& data)
 	for (auto& input_pair : data.inputs) {
 		const auto player_id = input_pair.first;
 		const auto& input = input_pair.second;
-		const auto player_entity_id = data.avatars[player_id];
+		const auto avatar_found = data.avatars.find(player_id);
 
-		if (player_entity_id == entity_id) {
+		if (avatar_found != data.avatars.end() && avatar_found->second == entity_id) {
 			auto max_speed = data.max_speeds[entity_id];
 			auto input_mag = glm::length(glm::vec2{ input.x_movement, input.y_movement });
 			const auto speed = max_speed * input_mag;
@@ -49,7 +49,7 @@ void Normal_state_table::step_input(Entity_id entity_id, Game_data& data)
 
 void Normal_state_table::step_animation(Entity_id entity_id, Game_data& data)
 {
-	const auto& group = data.entity_animation_groups[entity_id];
+	const auto& group = *data.entity_animation_groups[entity_id];
 	const auto speed = data.speeds[entity_id];
 	const auto heading = data.headings[entity_id];
 	auto& animation = data.entity_animations2[entity_id];
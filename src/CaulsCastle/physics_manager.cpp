@@ -1,9 +1,13 @@
 #include "physics_manager.h"
 #include <Box2D/Box2D.h>
+#include <algorithm>
+#include <cstdint>
 #include <cassert>
 
 namespace te {
 
+static const size_t default_pool_limit = 64;
+
 class Physics_manager::Listener : public b2ContactListener {
 	void BeginContact(b2Contact* p_contact) override
 	{
@@ -17,8 +21,11 @@ Physics_manager::Physics_manager(Game_data& data)
 	: m_game_data{ data }
 	, mp_listener{ std::make_unique<Physics_manager::Listener>() }
 	, mp_world{ std::make_unique<b2World>(b2Vec2{ 0, 0 }) }
-	, m_id_list{}
 	, m_rigid_bodies{}
+	, m_pool_keys{}
+	, m_body_pool{}
+	, m_pooled_count{ 0 }
+	, m_pool_limit{ default_pool_limit }
 {
 	mp_world->SetContactListener(mp_listener.get());
 }
@@ -32,23 +39,201 @@ void Physics_manager::step(float dt, int velocity_iterations, int position_itera
 
 b2Body& Physics_manager::add_rigid_body(Entity_id entity_id, const b2BodyDef& body_def)
 {
-	decltype(m_rigid_bodies)::mapped_type up_rigid_body{ mp_world->CreateBody(&body_def), { *mp_world } };
+	Body_ptr p_rigid_body{ mp_world->CreateBody(&body_def), { *mp_world } };
+	auto& body = *p_rigid_body;
+	set_entity_id(body, entity_id);
 	auto inserted = m_rigid_bodies.insert(decltype(m_rigid_bodies)::value_type{
 		entity_id,
-		std::move(up_rigid_body)
+		std::move(p_rigid_body)
 	});
 	assert(inserted.second);
-	m_id_list.push_back(entity_id);
-	auto& body = *inserted.first->second;
-	body.SetUserData(&m_id_list.back());
 	return body;
 }
 
+std::pair<b2Body*, bool> Physics_manager::acquire_rigid_body(Entity_id entity_id, const b2BodyDef& body_def, Body_pool_key pool_key)
+{
+	m_pool_keys[entity_id] = pool_key;
+
+	auto pool_found = m_body_pool.find(pool_key);
+	if (pool_found == m_body_pool.end() || pool_found->second.empty()) {
+		return{ &add_rigid_body(entity_id, body_def), false };
+	}
+
+	auto& pool = pool_found->second;
+	auto p_rigid_body = std::move(pool.back());
+	pool.pop_back();
+	--m_pooled_count;
+
+	auto& body = *p_rigid_body;
+	body.SetTransform(body_def.position, body_def.angle);
+	body.SetLinearVelocity(body_def.linearVelocity);
+	body.SetAngularVelocity(body_def.angularVelocity);
+	body.SetActive(true);
+	body.SetAwake(body_def.awake);
+	set_entity_id(body, entity_id);
+	auto inserted = m_rigid_bodies.insert(decltype(m_rigid_bodies)::value_type{
+		entity_id,
+		std::move(p_rigid_body)
+	});
+	assert(inserted.second);
+	return{ &body, true };
+}
+
+void Physics_manager::remove_rigid_body(Entity_id entity_id)
+{
+	auto found = m_rigid_bodies.find(entity_id);
+	assert(found != m_rigid_bodies.end());
+	release(entity_id, std::move(found->second));
+	m_rigid_bodies.erase(found);
+}
+
+void Physics_manager::remove_rigid_bodies(const std::vector<Entity_id>& sorted_ids)
+{
+	assert(std::is_sorted(sorted_ids.begin(), sorted_ids.end()));
+	bool released = false;
+	for (auto entity_id : sorted_ids) {
+		auto found = m_rigid_bodies.find(entity_id);
+		if (found != m_rigid_bodies.end()) {
+			release(entity_id, std::move(found->second));
+			released = true;
+		}
+	}
+	if (released) {
+		m_rigid_bodies.erase(std::remove_if(m_rigid_bodies.begin(), m_rigid_bodies.end(), [](const decltype(m_rigid_bodies)::value_type& body_pair) {
+			return !body_pair.second;
+		}), m_rigid_bodies.end());
+	}
+}
+
 void Physics_manager::query_aabb(b2QueryCallback& callback, const b2AABB& aabb) const
 {
 	return mp_world->QueryAABB(&callback, aabb);
 }
 
+void Physics_manager::clear_pool(Body_pool_key pool_key)
+{
+	auto found = m_body_pool.find(pool_key);
+	if (found != m_body_pool.end()) {
+		m_pooled_count -= found->second.size();
+		m_body_pool.erase(found);
+	}
+}
+
+void Physics_manager::set_pool_limit(size_t max_pooled_per_key)
+{
+	m_pool_limit = max_pooled_per_key;
+	for (auto& pool_pair : m_body_pool) {
+		auto& pool = pool_pair.second;
+		if (pool.size() > m_pool_limit) {
+			const auto excess = pool.size() - m_pool_limit;
+			pool.erase(pool.begin(), pool.begin() + excess);
+			m_pooled_count -= excess;
+		}
+	}
+}
+
+size_t Physics_manager::get_pool_limit() const noexcept
+{
+	return m_pool_limit;
+}
+
+void Physics_manager::rebuild_world()
+{
+	auto p_world = std::make_unique<b2World>(mp_world->GetGravity());
+	p_world->SetContactListener(mp_listener.get());
+	std::vector<const b2Fixture*> fixtures;
+	for (auto& body_pair : m_rigid_bodies) {
+		const auto& body = *body_pair.second;
+		b2BodyDef body_def;
+		body_def.type = body.GetType();
+		body_def.position = body.GetPosition();
+		body_def.angle = body.GetAngle();
+		body_def.linearVelocity = body.GetLinearVelocity();
+		body_def.angularVelocity = body.GetAngularVelocity();
+		body_def.linearDamping = body.GetLinearDamping();
+		body_def.angularDamping = body.GetAngularDamping();
+		body_def.allowSleep = body.IsSleepingAllowed();
+		body_def.awake = body.IsAwake();
+		body_def.fixedRotation = body.IsFixedRotation();
+		body_def.bullet = body.IsBullet();
+		body_def.active = body.IsActive();
+		body_def.userData = body.GetUserData();
+		body_def.gravityScale = body.GetGravityScale();
+		auto* p_rebuilt = p_world->CreateBody(&body_def);
+
+		// CreateFixture prepends, so the list is copied back to front to
+		// keep its order.
+		fixtures.clear();
+		for (const auto* p_fixture = body.GetFixtureList(); p_fixture != nullptr; p_fixture = p_fixture->GetNext()) {
+			fixtures.push_back(p_fixture);
+		}
+		for (auto it = fixtures.rbegin(); it != fixtures.rend(); ++it) {
+			const auto& fixture = **it;
+			b2FixtureDef fixture_def;
+			fixture_def.shape = fixture.GetShape();
+			fixture_def.userData = fixture.GetUserData();
+			fixture_def.friction = fixture.GetFriction();
+			fixture_def.restitution = fixture.GetRestitution();
+			fixture_def.density = fixture.GetDensity();
+			fixture_def.isSensor = fixture.IsSensor();
+			fixture_def.filter = fixture.GetFilterData();
+			p_rebuilt->CreateFixture(&fixture_def);
+		}
+
+		// The old world frees the old body along with itself.
+		body_pair.second.release();
+		body_pair.second = Body_ptr{ p_rebuilt, { *p_world } };
+	}
+	// Which parked body an entity gets decides where it is in the body
+	// list, and so the order islands are solved in; none are kept so that
+	// every rebuild of the same bodies hands out the same ones after it.
+	for (auto& pool_pair : m_body_pool) {
+		for (auto& p_body : pool_pair.second) {
+			p_body.release();
+		}
+	}
+	m_body_pool.clear();
+	m_pooled_count = 0;
+	mp_world = std::move(p_world);
+}
+
+size_t Physics_manager::get_pooled_count() const noexcept
+{
+	return m_pooled_count;
+}
+
+// The id is stored in the user data pointer itself rather than pointed to.
+Entity_id Physics_manager::get_entity_id(const b2Body& body)
+{
+	return static_cast<Entity_id>(reinterpret_cast<std::intptr_t>(body.GetUserData()));
+}
+
+void Physics_manager::set_entity_id(b2Body& body, Entity_id entity_id)
+{
+	body.SetUserData(reinterpret_cast<void*>(static_cast<std::intptr_t>(entity_id)));
+}
+
+void Physics_manager::release(Entity_id entity_id, Body_ptr&& p_body)
+{
+	auto key_found = m_pool_keys.find(entity_id);
+	if (key_found == m_pool_keys.end()) {
+		p_body.reset();
+		return;
+	}
+
+	auto& pool = m_body_pool[key_found->second];
+	m_pool_keys.erase(key_found);
+	if (pool.size() < m_pool_limit) {
+		// Inactive bodies leave the broad-phase and lose their contacts.
+		p_body->SetActive(false);
+		pool.push_back(std::move(p_body));
+		++m_pooled_count;
+	}
+	else {
+		p_body.reset();
+	}
+}
+
 Physics_manager::Body_deleter::Body_deleter(b2World& world)
 	: p_world{ &world }
 {}
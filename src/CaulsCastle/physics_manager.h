@@ -4,7 +4,9 @@
 #include "types.h"
 #include <boost/container/flat_map.hpp>
 #include <memory>
-#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 class b2World;
 class b2Body;
@@ -17,12 +19,43 @@ namespace te {
 struct Game_data;
 
 class Physics_manager {
+	struct Body_deleter {
+		Body_deleter(b2World& world);
+		void operator()(b2Body*) const;
+		b2World* p_world;
+	};
+	using Body_ptr = std::unique_ptr<b2Body, Body_deleter>;
 public:
+	// Bodies acquired under the same key must have the same fixtures, e.g.
+	// the Entity_xml they were built from.
+	using Body_pool_key = const void*;
+
 	Physics_manager(Game_data& data);
 	~Physics_manager();
 
 	void step(float dt, int velocity_iterations = 8, int position_iterations = 3);
 	b2Body& add_rigid_body(Entity_id entity_id, const b2BodyDef& body_def);
+	// Revives a body parked under `pool_key` by remove_rigid_body, moved to
+	// body_def's position with its fixtures intact, or adds a new one. The
+	// second member is false when the body is new and needs fixtures.
+	std::pair<b2Body*, bool> acquire_rigid_body(Entity_id entity_id, const b2BodyDef& body_def, Body_pool_key pool_key);
+	// Acquired bodies are parked inactive for reuse, up to a limit per key;
+	// others are destroyed along with their fixtures and contacts.
+	void remove_rigid_body(Entity_id entity_id);
+	// remove_rigid_body for every id in a sorted vector, compacting once.
+	void remove_rigid_bodies(const std::vector<Entity_id>& sorted_ids);
+	// Destroys the bodies parked under `pool_key`, e.g. once the fixtures
+	// for that key have changed.
+	void clear_pool(Body_pool_key pool_key);
+	// The most bodies parked per key. Lowering it destroys the bodies
+	// parked longest over the new limit.
+	void set_pool_limit(size_t max_pooled_per_key);
+	size_t get_pool_limit() const noexcept;
+	// Moves every body into a new world, made in entity id order, and
+	// destroys the parked ones. Contacts are found again on the next step
+	// and sleep timers start from zero, so how the world steps on depends
+	// only on the bodies' states and not on how they got there.
+	void rebuild_world();
 	auto find_rigid_body(Entity_id id) { return m_rigid_bodies.find(id); }
 	auto find_rigid_body(Entity_id id) const { return m_rigid_bodies.find(id); }
 	auto begin() noexcept { return m_rigid_bodies.begin(); }
@@ -30,19 +63,23 @@ public:
 	auto end() noexcept { return m_rigid_bodies.end(); }
 	auto end() const noexcept { return m_rigid_bodies.end(); }
 	void query_aabb(b2QueryCallback& callback, const b2AABB& aabb) const;
+	size_t get_pooled_count() const noexcept;
+
+	static Entity_id get_entity_id(const b2Body& body);
 private:
-	struct Body_deleter {
-		Body_deleter(b2World& world);
-		void operator()(b2Body*) const;
-		b2World* p_world;
-	};
 	class Listener;
 
+	void set_entity_id(b2Body& body, Entity_id entity_id);
+	void release(Entity_id entity_id, Body_ptr&& p_body);
+
 	Game_data& m_game_data;
 	std::unique_ptr<Listener> mp_listener;
 	std::unique_ptr<b2World> mp_world;
-	std::list<Entity_id> m_id_list;
-	flat_map<Entity_id, std::unique_ptr<b2Body, Body_deleter>> m_rigid_bodies;
+	flat_map<Entity_id, Body_ptr> m_rigid_bodies;
+	flat_map<Entity_id, Body_pool_key> m_pool_keys;
+	std::unordered_map<Body_pool_key, std::vector<Body_ptr>> m_body_pool;
+	size_t m_pooled_count;
+	size_t m_pool_limit;
 };
 
 } // namespace te
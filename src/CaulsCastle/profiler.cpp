@@ -0,0 +1,200 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace te {
+
+namespace detail {
+
+std::atomic<bool> profiling{ false };
+
+} // namespace detail
+
+namespace {
+
+// Per thread; at 30 zones a frame this holds the last 18 seconds at 60 Hz.
+const size_t zone_capacity = 1 << 15;
+const size_t frame_window = 1024;
+
+struct Zone {
+	const char* name;
+	std::int64_t begin_ns;
+	std::int64_t end_ns;
+};
+
+// Written only by its own thread. The count is published after the zone,
+// so a reader that rechecks the count after copying can tell which zones
+// the ring lapped while it read.
+struct Thread_zones {
+	explicit Thread_zones(unsigned thread_index)
+		: zones(zone_capacity)
+		, write_count{ 0 }
+		, thread_index{ thread_index }
+	{}
+
+	std::vector<Zone> zones;
+	std::atomic<std::uint64_t> write_count;
+	unsigned thread_index;
+};
+
+// Buffers outlive their threads so a trace still has the zones of workers
+// that have exited.
+struct Registry {
+	Registry()
+		: mutex{}
+		, threads{}
+		, epoch{ Profile_clock::now() }
+	{}
+
+	std::mutex mutex;
+	std::vector<std::unique_ptr<Thread_zones>> threads;
+	Profile_clock::time_point epoch;
+};
+
+Registry& get_registry()
+{
+	static Registry registry;
+	return registry;
+}
+
+thread_local Thread_zones* tp_thread_zones = nullptr;
+
+Thread_zones& get_thread_zones()
+{
+	if (tp_thread_zones == nullptr) {
+		auto& registry = get_registry();
+		std::lock_guard<std::mutex> lock{ registry.mutex };
+		const auto thread_index = static_cast<unsigned>(registry.threads.size());
+		registry.threads.push_back(std::make_unique<Thread_zones>(thread_index));
+		tp_thread_zones = registry.threads.back().get();
+	}
+	return *tp_thread_zones;
+}
+
+std::int64_t to_ns(Profile_clock::time_point time)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time - get_registry().epoch).count();
+}
+
+struct Frame_times {
+	Frame_times()
+		: seconds(frame_window)
+		, count{ 0 }
+		, last{}
+	{}
+
+	std::vector<double> seconds;
+	size_t count;
+	Profile_clock::time_point last;
+};
+
+Frame_times frame_times;
+
+void write_json_string(std::ostream& out, const char* s)
+{
+	out << '"';
+	for (; *s != '\0'; ++s) {
+		if (*s == '"' || *s == '\\') {
+			out << '\\';
+		}
+		out << *s;
+	}
+	out << '"';
+}
+
+} // namespace
+
+void detail::record_zone(const char* name, Profile_clock::time_point begin, Profile_clock::time_point end)
+{
+	auto& thread_zones = get_thread_zones();
+	const auto count = thread_zones.write_count.load(std::memory_order_relaxed);
+	thread_zones.zones[count % zone_capacity] = { name, to_ns(begin), to_ns(end) };
+	thread_zones.write_count.store(count + 1, std::memory_order_release);
+}
+
+void set_profiling(bool profiling) noexcept
+{
+	detail::profiling = profiling;
+}
+
+bool is_profiling() noexcept
+{
+	return detail::profiling;
+}
+
+void mark_profile_frame()
+{
+	const auto now = Profile_clock::now();
+	if (is_profiling() && frame_times.last != Profile_clock::time_point{}) {
+		const std::chrono::duration<double> elapsed = now - frame_times.last;
+		frame_times.seconds[frame_times.count++ % frame_window] = elapsed.count();
+	}
+	frame_times.last = now;
+}
+
+Frame_time_percentiles get_frame_time_percentiles()
+{
+	const auto count = std::min(frame_times.count, frame_window);
+	if (count == 0) {
+		return{ 0.0, 0.0, 0.0, 0 };
+	}
+	std::vector<double> sorted{ frame_times.seconds.begin(), frame_times.seconds.begin() + count };
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&sorted](size_t percent) {
+		return sorted[std::min(sorted.size() - 1, sorted.size() * percent / 100)];
+	};
+	return{ percentile(50), percentile(95), percentile(99), count };
+}
+
+bool write_chrome_trace(const std::string& filename)
+{
+	std::ofstream out{ filename, std::ios::trunc };
+	if (!out.is_open()) {
+		return false;
+	}
+	out << std::fixed << std::setprecision(3);
+	out << "{\"traceEvents\":[\n";
+
+	auto& registry = get_registry();
+	std::lock_guard<std::mutex> lock{ registry.mutex };
+	std::vector<Zone> zones;
+	bool first_event = true;
+	for (const auto& p_thread_zones : registry.threads) {
+		const auto& thread_zones = *p_thread_zones;
+		const auto tid = thread_zones.thread_index;
+		out << (first_event ? "" : ",\n")
+		    << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+		    << ",\"args\":{\"name\":\"thread " << tid << "\"}}";
+		first_event = false;
+
+		// Copies the ring, then drops the zones its thread may have
+		// overwritten meanwhile, including the one it may be writing now.
+		const auto count = thread_zones.write_count.load(std::memory_order_acquire);
+		const auto first = count > zone_capacity ? count - zone_capacity : 0;
+		zones.clear();
+		for (auto i = first; i < count; ++i) {
+			zones.push_back(thread_zones.zones[i % zone_capacity]);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const auto count_after = thread_zones.write_count.load(std::memory_order_relaxed);
+		const auto first_kept = count_after + 1 > zone_capacity ? count_after + 1 - zone_capacity : 0;
+		for (auto i = std::max(first, first_kept); i < count; ++i) {
+			const auto& zone = zones[i - first];
+			out << ",\n{\"name\":";
+			write_json_string(out, zone.name);
+			out << ",\"cat\":\"te\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+			    << ",\"ts\":" << zone.begin_ns / 1e3
+			    << ",\"dur\":" << (zone.end_ns - zone.begin_ns) / 1e3 << "}";
+		}
+	}
+	out << "\n]}\n";
+	return out.good();
+}
+
+} // namespace te
@@ -0,0 +1,80 @@
+#ifndef TE_PROFILER_H
+#define TE_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Define TE_PROFILER as 0 to compile every TE_PROFILE_ZONE out.
+#ifndef TE_PROFILER
+#define TE_PROFILER 1
+#endif
+
+namespace te {
+
+using Profile_clock = std::chrono::steady_clock;
+
+namespace detail {
+
+extern std::atomic<bool> profiling;
+
+void record_zone(const char* name, Profile_clock::time_point begin, Profile_clock::time_point end);
+
+} // namespace detail
+
+// Records the time between construction and destruction into the calling
+// thread's ring buffer while profiling is on. The name is kept by pointer,
+// so it must outlive the trace; string literals always do.
+class Profile_zone {
+public:
+	explicit Profile_zone(const char* name)
+		: mp_name{ detail::profiling.load(std::memory_order_relaxed) ? name : nullptr }
+		, m_begin{ mp_name != nullptr ? Profile_clock::now() : Profile_clock::time_point{} }
+	{}
+	~Profile_zone()
+	{
+		if (mp_name != nullptr) {
+			detail::record_zone(mp_name, m_begin, Profile_clock::now());
+		}
+	}
+	Profile_zone(const Profile_zone&) = delete;
+	Profile_zone& operator=(const Profile_zone&) = delete;
+private:
+	const char* mp_name;
+	Profile_clock::time_point m_begin;
+};
+
+struct Frame_time_percentiles {
+	double p50;
+	double p95;
+	double p99;
+	size_t frame_count;
+};
+
+void set_profiling(bool profiling) noexcept;
+bool is_profiling() noexcept;
+
+// Call once per frame from one thread; the time since the previous call is
+// kept in a rolling window of the last frames.
+void mark_profile_frame();
+// In seconds, over the frames in the window.
+Frame_time_percentiles get_frame_time_percentiles();
+
+// Writes the zones still in every thread's ring buffer as Chrome trace_event
+// JSON, loadable in chrome://tracing. Zones a thread overwrites while they
+// are copied are left out; pause threads that record many zones, as the
+// game does with its simulation, to keep their latest zones.
+bool write_chrome_trace(const std::string& filename);
+
+} // namespace te
+
+#if TE_PROFILER
+#define TE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define TE_PROFILE_CONCAT(a, b) TE_PROFILE_CONCAT_IMPL(a, b)
+#define TE_PROFILE_ZONE(name) ::te::Profile_zone TE_PROFILE_CONCAT(te_profile_zone_, __LINE__){ name }
+#else
+#define TE_PROFILE_ZONE(name) ((void)0)
+#endif
+
+#endif
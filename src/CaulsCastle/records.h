@@ -25,10 +25,16 @@ struct Sprite_record {
 	int h;
 	float px;
 	float py;
+	// Range of this sprite's colliders in Game_data::collider_table.
+	size_t first_collider;
+	size_t collider_count;
 };
 
 struct Animation_record {
 	std::string filename;
+	// Range of this animation's frames in Game_data::animation_frame_table.
+	size_t first_frame;
+	size_t frame_count;
 };
 
 struct Animation_frame_record {
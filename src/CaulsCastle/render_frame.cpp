@@ -0,0 +1,118 @@
+#include "render_frame.h"
+#include "game_data.h"
+#include "profiler.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <utility>
+
+namespace te {
+
+namespace {
+
+template <typename Render_data_component, typename Mesh_holder>
+void add_sprites(const Game_data& data,
+		 const Render_data_component& render_data,
+		 const Mesh_holder& meshes,
+		 const glm::mat4& post_translate,
+		 const component<Entity_id, vec2>& previous_positions,
+		 std::vector<Render_frame::Sprite>& sprites,
+		 std::vector<Sprite_batch::Vertex>& vertices)
+{
+	for (const auto& data_pair : render_data) {
+		const auto position_found = data.positions.find(data_pair.first);
+		const auto position = position_found != data.positions.end() ? position_found->second : vec2{};
+		// Entities made this tick are drawn where they are.
+		const auto previous_found = previous_positions.find(data_pair.first);
+		const auto previous_position = previous_found != previous_positions.end() ? previous_found->second : position;
+
+		const auto& mesh = meshes.get(data_pair.second.resource_id);
+		const auto transform = post_translate * data_pair.second.transform;
+		sprites.push_back({
+			previous_position,
+			position,
+			mesh.texture_id,
+			mesh.mode,
+			data_pair.second.draw_order,
+			vertices.size(),
+			mesh.vertices.size()
+		});
+		for (const auto& vertex : mesh.vertices) {
+			const auto transformed = transform * detail::to_position4(vertex.position);
+			vertices.push_back({
+				transformed.x,
+				transformed.y,
+				transformed.z,
+				static_cast<GLfloat>(vertex.tex_coords.x),
+				static_cast<GLfloat>(vertex.tex_coords.y)
+			});
+		}
+	}
+}
+
+} // namespace
+
+Render_frame::Render_frame()
+	: sprites3{}
+	, sprites2{}
+	, vertices{}
+	, previous_view_matrix{ 1.f }
+	, view_matrix{ 1.f }
+	, tick_time{}
+{}
+
+Render_frames::Render_frames()
+	: m_frames{}
+	, mp_back{ &m_frames[0] }
+	, mp_ready{ &m_frames[1] }
+	, mp_front{ &m_frames[2] }
+	, m_has_ready{ false }
+	, m_mutex{}
+	, m_previous_positions{}
+	, m_previous_view_matrix{ 1.f }
+	, m_has_previous{ false }
+{}
+
+void Render_frames::publish(const Game_data& data, std::chrono::steady_clock::time_point tick_time)
+{
+	TE_PROFILE_ZONE("publish_render_frame");
+	if (!m_has_previous) {
+		m_previous_positions = data.positions;
+		m_previous_view_matrix = data.view_matrix;
+		m_has_previous = true;
+	}
+	build(data, *mp_back);
+	mp_back->tick_time = tick_time;
+	m_previous_positions = data.positions;
+	m_previous_view_matrix = data.view_matrix;
+
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	std::swap(mp_back, mp_ready);
+	m_has_ready = true;
+}
+
+const Render_frame& Render_frames::acquire()
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	if (m_has_ready) {
+		std::swap(mp_ready, mp_front);
+		m_has_ready = false;
+	}
+	return *mp_front;
+}
+
+void Render_frames::build(const Game_data& data, Render_frame& frame) const
+{
+	frame.sprites3.clear();
+	frame.sprites2.clear();
+	frame.vertices.clear();
+	const auto pixel_scale = glm::scale(glm::vec3(1 / data.pixel_to_world_scale.x,
+						     1 / data.pixel_to_world_scale.y,
+						     1));
+	add_sprites(data, data.entity_meshes3, data.meshes3, pixel_scale, m_previous_positions, frame.sprites3, frame.vertices);
+	add_sprites(data, data.entity_meshes2, data.meshes2, pixel_scale, m_previous_positions, frame.sprites2, frame.vertices);
+	frame.previous_view_matrix = m_previous_view_matrix;
+	frame.view_matrix = data.view_matrix;
+}
+
+} // namespace te
@@ -0,0 +1,82 @@
+#ifndef TE_RENDER_FRAME_H
+#define TE_RENDER_FRAME_H
+
+#include "types.h"
+#include "sprite_batch.h"
+
+#include <SDL_opengl.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace te {
+
+struct Game_data;
+
+// Everything the renderer needs from one simulation tick. Sprite vertices
+// are transformed up to the entity position, which is kept for this tick
+// and the one before so the renderer can draw anywhere in between.
+struct Render_frame {
+	struct Sprite {
+		vec2 previous_position;
+		vec2 position;
+		GLuint texture_id;
+		GLenum mode;
+		int draw_order;
+		size_t first_vertex;
+		size_t vertex_count;
+	};
+
+	Render_frame();
+
+	// From entity_meshes3, drawn below the tile chunks, and entity_meshes2,
+	// drawn above them.
+	std::vector<Sprite> sprites3;
+	std::vector<Sprite> sprites2;
+	std::vector<Sprite_batch::Vertex> vertices;
+	glm::mat4 previous_view_matrix;
+	glm::mat4 view_matrix;
+	// When the tick was due; the renderer is one tick behind, so how far
+	// past this it draws is how far it interpolates towards this tick.
+	std::chrono::steady_clock::time_point tick_time;
+};
+
+// Hands frames from the simulation thread to the render thread through
+// three buffers, so neither waits for the other: the simulation fills the
+// back frame and swaps it with the ready one, the renderer swaps the ready
+// one with the frame it draws. Frames keep their capacity, so publishing
+// every tick does not allocate once they have grown.
+class Render_frames {
+public:
+	Render_frames();
+	Render_frames(const Render_frames&) = delete;
+	Render_frames& operator=(const Render_frames&) = delete;
+
+	// Simulation thread, after each step_game.
+	void publish(const Game_data& data, std::chrono::steady_clock::time_point tick_time);
+
+	// Render thread. Returns the newest published frame, which stays valid
+	// until the next call.
+	const Render_frame& acquire();
+private:
+	void build(const Game_data& data, Render_frame& frame) const;
+
+	std::array<Render_frame, 3> m_frames;
+	Render_frame* mp_back;
+	Render_frame* mp_ready;
+	Render_frame* mp_front;
+	bool m_has_ready;
+	std::mutex m_mutex;
+
+	// Only touched by the simulation thread.
+	component<Entity_id, vec2> m_previous_positions;
+	glm::mat4 m_previous_view_matrix;
+	bool m_has_previous;
+};
+
+} // namespace te
+
+#endif
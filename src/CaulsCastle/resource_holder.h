@@ -3,25 +3,38 @@
 
 #include "types.h"
 
+#include <functional>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+
 namespace te {
 
+template <typename Resource>
+class Resource_holder;
+
+// Index into a Resource_holder's slots plus the generation of the slot at
+// the time the resource was inserted. A default-constructed id has
+// generation 0, which is never issued, so it never resolves.
 template <typename Resource>
 class Resource_id {
-	template <typename T = Resource>
-	friend class Resource_holder;
-	template <typename T = Resource_id>
-	friend struct ::std::hash;
-	Resource_id(int id)
-		: m_id{ id }
+	friend class Resource_holder<Resource>;
+	friend struct ::std::hash<Resource_id>;
+	Resource_id(std::uint32_t index, std::uint32_t generation)
+		: m_index{ index }
+		, m_generation{ generation }
 	{}
-	int m_id;
+	std::uint32_t m_index;
+	std::uint32_t m_generation;
 public:
 	Resource_id()
-		: m_id{ 0 }
+		: m_index{ 0 }
+		, m_generation{ 0 }
 	{}
 	inline bool operator==(const Resource_id& rhs) const
 	{
-		return m_id == rhs.m_id;
+		return m_index == rhs.m_index && m_generation == rhs.m_generation;
 	}
 	inline bool operator!=(const Resource_id& rhs) const
 	{
@@ -29,32 +42,93 @@ public:
 	}
 };
 
+// Slot map: ids resolve through a sparse slot array into a densely packed
+// resource array. Erasing swaps the last resource into the hole, so
+// resources stay contiguous and iteration is a linear walk.
 template <typename Resource>
 class Resource_holder {
 public:
 	using Id = Resource_id<Resource>;
+	using iterator = typename std::vector<Resource>::iterator;
+	using const_iterator = typename std::vector<Resource>::const_iterator;
 
 	template <typename T = Resource>
 	Id insert(T&& resource)
 	{
-		m_resource_map.insert(std::pair<int, Resource>{ next_id, std::forward<T>(resource) });
-		return{ next_id++ };
+		std::uint32_t slot_index;
+		if (m_free_slots.empty()) {
+			slot_index = static_cast<std::uint32_t>(m_slots.size());
+			m_slots.push_back({ 0, 1 });
+		}
+		else {
+			slot_index = m_free_slots.back();
+			m_free_slots.pop_back();
+		}
+
+		auto& slot = m_slots[slot_index];
+		slot.dense_index = static_cast<std::uint32_t>(m_resources.size());
+		m_resources.push_back(std::forward<T>(resource));
+		m_dense_to_slot.push_back(slot_index);
+		return{ slot_index, slot.generation };
+	}
+
+	void erase(Id id)
+	{
+		assert(contains(id));
+		auto& slot = m_slots[id.m_index];
+		const auto dense_index = slot.dense_index;
+		const auto last_index = static_cast<std::uint32_t>(m_resources.size() - 1);
+		if (dense_index != last_index) {
+			m_resources[dense_index] = std::move(m_resources[last_index]);
+			m_dense_to_slot[dense_index] = m_dense_to_slot[last_index];
+			m_slots[m_dense_to_slot[dense_index]].dense_index = dense_index;
+		}
+		m_resources.pop_back();
+		m_dense_to_slot.pop_back();
+
+		++slot.generation;
+		m_free_slots.push_back(id.m_index);
+	}
+
+	bool contains(Id id) const
+	{
+		return id.m_index < m_slots.size()
+			&& m_slots[id.m_index].generation == id.m_generation;
 	}
 
 	Resource& get(Id id)
 	{
-		auto found = m_resource_map.find(id.m_id);
-		assert(found != m_resource_map.end());
-		return found->second;
+		assert(contains(id));
+		return m_resources[m_slots[id.m_index].dense_index];
+	}
+	const Resource& get(Id id) const
+	{
+		assert(contains(id));
+		return m_resources[m_slots[id.m_index].dense_index];
 	}
 
+	iterator begin() noexcept { return m_resources.begin(); }
+	const_iterator begin() const noexcept { return m_resources.begin(); }
+	iterator end() noexcept { return m_resources.end(); }
+	const_iterator end() const noexcept { return m_resources.end(); }
+	size_t size() const noexcept { return m_resources.size(); }
+
 	Resource_holder()
-		: next_id{ 1 }
-		, m_resource_map{}
+		: m_slots{}
+		, m_free_slots{}
+		, m_resources{}
+		, m_dense_to_slot{}
 	{}
 private:
-	int next_id;
-	flat_map<int, Resource> m_resource_map;
+	struct Slot {
+		std::uint32_t dense_index;
+		std::uint32_t generation;
+	};
+
+	std::vector<Slot> m_slots;
+	std::vector<std::uint32_t> m_free_slots;
+	std::vector<Resource> m_resources;
+	std::vector<std::uint32_t> m_dense_to_slot;
 };
 
 } // namespace te
@@ -66,7 +140,7 @@ struct hash<te::Resource_id<T>>
 {
 	size_t operator()(const te::Resource_id<T>& id) const
 	{
-		return std::hash<int>{}(id.m_id);
+		return std::hash<std::uint64_t>{}((static_cast<std::uint64_t>(id.m_generation) << 32) | id.m_index);
 	}
 };
 
@@ -0,0 +1,285 @@
+#include "snapshot.h"
+#include "game_data.h"
+#include "entity.h"
+#include "profiler.h"
+
+#include <Box2D/Box2D.h>
+#include <boost/container/flat_map.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <cassert>
+
+namespace te {
+
+namespace {
+
+const char snapshot_magic[4] = { 'C', 'C', 'S', 'N' };
+const std::uint32_t snapshot_version = 3;
+
+// Every value starts on an 8-byte boundary so arrays can be read in place,
+// as in the asset pack.
+const size_t snapshot_alignment = 8;
+
+struct Body_state {
+	Entity_id entity_id;
+	b2Vec2 position;
+	float angle;
+	b2Vec2 linear_velocity;
+	float angular_velocity;
+	bool awake;
+};
+// Written one at a time but read back as an array.
+static_assert(sizeof(Body_state) % snapshot_alignment == 0, "Body_state must not need padding");
+
+class Snapshot_writer {
+public:
+	explicit Snapshot_writer(std::vector<char>& bytes)
+		: m_bytes{ bytes }
+	{}
+
+	template <typename T>
+	void write(const T& value)
+	{
+		write_bytes(&value, sizeof(T));
+	}
+	template <typename T>
+	void write_array(const T* p_values, size_t count)
+	{
+		write(count);
+		write_bytes(p_values, count * sizeof(T));
+	}
+	template <typename T>
+	void write_vector(const std::vector<T>& values)
+	{
+		write_array(values.data(), values.size());
+	}
+	// Flat maps and Multi_components keep their pairs contiguous.
+	template <typename Map>
+	void write_pairs(const Map& map)
+	{
+		write_array(map.empty() ? nullptr : &*map.begin(), map.size());
+	}
+private:
+	void write_bytes(const void* p, size_t size)
+	{
+		const auto offset = m_bytes.size();
+		m_bytes.resize(offset + (size + snapshot_alignment - 1) / snapshot_alignment * snapshot_alignment);
+		if (size > 0) {
+			std::memcpy(m_bytes.data() + offset, p, size);
+		}
+	}
+
+	std::vector<char>& m_bytes;
+};
+
+class Snapshot_reader {
+public:
+	explicit Snapshot_reader(const std::vector<char>& bytes)
+		: m_bytes{ bytes }
+		, m_offset{ 0 }
+	{}
+
+	template <typename T>
+	const T& read()
+	{
+		return *read_array_in_place<T>(1);
+	}
+	template <typename T>
+	std::pair<const T*, const T*> read_array()
+	{
+		const auto count = read<size_t>();
+		const auto* p_first = read_array_in_place<T>(count);
+		return{ p_first, p_first + count };
+	}
+	template <typename T>
+	void read_vector(std::vector<T>& values)
+	{
+		const auto range = read_array<T>();
+		values.assign(range.first, range.second);
+	}
+	template <typename K, typename V>
+	void read_pairs(flat_map<K, V>& map)
+	{
+		const auto range = read_array<std::pair<K, V>>();
+		map.clear();
+		map.insert(boost::container::ordered_unique_range, range.first, range.second);
+	}
+	template <typename K, typename V>
+	void read_pairs(Multi_component<K, V>& map)
+	{
+		const auto range = read_array<std::pair<K, V>>();
+		map.assign(range.first, range.second);
+	}
+
+	bool at_end() const noexcept
+	{
+		return m_offset == m_bytes.size();
+	}
+private:
+	template <typename T>
+	const T* read_array_in_place(size_t count)
+	{
+		const auto size = count * sizeof(T);
+		assert(m_offset + size <= m_bytes.size());
+		const auto* p = reinterpret_cast<const T*>(m_bytes.data() + m_offset);
+		m_offset += (size + snapshot_alignment - 1) / snapshot_alignment * snapshot_alignment;
+		return p;
+	}
+
+	const std::vector<char>& m_bytes;
+	size_t m_offset;
+};
+
+// The transform is only written back when it changed, so restoring a body
+// to where it is leaves its broad-phase proxies alone.
+void restore_body(b2Body& body, const Body_state& state)
+{
+	if (!(body.GetPosition() == state.position) || body.GetAngle() != state.angle) {
+		body.SetTransform(state.position, state.angle);
+	}
+	body.SetAwake(state.awake);
+	body.SetLinearVelocity(state.linear_velocity);
+	body.SetAngularVelocity(state.angular_velocity);
+}
+
+} // namespace
+
+Snapshot::Snapshot()
+	: m_bytes{}
+{}
+
+void Snapshot::save(Game_data& data)
+{
+	TE_PROFILE_ZONE("save_snapshot");
+	data.physics_manager.rebuild_world();
+	m_bytes.clear();
+	Snapshot_writer writer{ m_bytes };
+	writer.write(snapshot_magic);
+	writer.write(snapshot_version);
+
+	writer.write(data.entity_manager.get_next_id());
+	writer.write_pairs(data.entity_xmls);
+	size_t body_count = 0;
+	for (const auto& entity_pair : data.entity_xmls) {
+		body_count += data.physics_manager.find_rigid_body(entity_pair.first) != data.physics_manager.end();
+	}
+	writer.write(body_count);
+	for (const auto& entity_pair : data.entity_xmls) {
+		auto found = data.physics_manager.find_rigid_body(entity_pair.first);
+		if (found != data.physics_manager.end()) {
+			const auto& body = *found->second;
+			writer.write(Body_state{
+				entity_pair.first,
+				body.GetPosition(),
+				body.GetAngle(),
+				body.GetLinearVelocity(),
+				body.GetAngularVelocity(),
+				body.IsAwake()
+			});
+		}
+	}
+	writer.write_pairs(data.inputs);
+	writer.write_pairs(data.avatars);
+
+	writer.write_pairs(data.max_speeds);
+	writer.write_pairs(data.speeds);
+	writer.write_pairs(data.headings);
+	writer.write_pairs(data.positions);
+	writer.write_pairs(data.entity_team_masks);
+	writer.write_pairs(data.stats);
+	writer.write_pairs(data.entity_animations2);
+	writer.write_pairs(data.entity_meshes2);
+	writer.write_pairs(data.entity_meshes3);
+
+	data.normal_state_table.save(writer);
+	data.light_attack_state_table.save(writer);
+	writer.write_vector(data.attack_queries);
+	writer.write_vector(data.pending_hits);
+	writer.write_vector(data.despawn_queue);
+	writer.write(data.view_matrix);
+}
+
+void Snapshot::restore(Game_data& data) const
+{
+	TE_PROFILE_ZONE("restore_snapshot");
+	assert(!empty());
+	Snapshot_reader reader{ m_bytes };
+	const auto& magic = reader.read<char[4]>();
+	const auto version = reader.read<std::uint32_t>();
+	assert(std::memcmp(magic, snapshot_magic, sizeof(snapshot_magic)) == 0 && version == snapshot_version);
+	(void)magic;
+	(void)version;
+
+	const auto next_id = reader.read<Entity_id>();
+	const auto entities = reader.read_array<std::pair<Entity_id, const Entity_xml*>>();
+	auto is_in_snapshot = [&entities](Entity_id entity_id) {
+		return std::binary_search(entities.first, entities.second, std::make_pair(entity_id, static_cast<const Entity_xml*>(nullptr)), [](const auto& lhs, const auto& rhs) {
+			return lhs.first < rhs.first;
+		});
+	};
+	// Written in entity order, a subset of `entities`.
+	const auto bodies = reader.read_array<Body_state>();
+
+	// The queue is overwritten below, so only entities made since the
+	// snapshot are despawned here. Their bodies are all parked for the
+	// respawned entities to take rather than destroyed and made again.
+	const auto pool_limit = data.physics_manager.get_pool_limit();
+	data.physics_manager.set_pool_limit(std::numeric_limits<size_t>::max());
+	data.despawn_queue.clear();
+	for (const auto& entity_pair : data.entity_xmls) {
+		if (!is_in_snapshot(entity_pair.first)) {
+			despawn(data, entity_pair.first);
+		}
+	}
+	despawn_entities(data);
+	for (auto it = entities.first; it != entities.second; ++it) {
+		if (data.entity_xmls.find(it->first) == data.entity_xmls.end()) {
+			respawn_entity(*it->second, data, it->first);
+		}
+	}
+	data.physics_manager.set_pool_limit(pool_limit);
+	data.entity_manager.restore_next_id(next_id);
+
+	reader.read_pairs(data.inputs);
+	reader.read_pairs(data.avatars);
+
+	reader.read_pairs(data.max_speeds);
+	reader.read_pairs(data.speeds);
+	reader.read_pairs(data.headings);
+	reader.read_pairs(data.positions);
+	reader.read_pairs(data.entity_team_masks);
+	reader.read_pairs(data.stats);
+	reader.read_pairs(data.entity_animations2);
+	reader.read_pairs(data.entity_meshes2);
+	reader.read_pairs(data.entity_meshes3);
+
+	data.normal_state_table.restore(reader);
+	data.light_attack_state_table.restore(reader);
+	reader.read_vector(data.attack_queries);
+	reader.read_vector(data.pending_hits);
+	reader.read_vector(data.despawn_queue);
+	data.view_matrix = reader.read<glm::mat4>();
+
+	for (auto it = bodies.first; it != bodies.second; ++it) {
+		auto found = data.physics_manager.find_rigid_body(it->entity_id);
+		assert(found != data.physics_manager.end());
+		restore_body(*found->second, *it);
+	}
+	data.physics_manager.rebuild_world();
+	assert(reader.at_end());
+}
+
+size_t Snapshot::size() const noexcept
+{
+	return m_bytes.size();
+}
+
+bool Snapshot::empty() const noexcept
+{
+	return m_bytes.empty();
+}
+
+} // namespace te
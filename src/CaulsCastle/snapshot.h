@@ -0,0 +1,46 @@
+#ifndef TE_SNAPSHOT_H
+#define TE_SNAPSHOT_H
+
+#include <vector>
+#include <cstddef>
+
+namespace te {
+
+struct Game_data;
+
+// Binary copy of the simulation state of a Game_data in one contiguous
+// buffer: every per-entity component, the state tables, animation timers,
+// the queues between steps and the state of entity rigid bodies.
+//
+// Restoring works in place. Entities made since the snapshot are
+// despawned and entities despawned since are made again from their
+// Entity_xml; everything else is overwritten, and GPU resources and
+// animation groups are kept. A snapshot is only valid for the Game_data it
+// came from while its entity table is loaded. The level streamer is not
+// part of it.
+//
+// Box2D's contact cache and sleep timers are private, so saving and
+// restoring both rebuild the physics world from the body states alone.
+// Stepping on from a save and from every restore of it then gives the
+// same results bit for bit. Contacts lose their warm-start impulses at a
+// save, which settles a touching pile slightly differently than if no
+// snapshot had been taken.
+class Snapshot {
+public:
+	Snapshot();
+
+	// Reuses the buffer, but rebuilding the physics world costs about as
+	// much as spawning every body again and empties the body pool, so
+	// saving every tick is not free.
+	void save(Game_data& data);
+	void restore(Game_data& data) const;
+
+	size_t size() const noexcept;
+	bool empty() const noexcept;
+private:
+	std::vector<char> m_bytes;
+};
+
+} // namespace te
+
+#endif
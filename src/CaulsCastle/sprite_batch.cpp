@@ -0,0 +1,131 @@
+#include "sprite_batch.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace te {
+
+Sprite_batch::Sprite_batch()
+	: m_submissions{}
+	, m_staging{}
+	, m_vertices{}
+	, m_buffer{}
+	, mp_bound_buffer{ nullptr }
+	, m_stats{ 0, 0 }
+{}
+
+void Sprite_batch::submit(const Vertex* p_vertices, size_t vertex_count, GLuint texture_id, GLenum mode, int draw_order, vec2 offset)
+{
+	m_submissions.push_back({
+		draw_order,
+		texture_id,
+		mode,
+		m_staging.size(),
+		vertex_count,
+		nullptr
+	});
+	for (size_t i = 0; i < vertex_count; ++i) {
+		auto vertex = p_vertices[i];
+		vertex.x += offset.x;
+		vertex.y += offset.y;
+		m_staging.push_back(vertex);
+	}
+}
+
+void Sprite_batch::submit_static(const Gl_buffer& buffer, size_t vertex_count, GLuint texture_id, GLenum mode, int draw_order)
+{
+	m_submissions.push_back({
+		draw_order,
+		texture_id,
+		mode,
+		0,
+		vertex_count,
+		&buffer
+	});
+}
+
+void Sprite_batch::flush()
+{
+	if (m_submissions.empty()) {
+		return;
+	}
+
+	std::stable_sort(m_submissions.begin(), m_submissions.end(), [](const Submission& a, const Submission& b) {
+		return a.draw_order != b.draw_order
+			? a.draw_order < b.draw_order
+			: a.texture_id < b.texture_id;
+	});
+
+	m_vertices.clear();
+	m_vertices.reserve(m_staging.size());
+	for (const auto& submission : m_submissions) {
+		if (!submission.p_static_buffer) {
+			auto first = m_staging.begin() + submission.first_vertex;
+			m_vertices.insert(m_vertices.end(), first, first + submission.vertex_count);
+		}
+	}
+
+	if (!m_vertices.empty()) {
+		m_buffer.bind(GL_ARRAY_BUFFER);
+		m_buffer.stream(GL_ARRAY_BUFFER, m_vertices.data(), m_vertices.size() * sizeof(Vertex));
+		mp_bound_buffer = &m_buffer;
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	size_t stream_first = 0;
+	for (auto it = m_submissions.begin(); it != m_submissions.end();) {
+		if (it->p_static_buffer) {
+			draw_arrays(*it->p_static_buffer, it->texture_id, it->mode, 0, it->vertex_count);
+			++it;
+			continue;
+		}
+
+		auto run_begin = it;
+		size_t run_count = 0;
+		for (; it != m_submissions.end()
+			       && !it->p_static_buffer
+			       && it->texture_id == run_begin->texture_id
+			       && it->mode == run_begin->mode; ++it) {
+			run_count += it->vertex_count;
+		}
+		draw_arrays(m_buffer, run_begin->texture_id, run_begin->mode, stream_first, run_count);
+		stream_first += run_count;
+	}
+
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	Gl_buffer::unbind(GL_ARRAY_BUFFER);
+	mp_bound_buffer = nullptr;
+
+	m_submissions.clear();
+	m_staging.clear();
+}
+
+void Sprite_batch::draw_arrays(const Gl_buffer& buffer, GLuint texture_id, GLenum mode, size_t first, size_t count)
+{
+	if (mp_bound_buffer != &buffer) {
+		buffer.bind(GL_ARRAY_BUFFER);
+		mp_bound_buffer = &buffer;
+	}
+	glVertexPointer(3, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, x)));
+	glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, u)));
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+	glDrawArrays(mode, static_cast<GLint>(first), static_cast<GLsizei>(count));
+	++m_stats.draw_calls;
+	m_stats.vertices += count;
+}
+
+void Sprite_batch::reset_stats()
+{
+	m_stats = { 0, 0 };
+}
+
+const Sprite_batch::Stats& Sprite_batch::get_stats() const
+{
+	return m_stats;
+}
+
+} // namespace te
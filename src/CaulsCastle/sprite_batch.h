@@ -0,0 +1,104 @@
+#ifndef TE_SPRITE_BATCH_H
+#define TE_SPRITE_BATCH_H
+
+#include "types.h"
+#include "mesh.h"
+#include "gl_buffer.h"
+
+#include <SDL_opengl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace te {
+
+namespace detail {
+
+inline glm::vec4 to_position4(vec2 position)
+{
+	return{ position.x, position.y, 0.f, 1.f };
+}
+inline glm::vec4 to_position4(vec3 position)
+{
+	return{ position.x, position.y, position.z, 1.f };
+}
+
+} // namespace detail
+
+// Collects meshes, transforms their vertices on the CPU and draws them from
+// one streamed vertex buffer with a single draw call per run of meshes that
+// share draw order, texture and primitive mode. Geometry that never moves can
+// be submitted as a prebuilt static buffer and is drawn in the same order.
+// Only uses GL 1.5 vertex buffers with the fixed-function pipeline.
+class Sprite_batch {
+public:
+	struct Stats {
+		size_t draw_calls;
+		size_t vertices;
+	};
+	struct Vertex {
+		GLfloat x, y, z;
+		GLfloat u, v;
+	};
+
+	Sprite_batch();
+
+	template <typename PositionVec, typename TexVec>
+	void submit(const Mesh<PositionVec, TexVec>& mesh, const glm::mat4& transform, int draw_order)
+	{
+		m_submissions.push_back({
+			draw_order,
+			mesh.texture_id,
+			mesh.mode,
+			m_staging.size(),
+			mesh.vertices.size(),
+			nullptr
+		});
+		for (const auto& vertex : mesh.vertices) {
+			const auto position = transform * detail::to_position4(vertex.position);
+			m_staging.push_back({
+				position.x,
+				position.y,
+				position.z,
+				static_cast<GLfloat>(vertex.tex_coords.x),
+				static_cast<GLfloat>(vertex.tex_coords.y)
+			});
+		}
+	}
+
+	// `p_vertices` are in world space once moved by `offset`.
+	void submit(const Vertex* p_vertices, size_t vertex_count, GLuint texture_id, GLenum mode, int draw_order, vec2 offset);
+
+	// `buffer` holds `vertex_count` Vertex values already in world space and
+	// must outlive the next flush.
+	void submit_static(const Gl_buffer& buffer, size_t vertex_count, GLuint texture_id, GLenum mode, int draw_order);
+
+	// Draws everything submitted since the last flush, ordered by
+	// (draw_order, texture) and otherwise in submission order.
+	void flush();
+
+	void reset_stats();
+	const Stats& get_stats() const;
+private:
+	struct Submission {
+		int draw_order;
+		GLuint texture_id;
+		GLenum mode;
+		size_t first_vertex;
+		size_t vertex_count;
+		const Gl_buffer* p_static_buffer;
+	};
+
+	void draw_arrays(const Gl_buffer& buffer, GLuint texture_id, GLenum mode, size_t first, size_t count);
+
+	std::vector<Submission> m_submissions;
+	std::vector<Vertex> m_staging;
+	std::vector<Vertex> m_vertices;
+	Gl_buffer m_buffer;
+	const Gl_buffer* mp_bound_buffer;
+	Stats m_stats;
+};
+
+} // namespace te
+
+#endif
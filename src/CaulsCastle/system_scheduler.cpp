@@ -0,0 +1,108 @@
+#include "system_scheduler.h"
+#include "profiler.h"
+
+#include <chrono>
+#include <cassert>
+
+namespace te {
+
+System_scheduler::System_scheduler(unsigned thread_count)
+	: m_steps{}
+	, m_remaining{}
+	, m_pool{ thread_count }
+	, m_serial{ thread_count == 0 }
+	, m_timing{ false }
+{}
+
+void System_scheduler::add(std::string name, Component_mask reads, Component_mask writes, Step_fn fn)
+{
+	const auto index = m_steps.size();
+	Step step{ std::move(name), reads, writes, std::move(fn), {}, 0, 0.0 };
+	for (size_t i = 0; i < index; ++i) {
+		auto& earlier = m_steps[i];
+		if ((step.writes & (earlier.reads | earlier.writes)) || (step.reads & earlier.writes)) {
+			earlier.dependents.push_back(index);
+			++step.dependency_count;
+		}
+	}
+	m_steps.push_back(std::move(step));
+	m_remaining.reset(new std::atomic<size_t>[m_steps.size()]);
+}
+
+void System_scheduler::run(Game_data& data, float dt)
+{
+	if (m_serial) {
+		for (auto& step : m_steps) {
+			call_step(step, data, dt);
+		}
+		return;
+	}
+
+	Thread_pool::Task_group group{};
+	for (size_t i = 0; i < m_steps.size(); ++i) {
+		m_remaining[i] = m_steps[i].dependency_count;
+	}
+	for (size_t i = 0; i < m_steps.size(); ++i) {
+		if (m_steps[i].dependency_count == 0) {
+			m_pool.submit(group, [this, i, &data, dt, &group] { run_step(i, data, dt, group); });
+		}
+	}
+	m_pool.wait(group);
+}
+
+void System_scheduler::set_serial(bool serial) noexcept
+{
+	m_serial = serial || m_pool.get_thread_count() == 0;
+}
+
+bool System_scheduler::is_serial() const noexcept
+{
+	return m_serial;
+}
+
+void System_scheduler::set_timing(bool timing) noexcept
+{
+	m_timing = timing;
+}
+
+size_t System_scheduler::get_step_count() const noexcept
+{
+	return m_steps.size();
+}
+
+const std::string& System_scheduler::get_step_name(size_t index) const
+{
+	return m_steps[index].name;
+}
+
+double System_scheduler::get_step_seconds(size_t index) const
+{
+	return m_steps[index].seconds;
+}
+
+void System_scheduler::call_step(Step& step, Game_data& data, float dt)
+{
+	TE_PROFILE_ZONE(step.name.c_str());
+	if (!m_timing) {
+		step.fn(data, dt);
+		return;
+	}
+	const auto start = std::chrono::high_resolution_clock::now();
+	step.fn(data, dt);
+	const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	step.seconds = elapsed.count();
+}
+
+void System_scheduler::run_step(size_t index, Game_data& data, float dt, Thread_pool::Task_group& group)
+{
+	auto& step = m_steps[index];
+	call_step(step, data, dt);
+	for (auto dependent : step.dependents) {
+		assert(m_remaining[dependent] > 0);
+		if (--m_remaining[dependent] == 0) {
+			m_pool.submit(group, [this, dependent, &data, dt, &group] { run_step(dependent, data, dt, group); });
+		}
+	}
+}
+
+} // namespace te
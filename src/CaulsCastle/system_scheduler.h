@@ -0,0 +1,95 @@
+#ifndef TE_SYSTEM_SCHEDULER_H
+#define TE_SYSTEM_SCHEDULER_H
+
+#include "thread_pool.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace te {
+
+struct Game_data;
+
+using Component_mask = unsigned;
+
+enum Component_flag : Component_mask {
+	Inputs_component = 1 << 0,
+	Avatars_component = 1 << 1,
+	Max_speeds_component = 1 << 2,
+	Speeds_component = 1 << 3,
+	Headings_component = 1 << 4,
+	Positions_component = 1 << 5,
+	Team_masks_component = 1 << 6,
+	Stats_component = 1 << 7,
+	Animation_groups_component = 1 << 8,
+	Animations_component = 1 << 9,
+	Meshes_component = 1 << 10,
+	State_tables_component = 1 << 11,
+	Physics_component = 1 << 12,
+	Attack_queries_component = 1 << 13,
+	Pending_hits_component = 1 << 14,
+	View_component = 1 << 15,
+	Resources_component = 1 << 16,
+	Despawns_component = 1 << 17,
+	All_components = ~Component_mask{ 0 }
+};
+
+// Runs a fixed list of steps, each declaring which Game_data components it
+// reads and writes. A step waits only for earlier steps it conflicts with,
+// so conflicting steps keep their program order and the result matches
+// running the list serially.
+class System_scheduler {
+public:
+	using Step_fn = std::function<void(Game_data&, float)>;
+
+	explicit System_scheduler(unsigned thread_count = Thread_pool::default_thread_count());
+
+	void add(std::string name, Component_mask reads, Component_mask writes, Step_fn fn);
+	void run(Game_data& data, float dt);
+
+	// Splits [0, count) across the pool; runs inline in serial mode.
+	template <typename Fn>
+	void parallel_for(size_t count, size_t chunk_size, const Fn& fn)
+	{
+		if (m_serial) {
+			if (count > 0) fn(size_t{ 0 }, count);
+		}
+		else {
+			m_pool.parallel_for(count, chunk_size, fn);
+		}
+	}
+
+	void set_serial(bool serial) noexcept;
+	bool is_serial() const noexcept;
+
+	// When timing is on, each step records how long its last run took.
+	void set_timing(bool timing) noexcept;
+	size_t get_step_count() const noexcept;
+	const std::string& get_step_name(size_t index) const;
+	double get_step_seconds(size_t index) const;
+private:
+	struct Step {
+		std::string name;
+		Component_mask reads;
+		Component_mask writes;
+		Step_fn fn;
+		std::vector<size_t> dependents;
+		size_t dependency_count;
+		double seconds;
+	};
+
+	void call_step(Step& step, Game_data& data, float dt);
+
+	void run_step(size_t index, Game_data& data, float dt, Thread_pool::Task_group& group);
+
+	std::vector<Step> m_steps;
+	std::unique_ptr<std::atomic<size_t>[]> m_remaining;
+	Thread_pool m_pool;
+	bool m_serial;
+	bool m_timing;
+};
+
+} // namespace te
+
+#endif
@@ -1,34 +1,87 @@
 #include "texture.h"
+#include "decode.h"
+#include "texture_loader.h"
 
 #include <vector>
 #include <iterator>
+#include <fstream>
+#include <cstring>
 
 namespace te {
 
+namespace {
+
+// Pads `width` x `height` RGBA pixels to powers of two the way
+// iluEnlargeCanvas with ILU_UPPER_LEFT does: the image keeps its top-left
+// corner and the rest is the clear colour set in main.
+std::vector<GLuint> pad_to_pow2(const void* p_rgba, int width, int height, bool lower_left_origin, int& tex_width, int& tex_height)
+{
+	tex_width = pow2up(width);
+	tex_height = pow2up(height);
+	const unsigned char clear_colour[4] = { 255, 255, 255, 0 };
+	GLuint clear_pixel;
+	std::memcpy(&clear_pixel, clear_colour, sizeof(clear_pixel));
+	std::vector<GLuint> pixels(tex_width * tex_height, clear_pixel);
+	const auto* p_rows = static_cast<const unsigned char*>(p_rgba);
+	const auto first_row = lower_left_origin ? tex_height - height : 0;
+	for (int y = 0; y < height; ++y) {
+		std::memcpy(pixels.data() + (first_row + y) * tex_width, p_rows + y * width * 4, width * 4);
+	}
+	return pixels;
+}
+
+} // namespace
+
 std::vector<GLuint> load_image32(const std::string& path,
 				 decltype(ilGetInteger(IL_IMAGE_WIDTH))& tex_width,
 				 decltype(ilGetInteger(IL_IMAGE_WIDTH))& tex_height)
 {
-	ILuint image_id{};
-	ilGenImages(1, &image_id);
-	ilBindImage(image_id);
+	int width{}, height{};
+	auto pixels = decode_image32(read_image_file(path), width, height);
+	tex_width = width;
+	tex_height = height;
+	return pixels;
+}
 
-	assert(ilLoadImage(path.c_str()) == IL_TRUE);
-	assert(ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE) == IL_TRUE);
+std::vector<char> read_image_file(const std::string& path)
+{
+	std::ifstream in{ path, std::ios::binary };
+	assert(in.is_open());
+	return{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} };
+}
 
-	auto image_width = ilGetInteger(IL_IMAGE_WIDTH);
-	auto image_height = ilGetInteger(IL_IMAGE_HEIGHT);
-	tex_width = pow2up(image_width);
-	tex_height = pow2up(image_height);
+bool decode_png32(const std::vector<char>& file_data, std::vector<GLuint>& pixels, int& tex_width, int& tex_height)
+{
+	std::vector<unsigned char> rgba;
+	int width, height;
+	if (!decode_png(reinterpret_cast<const unsigned char*>(file_data.data()), file_data.size(), rgba, width, height)) {
+		return false;
+	}
+	// Top row first, as DevIL loads PNGs.
+	pixels = pad_to_pow2(rgba.data(), width, height, false, tex_width, tex_height);
+	return true;
+}
 
-	if (image_width != tex_width || image_height != tex_height) {
-		iluImageParameter(ILU_PLACEMENT, ILU_UPPER_LEFT);
-		iluEnlargeCanvas(tex_width, tex_height, 1);
+std::vector<GLuint> decode_image32(const std::vector<char>& file_data, int& tex_width, int& tex_height)
+{
+	std::vector<GLuint> pixels;
+	if (decode_png32(file_data, pixels, tex_width, tex_height)) {
+		return pixels;
 	}
 
-	auto size = tex_width * tex_height;
-	std::vector<GLuint> pixels(size);
-	std::memcpy(pixels.data(), ilGetData(), size * 4);
+	ILuint image_id{};
+	ilGenImages(1, &image_id);
+	ilBindImage(image_id);
+	const auto loaded = ilLoadL(IL_TYPE_UNKNOWN, file_data.data(), static_cast<ILuint>(file_data.size()));
+	assert(loaded == IL_TRUE);
+	const auto converted = ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
+	assert(converted == IL_TRUE);
+	pixels = pad_to_pow2(ilGetData(),
+			     ilGetInteger(IL_IMAGE_WIDTH),
+			     ilGetInteger(IL_IMAGE_HEIGHT),
+			     ilGetInteger(IL_IMAGE_ORIGIN) == IL_ORIGIN_LOWER_LEFT,
+			     tex_width,
+			     tex_height);
 	ilDeleteImages(1, &image_id);
 	return pixels;
 }
@@ -37,6 +90,12 @@ GLuint load_texture32(GLuint* pixels, GLuint width, GLuint height)
 {
 	GLuint texture_id{};
 	glGenTextures(1, &texture_id);
+	upload_texture32(texture_id, pixels, width, height);
+	return texture_id;
+}
+
+void upload_texture32(GLuint texture_id, const GLuint* pixels, GLuint width, GLuint height)
+{
 	glBindTexture(GL_TEXTURE_2D, texture_id);
 
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
@@ -46,8 +105,6 @@ GLuint load_texture32(GLuint* pixels, GLuint width, GLuint height)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
 	glBindTexture(GL_TEXTURE_2D, NULL);
-
-	return texture_id;
 }
 
 GLuint load_texture32(const std::string& path)
@@ -57,8 +114,9 @@ GLuint load_texture32(const std::string& path)
 	return load_texture32(pixels.data(), width, height);
 }
 
-Texture::Texture(GLuint texture_id)
+Texture::Texture(GLuint texture_id, Texture_loader* p_loader)
 	: m_texture_id{ texture_id }
+	, mp_loader{ p_loader }
 {}
 
 Texture::~Texture()
@@ -68,6 +126,7 @@ Texture::~Texture()
 
 Texture::Texture(Texture&& rhs)
 	: m_texture_id{ rhs.m_texture_id }
+	, mp_loader{ rhs.mp_loader }
 {
 	rhs.m_texture_id = 0;
 }
@@ -76,6 +135,7 @@ Texture& Texture::operator=(Texture&& rhs)
 {
 	destroy_texture();
 	m_texture_id = rhs.m_texture_id;
+	mp_loader = rhs.mp_loader;
 	rhs.m_texture_id = 0;
 	return *this;
 }
@@ -87,7 +147,13 @@ GLuint Texture::get_texture_id() const
 
 void Texture::destroy_texture()
 {
-	if (m_texture_id > 0) glDeleteTextures(1, &m_texture_id);
+	if (m_texture_id == 0) {
+		return;
+	}
+	if (mp_loader) {
+		mp_loader->cancel(m_texture_id);
+	}
+	glDeleteTextures(1, &m_texture_id);
 }
 
 } // namespace te
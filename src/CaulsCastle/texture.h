@@ -17,12 +17,25 @@ std::vector<GLuint> load_image32(const std::string& path,
 				 decltype(ilGetInteger(IL_IMAGE_WIDTH))& tex_width,
 				 decltype(ilGetInteger(IL_IMAGE_WIDTH))& tex_height);
 
+std::vector<char> read_image_file(const std::string& path);
+// Decodes a PNG into the padded pixels load_image32 gives. It keeps no
+// global state, so it may run on any thread. Returns false for other
+// formats and for PNGs it does not read, e.g. interlaced ones.
+bool decode_png32(const std::vector<char>& file_data, std::vector<GLuint>& pixels, int& tex_width, int& tex_height);
+// decode_png32, falling back to DevIL for what it cannot read. DevIL keeps
+// global state, so call this only on the thread that initialised it.
+std::vector<GLuint> decode_image32(const std::vector<char>& file_data, int& tex_width, int& tex_height);
+
 GLuint load_texture32(GLuint* pixels, GLuint width, GLuint height);
+void upload_texture32(GLuint texture_id, const GLuint* pixels, GLuint width, GLuint height);
 GLuint load_texture32(const std::string& path);
 
+class Texture_loader;
+
 class Texture {
 public:
-	Texture(GLuint texture_id);
+	// A texture from `p_loader` cancels its pending upload when deleted.
+	Texture(GLuint texture_id, Texture_loader* p_loader = nullptr);
 	~Texture();
 	Texture(Texture&& rhs);
 	Texture& operator=(Texture&& rhs);
@@ -32,6 +45,7 @@ private:
 	void destroy_texture();
 
 	GLuint m_texture_id;
+	Texture_loader* mp_loader;
 };
 
 } // namespace te
@@ -0,0 +1,127 @@
+#include "texture_loader.h"
+#include "texture.h"
+#include "profiler.h"
+
+#include <chrono>
+#include <limits>
+
+namespace te {
+
+Texture_loader::Texture_loader(unsigned thread_count)
+	: m_pool{ thread_count }
+	, m_group{}
+	, m_ready_mutex{}
+	, m_ready{}
+	, m_pending_count{ 0 }
+	, m_requests{}
+	, m_next_request{ 1 }
+{}
+
+Texture_loader::~Texture_loader()
+{
+	m_pool.wait(m_group);
+}
+
+GLuint Texture_loader::load(const std::string& path)
+{
+	const GLuint placeholder = 0;
+	GLuint texture_id{};
+	glGenTextures(1, &texture_id);
+	upload_texture32(texture_id, &placeholder, 1, 1);
+	reload(texture_id, path);
+	return texture_id;
+}
+
+void Texture_loader::reload(GLuint texture_id, const std::string& path)
+{
+	const auto request = m_next_request++;
+	m_requests[texture_id] = request;
+	++m_pending_count;
+	m_pool.submit(m_group, [this, texture_id, request, path] {
+		TE_PROFILE_ZONE("decode_texture");
+		Decoded_image image{ texture_id, request, {}, 0, 0, read_image_file(path) };
+		if (decode_png32(image.file_data, image.pixels, image.width, image.height)) {
+			image.file_data = {};
+		}
+		std::lock_guard<std::mutex> lock{ m_ready_mutex };
+		m_ready.push_back(std::move(image));
+	});
+}
+
+void Texture_loader::cancel(GLuint texture_id)
+{
+	m_requests.erase(texture_id);
+}
+
+size_t Texture_loader::upload(double budget_seconds)
+{
+	TE_PROFILE_ZONE("upload_textures");
+	// Without workers the decodes only run while someone waits on them.
+	if (m_pool.get_thread_count() == 0) {
+		m_pool.wait(m_group);
+	}
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	size_t uploaded = 0;
+	while (true) {
+		Decoded_image image;
+		{
+			std::lock_guard<std::mutex> lock{ m_ready_mutex };
+			if (m_ready.empty()) {
+				break;
+			}
+			image = std::move(m_ready.front());
+			m_ready.pop_front();
+		}
+
+		--m_pending_count;
+		// The texture may have been deleted, or asked for again, while this
+		// was decoding.
+		auto request_found = m_requests.find(image.texture_id);
+		if (request_found != m_requests.end() && request_found->second == image.request) {
+			m_requests.erase(request_found);
+			if (!image.file_data.empty()) {
+				TE_PROFILE_ZONE("decode_texture_devil");
+				image.pixels = decode_image32(image.file_data, image.width, image.height);
+			}
+			upload_texture32(image.texture_id, image.pixels.data(), image.width, image.height);
+			++uploaded;
+		}
+
+		const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		if (elapsed.count() >= budget_seconds) {
+			break;
+		}
+	}
+	return uploaded;
+}
+
+void Texture_loader::finish()
+{
+	m_pool.wait(m_group);
+	upload(std::numeric_limits<double>::infinity());
+}
+
+size_t Texture_loader::get_pending_count() const noexcept
+{
+	return m_pending_count;
+}
+
+GLuint load_texture(Texture_loader* p_loader, const std::string& path)
+{
+	return p_loader ? p_loader->load(path) : load_texture32(path);
+}
+
+void reload_texture(Texture_loader* p_loader, GLuint texture_id, const std::string& path)
+{
+	if (p_loader) {
+		p_loader->reload(texture_id, path);
+		return;
+	}
+	int width = 0;
+	int height = 0;
+	const auto pixels = decode_image32(read_image_file(path), width, height);
+	upload_texture32(texture_id, pixels.data(), width, height);
+}
+
+} // namespace te
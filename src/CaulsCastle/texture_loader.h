@@ -0,0 +1,73 @@
+#ifndef TE_TEXTURE_LOADER_H
+#define TE_TEXTURE_LOADER_H
+
+#include "thread_pool.h"
+#include "types.h"
+
+#include <SDL_opengl.h>
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace te {
+
+// Decodes images on a thread pool and uploads them from the main thread.
+// load() returns the GL texture name right away; it holds a transparent
+// 1x1 placeholder until upload() fills it with the decoded image, so
+// meshes and tile chunks can be built before their pixels arrive. Workers
+// decode PNGs with decode_png32; anything else is left to DevIL, which
+// upload() runs on the main thread.
+class Texture_loader {
+public:
+	explicit Texture_loader(unsigned thread_count = Thread_pool::default_thread_count());
+	~Texture_loader();
+	Texture_loader(const Texture_loader&) = delete;
+	Texture_loader& operator=(const Texture_loader&) = delete;
+
+	GLuint load(const std::string& path);
+	// Decodes `path` again into an existing texture, which keeps showing
+	// its old pixels until upload() replaces them. Only the latest request
+	// for a texture is uploaded.
+	void reload(GLuint texture_id, const std::string& path);
+	// Drops the pending request for a texture about to be deleted, so a
+	// texture that GL later gives the same name does not receive it.
+	void cancel(GLuint texture_id);
+
+	// Uploads decoded images until `budget_seconds` is spent, always at
+	// least one if any is ready. Returns how many were uploaded.
+	size_t upload(double budget_seconds);
+
+	// Blocks until every loaded image has been decoded and uploaded.
+	void finish();
+
+	size_t get_pending_count() const noexcept;
+private:
+	struct Decoded_image {
+		GLuint texture_id;
+		size_t request;
+		std::vector<GLuint> pixels;
+		int width;
+		int height;
+		// Kept only when a worker could not decode it.
+		std::vector<char> file_data;
+	};
+
+	Thread_pool m_pool;
+	Thread_pool::Task_group m_group;
+	std::mutex m_ready_mutex;
+	std::deque<Decoded_image> m_ready;
+	size_t m_pending_count;
+	// Latest request per texture; touched only on the main thread.
+	flat_map<GLuint, size_t> m_requests;
+	size_t m_next_request;
+};
+
+// Loads through `p_loader` when there is one, otherwise synchronously.
+GLuint load_texture(Texture_loader* p_loader, const std::string& path);
+void reload_texture(Texture_loader* p_loader, GLuint texture_id, const std::string& path);
+
+} // namespace te
+
+#endif
@@ -0,0 +1,119 @@
+#include "thread_pool.h"
+
+#include <cassert>
+
+namespace te {
+
+Thread_pool::Thread_pool(unsigned thread_count)
+	: m_queues{}
+	, m_threads{}
+	, m_queued_count{ 0 }
+	, m_next_queue{ 0 }
+	, m_done{ false }
+	, m_wake_mutex{}
+	, m_wake{}
+{
+	// Queue 0 belongs to threads outside the pool that submit and wait.
+	for (unsigned i = 0; i <= thread_count; ++i) {
+		m_queues.push_back(std::make_unique<Queue>());
+	}
+	for (unsigned i = 1; i <= thread_count; ++i) {
+		m_threads.emplace_back([this, i] { run_worker(i); });
+	}
+}
+
+Thread_pool::~Thread_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_wake_mutex };
+		m_done = true;
+	}
+	m_wake.notify_all();
+	for (auto& thread : m_threads) {
+		thread.join();
+	}
+}
+
+void Thread_pool::submit(Task_group& group, std::function<void()> task)
+{
+	++group.m_pending;
+	auto& queue = *m_queues[m_next_queue++ % m_queues.size()];
+	{
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+		queue.tasks.push_back({ std::move(task), &group });
+	}
+	{
+		std::lock_guard<std::mutex> lock{ m_wake_mutex };
+		++m_queued_count;
+	}
+	m_wake.notify_one();
+}
+
+void Thread_pool::wait(Task_group& group)
+{
+	while (group.m_pending > 0) {
+		if (!try_run_task(0)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+size_t Thread_pool::get_thread_count() const noexcept
+{
+	return m_threads.size();
+}
+
+unsigned Thread_pool::default_thread_count()
+{
+	const auto hardware_threads = std::thread::hardware_concurrency();
+	return hardware_threads > 1 ? hardware_threads - 1 : 0;
+}
+
+bool Thread_pool::try_run_task(size_t queue_index)
+{
+	Task task{};
+	bool found = false;
+	{
+		auto& own = *m_queues[queue_index];
+		std::lock_guard<std::mutex> lock{ own.mutex };
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			found = true;
+		}
+	}
+	for (size_t i = 1; !found && i < m_queues.size(); ++i) {
+		auto& victim = *m_queues[(queue_index + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock{ victim.mutex };
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			found = true;
+		}
+	}
+	if (!found) {
+		return false;
+	}
+
+	--m_queued_count;
+	task.fn();
+	assert(task.p_group->m_pending > 0);
+	--task.p_group->m_pending;
+	return true;
+}
+
+void Thread_pool::run_worker(size_t queue_index)
+{
+	while (true) {
+		if (try_run_task(queue_index)) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock{ m_wake_mutex };
+		m_wake.wait(lock, [this] { return m_done || m_queued_count > 0; });
+		if (m_done) {
+			return;
+		}
+	}
+}
+
+} // namespace te
@@ -0,0 +1,83 @@
+#ifndef TE_THREAD_POOL_H
+#define TE_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace te {
+
+// Work-stealing pool: every worker pops from the back of its own queue and
+// steals from the front of the others when it runs dry. Threads waiting on
+// a task group run queued tasks instead of blocking, so tasks may submit
+// and wait on further tasks.
+class Thread_pool {
+public:
+	class Task_group {
+	public:
+		Task_group() : m_pending{ 0 } {}
+	private:
+		friend class Thread_pool;
+		std::atomic<size_t> m_pending;
+	};
+
+	explicit Thread_pool(unsigned thread_count = default_thread_count());
+	~Thread_pool();
+	Thread_pool(const Thread_pool&) = delete;
+	Thread_pool& operator=(const Thread_pool&) = delete;
+
+	void submit(Task_group& group, std::function<void()> task);
+	void wait(Task_group& group);
+
+	// Calls fn(first, last) over [0, count) in chunks of at most
+	// `chunk_size` and returns once every chunk has run.
+	template <typename Fn>
+	void parallel_for(size_t count, size_t chunk_size, const Fn& fn)
+	{
+		if (count <= chunk_size || m_threads.empty()) {
+			if (count > 0) fn(size_t{ 0 }, count);
+			return;
+		}
+		Task_group group{};
+		for (size_t first = chunk_size; first < count; first += chunk_size) {
+			const auto last = std::min(first + chunk_size, count);
+			submit(group, [&fn, first, last] { fn(first, last); });
+		}
+		fn(size_t{ 0 }, chunk_size);
+		wait(group);
+	}
+
+	size_t get_thread_count() const noexcept;
+
+	static unsigned default_thread_count();
+private:
+	struct Task {
+		std::function<void()> fn;
+		Task_group* p_group;
+	};
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	bool try_run_task(size_t queue_index);
+	void run_worker(size_t queue_index);
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::thread> m_threads;
+	std::atomic<size_t> m_queued_count;
+	std::atomic<size_t> m_next_queue;
+	std::atomic<bool> m_done;
+	std::mutex m_wake_mutex;
+	std::condition_variable m_wake;
+};
+
+} // namespace te
+
+#endif
@@ -0,0 +1,104 @@
+#include "tile_chunks.h"
+#include "sprite_batch.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <cassert>
+
+namespace te {
+
+std::vector<Tile_chunk_vertices> make_tile_chunk_vertices(const Vertex_array<vec2, vec2>& quads,
+							  GLuint texture_id,
+							  int draw_order,
+							  vec2 chunk_size,
+							  vec2 pixel_to_world_scale)
+{
+	assert(quads.size() % 4 == 0);
+
+	std::map<std::pair<int, int>, std::vector<Sprite_batch::Vertex>> chunk_vertices;
+	for (size_t i = 0; i < quads.size(); i += 4) {
+		const auto origin = quads[i].position;
+		auto& vertices = chunk_vertices[{
+			static_cast<int>(origin.y / chunk_size.y),
+			static_cast<int>(origin.x / chunk_size.x)
+		}];
+		for (size_t j = i; j < i + 4; ++j) {
+			const auto position = quads[j].position / pixel_to_world_scale;
+			vertices.push_back({
+				position.x,
+				position.y,
+				0.f,
+				quads[j].tex_coords.x,
+				quads[j].tex_coords.y
+			});
+		}
+	}
+
+	std::vector<Tile_chunk_vertices> chunks;
+	chunks.reserve(chunk_vertices.size());
+	for (auto& chunk_pair : chunk_vertices) {
+		auto& vertices = chunk_pair.second;
+		vec2 min{ vertices[0].x, vertices[0].y };
+		vec2 max{ min };
+		for (const auto& vertex : vertices) {
+			min = glm::min(min, vec2{ vertex.x, vertex.y });
+			max = glm::max(max, vec2{ vertex.x, vertex.y });
+		}
+		chunks.push_back({
+			std::move(vertices),
+			texture_id,
+			draw_order,
+			min,
+			max
+		});
+	}
+	return chunks;
+}
+
+Tile_chunk upload_tile_chunk(const Tile_chunk_vertices& chunk)
+{
+	Gl_buffer buffer{};
+	buffer.bind(GL_ARRAY_BUFFER);
+	buffer.upload(GL_ARRAY_BUFFER, chunk.vertices.data(), chunk.vertices.size() * sizeof(Sprite_batch::Vertex), GL_STATIC_DRAW);
+	Gl_buffer::unbind(GL_ARRAY_BUFFER);
+	return{
+		std::move(buffer),
+		chunk.vertices.size(),
+		chunk.texture_id,
+		chunk.draw_order,
+		chunk.min,
+		chunk.max
+	};
+}
+
+std::vector<Tile_chunk> make_tile_chunks(const Vertex_array<vec2, vec2>& quads,
+					 GLuint texture_id,
+					 int draw_order,
+					 vec2 chunk_size,
+					 vec2 pixel_to_world_scale)
+{
+	std::vector<Tile_chunk> chunks;
+	for (const auto& chunk : make_tile_chunk_vertices(quads, texture_id, draw_order, chunk_size, pixel_to_world_scale)) {
+		chunks.push_back(upload_tile_chunk(chunk));
+	}
+	return chunks;
+}
+
+size_t submit_visible_tile_chunks(const std::vector<Tile_chunk>& chunks,
+				  vec2 view_min,
+				  vec2 view_max,
+				  Sprite_batch& sprite_batch)
+{
+	size_t visible = 0;
+	for (const auto& chunk : chunks) {
+		if (chunk.max.x >= view_min.x && chunk.min.x <= view_max.x
+		    && chunk.max.y >= view_min.y && chunk.min.y <= view_max.y) {
+			sprite_batch.submit_static(chunk.buffer, chunk.vertex_count, chunk.texture_id, GL_QUADS, chunk.draw_order);
+			++visible;
+		}
+	}
+	return visible;
+}
+
+} // namespace te
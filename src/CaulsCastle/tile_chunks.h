@@ -0,0 +1,66 @@
+#ifndef TE_TILE_CHUNKS_H
+#define TE_TILE_CHUNKS_H
+
+#include "types.h"
+#include "gl_buffer.h"
+#include "sprite_batch.h"
+
+#include <SDL_opengl.h>
+
+#include <vector>
+
+namespace te {
+
+// A square block of one layer's tiles for a single tileset, uploaded once
+// into a static buffer in world space.
+struct Tile_chunk {
+	Gl_buffer buffer;
+	size_t vertex_count;
+	GLuint texture_id;
+	int draw_order;
+	vec2 min;
+	vec2 max;
+};
+
+// The world-space vertices of a chunk before upload, so they can be built
+// away from the GL thread.
+struct Tile_chunk_vertices {
+	std::vector<Sprite_batch::Vertex> vertices;
+	GLuint texture_id;
+	int draw_order;
+	vec2 min;
+	vec2 max;
+};
+
+struct Tile_chunk_stats {
+	size_t visible;
+	size_t total;
+};
+
+// Splits the quads of a layer, as produced by get_tile_map_layer_vertices,
+// into chunks of `chunk_size` pixels.
+std::vector<Tile_chunk_vertices> make_tile_chunk_vertices(const Vertex_array<vec2, vec2>& quads,
+							  GLuint texture_id,
+							  int draw_order,
+							  vec2 chunk_size,
+							  vec2 pixel_to_world_scale);
+
+Tile_chunk upload_tile_chunk(const Tile_chunk_vertices& chunk);
+
+// make_tile_chunk_vertices followed by upload_tile_chunk for each chunk.
+std::vector<Tile_chunk> make_tile_chunks(const Vertex_array<vec2, vec2>& quads,
+					 GLuint texture_id,
+					 int draw_order,
+					 vec2 chunk_size,
+					 vec2 pixel_to_world_scale);
+
+// Submits the chunks overlapping the world-space rectangle [view_min,
+// view_max] and returns how many were submitted.
+size_t submit_visible_tile_chunks(const std::vector<Tile_chunk>& chunks,
+				  vec2 view_min,
+				  vec2 view_max,
+				  Sprite_batch& sprite_batch);
+
+} // namespace te
+
+#endif
@@ -12,8 +12,12 @@
 
 namespace te {
 
+// Emits the quads of the tiles in columns [x_begin, x_end) and rows
+// [y_begin, y_end) of a layer that belong to the given tileset.
 template <template <typename Container_type> typename Iter, typename Container_type, typename Denom_fn = detail::Pow2up_fn>
-void get_tile_map_layer_vertices(const Tmx& tmx, size_t layer_index, size_t tileset_index, Iter<Container_type> out, int z_step = 500, const Denom_fn& denom_fn = Denom_fn())
+void get_tile_map_region_vertices(const Tmx& tmx, size_t layer_index, size_t tileset_index,
+				  int x_begin, int y_begin, int x_end, int y_end,
+				  Iter<Container_type> out, int z_step = 500, const Denom_fn& denom_fn = Denom_fn())
 {
 	assert(layer_index >= 0 && layer_index < tmx.layers.size());
 	assert(tileset_index >= 0 && tileset_index < tmx.tilesets.size());
@@ -25,10 +29,16 @@ void get_tile_map_layer_vertices(const Tmx& tmx, size_t layer_index, size_t tile
 	auto image_width = denom_fn(tileset.image.width);
 	auto image_height = denom_fn(tileset.image.height);
 
-	size_t tile_index = 0;
+	assert(x_begin >= 0 && x_end <= tmx.width && y_begin >= 0 && y_end <= tmx.height);
+
 	const auto& layer = tmx.layers[layer_index];
-	for (auto tile : layer.data)
+	const int region_width = x_end - x_begin;
+	const int tile_count = region_width * (y_end - y_begin);
+	for (int i = 0; i < tile_count; ++i)
 	{
+		int x = x_begin + i % region_width;
+		int y = y_begin + i / region_width;
+		const auto tile = *(layer.data.begin() + tmx.index(x, y));
 		if (tile.gid != 0 && tmx.getTilesetIndex(tile.gid) == tileset_index)
 		{
 			std::array<Container_type::value_type, 4> quad;
@@ -48,9 +58,6 @@ void get_tile_map_layer_vertices(const Tmx& tmx, size_t layer_index, size_t tile
 			quad[3].tex_coords = { (coord_t)(tileset.tilewidth * tu) / image_width,
 					       (coord_t)(tileset.tileheight * (tv + 1)) / image_height };
 
-			int x = tile_index % tmx.width;
-			int y = tile_index / tmx.width;
-
 			quad[0].position = detail::make_position<vec_t, coord_t>((coord_t)(tileWidth * x),
 										 (coord_t)(tileHeight * y),
 										 (coord_t)layer_index * z_step);
@@ -66,10 +73,15 @@ void get_tile_map_layer_vertices(const Tmx& tmx, size_t layer_index, size_t tile
 
 			for (auto& v : quad) (out++) = v;
 		}
-		++tile_index;
 	}
 }
 
+template <template <typename Container_type> typename Iter, typename Container_type, typename Denom_fn = detail::Pow2up_fn>
+void get_tile_map_layer_vertices(const Tmx& tmx, size_t layer_index, size_t tileset_index, Iter<Container_type> out, int z_step = 500, const Denom_fn& denom_fn = Denom_fn())
+{
+	get_tile_map_region_vertices(tmx, layer_index, tileset_index, 0, 0, tmx.width, tmx.height, out, z_step, denom_fn);
+}
+
 namespace detail {
 
 template <typename Vec, typename Coord>
@@ -1,4 +1,6 @@
 #include "tmx.h"
+#include "decode.h"
+#include "profiler.h"
 
 #include <rapidxml.hpp>
 #include <rapidxml_utils.hpp>
@@ -6,11 +8,136 @@
 #include <algorithm>
 #include <array>
 #include <set>
+#include <stdexcept>
 #include <cmath>
-#include <sstream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
 
 namespace te {
 
+namespace {
+
+inline bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// Tiled keeps the horizontal, vertical and diagonal flip flags in the top
+// three bits of a gid. Tiles are not drawn flipped, so they are dropped.
+const std::uint32_t gid_flip_flags = 0xE0000000u;
+
+inline Tmx::Tile make_tile(std::uint32_t gid)
+{
+	return{ static_cast<int>(gid & ~gid_flip_flags) };
+}
+
+// Gids are unsigned 32-bit, flags included, so they are scanned as unsigned.
+inline std::uint32_t scan_uint(const char*& p)
+{
+	std::uint32_t value = 0;
+	while (is_digit(*p)) {
+		value = value * 10 + static_cast<std::uint32_t>(*p++ - '0');
+	}
+	return value;
+}
+
+inline std::uint32_t scan_gid(const char* p)
+{
+	return scan_uint(p);
+}
+
+void read_csv_tiles(const char* p, std::vector<Tmx::Tile>& tiles)
+{
+	while (*p != '\0') {
+		if (is_digit(*p)) {
+			tiles.push_back(make_tile(scan_uint(p)));
+		}
+		else {
+			++p;
+		}
+	}
+}
+
+void read_base64_tiles(const char* p, const char* compression, std::vector<Tmx::Tile>& tiles)
+{
+	std::vector<unsigned char> bytes;
+	if (!decode_base64(p, p + std::strlen(p), bytes)) {
+		throw std::runtime_error{ "Layer data is not valid base64" };
+	}
+
+	if (compression != nullptr) {
+		if (std::strcmp(compression, "zlib") != 0) {
+			throw std::runtime_error{ std::string{ "Unsupported layer compression: " } + compression };
+		}
+		std::vector<unsigned char> inflated;
+		inflated.reserve(tiles.capacity() * 4);
+		if (!inflate_zlib(bytes.data(), bytes.size(), inflated)) {
+			throw std::runtime_error{ "Layer data is not valid zlib" };
+		}
+		bytes = std::move(inflated);
+	}
+
+	if (bytes.size() % 4 != 0) {
+		throw std::runtime_error{ "Layer data is not a whole number of gids" };
+	}
+	for (size_t i = 0; i + 4 <= bytes.size(); i += 4) {
+		const std::uint32_t gid = bytes[i]
+			| (std::uint32_t{ bytes[i + 1] } << 8)
+			| (std::uint32_t{ bytes[i + 2] } << 16)
+			| (std::uint32_t{ bytes[i + 3] } << 24);
+		tiles.push_back(make_tile(gid));
+	}
+}
+
+// Reads the <data> of a layer in any of the encodings Tiled writes: one
+// <tile> node per tile, csv, or base64 with optional zlib compression.
+// Throws std::runtime_error for data it cannot read.
+void read_layer_tiles(rapidxml::xml_node<char>& data, std::vector<Tmx::Tile>& tiles)
+{
+	auto* p_encoding = data.first_attribute("encoding");
+	if (p_encoding == nullptr) {
+		for (auto* p_tile = data.first_node("tile"); p_tile != nullptr; p_tile = p_tile->next_sibling("tile")) {
+			auto* p_gid = p_tile->first_attribute("gid");
+			tiles.push_back(make_tile(p_gid ? scan_gid(p_gid->value()) : 0));
+		}
+	}
+	else if (std::strcmp(p_encoding->value(), "csv") == 0) {
+		read_csv_tiles(data.value(), tiles);
+	}
+	else if (std::strcmp(p_encoding->value(), "base64") == 0) {
+		auto* p_compression = data.first_attribute("compression");
+		read_base64_tiles(data.value(), p_compression ? p_compression->value() : nullptr, tiles);
+	}
+	else {
+		throw std::runtime_error{ std::string{ "Unsupported layer encoding: " } + p_encoding->value() };
+	}
+}
+
+// Parses "x0,y0 x1,y1 ..." without building intermediate strings.
+std::vector<vec2> read_points(const char* p)
+{
+	std::vector<vec2> points;
+	while (true) {
+		char* p_end;
+		const float x = std::strtof(p, &p_end);
+		if (p_end == p || *p_end != ',') {
+			break;
+		}
+		p = p_end + 1;
+		const float y = std::strtof(p, &p_end);
+		if (p_end == p) {
+			break;
+		}
+		p = p_end;
+		points.push_back({ x, y });
+	}
+	return points;
+}
+
+} // namespace
+
 const int Tmx::NULL_TILE = -1;
 const Tmx::TileData Tmx::NULL_DATA = Tmx::TileData{ NULL_TILE, Tmx::ObjectGroup() };
 
@@ -22,6 +149,7 @@ Tmx::Tmx(const std::string& filename)
 
 bool Tmx::loadFromFile(const std::string& f)
 {
+	TE_PROFILE_ZONE("parse_tmx");
 	rapidxml::file<> tmxFile(f.c_str());
 	rapidxml::xml_document<> tmx;
 	tmx.parse<0>(tmxFile.data());
@@ -67,22 +195,7 @@ bool Tmx::loadFromFile(const std::string& f)
 					std::vector<Polygon> polygons;
 					for (rapidxml::xml_node<char>* pPolygon = pObject->first_node("polygon"); pPolygon != 0; pPolygon = pPolygon->next_sibling("polygon"))
 					{
-						decltype(polygons[0].points) pointsVec{};
-
-						std::string pointsStr(pPolygon->first_attribute("points")->value());
-						std::istringstream iss(pointsStr);
-						std::vector<std::string> points{ std::istream_iterator<std::string>{iss}, std::istream_iterator<std::string>{} };
-						for (auto& point : points)
-						{
-							std::stringstream ss(point);
-							std::string xCoord;
-							std::getline(ss, xCoord, ',');
-							std::string yCoord;
-							std::getline(ss, yCoord);
-							pointsVec.push_back({ std::stof(xCoord), std::stof(yCoord) });
-						}
-
-						polygons.push_back({ std::move(pointsVec) });
+						polygons.push_back({ read_points(pPolygon->first_attribute("points")->value()) });
 					}
 
 					objects.push_back(Object{
@@ -150,17 +263,33 @@ bool Tmx::loadFromFile(const std::string& f)
 	auto layerIndexIter = tileLayerIndices.begin();
 	for (rapidxml::xml_node<char>* pLayer = tmx.first_node("map")->first_node("layer"); pLayer != 0; pLayer = pLayer->next_sibling("layer"))
 	{
+		const int layerWidth = std::stoi(pLayer->first_attribute("width")->value());
+		const int layerHeight = std::stoi(pLayer->first_attribute("height")->value());
+		const std::string layerName = pLayer->first_attribute("name")->value();
+		// Tiles are looked up with index(), which assumes the map's size.
+		if (layerWidth != width || layerHeight != height) {
+			throw std::runtime_error{ f + ": layer " + layerName + " is not the size of the map" };
+		}
+		auto* pData = pLayer->first_node("data");
+		if (pData == nullptr) {
+			throw std::runtime_error{ f + ": layer " + layerName + " has no data" };
+		}
 		std::vector<Tile> tiles;
-		for (rapidxml::xml_node<char>* pTile = pLayer->first_node("data")->first_node("tile"); pTile != 0; pTile = pTile->next_sibling("tile"))
-		{
-			tiles.push_back({
-				std::stoi(pTile->first_attribute("gid")->value())
-			});
+		tiles.reserve(layerWidth * layerHeight);
+		try {
+			read_layer_tiles(*pData, tiles);
+		}
+		catch (const std::runtime_error& e) {
+			throw std::runtime_error{ f + ": layer " + layerName + ": " + e.what() };
+		}
+		if (tiles.size() != static_cast<size_t>(layerWidth) * layerHeight) {
+			throw std::runtime_error{ f + ": layer " + layerName + " has " + std::to_string(tiles.size())
+						  + " tiles, not " + std::to_string(layerWidth * layerHeight) };
 		}
 		layers.push_back({
-			pLayer->first_attribute("name")->value(),
-			std::stoi(pLayer->first_attribute("width")->value()),
-			std::stoi(pLayer->first_attribute("height")->value()),
+			layerName,
+			layerWidth,
+			layerHeight,
 			{std::move(tiles)},
 			*layerIndexIter++
 		});
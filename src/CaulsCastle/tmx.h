@@ -80,6 +80,8 @@ struct Tmx
 	};
 
 	Tmx() = default;
+	// Throws std::runtime_error for layer data it cannot read or whose tile
+	// count does not fill the map.
 	Tmx(const std::string& filename);
 	bool loadFromFile(const std::string& filename);
 
@@ -5,12 +5,24 @@ namespace te {
 
 class Tri_bool {
 public:
+	static constexpr unsigned state_count = 3;
+
 	constexpr Tri_bool() noexcept
 		: m_state(State::Null)
 	{}
 	constexpr Tri_bool(bool state) noexcept
 		: m_state{ state ? State::True : State::False }
 	{}
+
+	// Dense index in [0, state_count), for tables keyed on Tri_bool.
+	constexpr unsigned index() const noexcept
+	{
+		return static_cast<unsigned>(m_state);
+	}
+	static constexpr Tri_bool from_index(unsigned index) noexcept
+	{
+		return Tri_bool{ static_cast<State>(index) };
+	}
 private:
 	enum class State {
 		True,
@@ -19,6 +31,10 @@ private:
 	};
 	const State m_state;
 
+	constexpr Tri_bool(State state) noexcept
+		: m_state{ state }
+	{}
+
 	constexpr operator bool() const noexcept
 	{
 		return m_state == State::True;
@@ -1,6 +1,8 @@
 #ifndef TE_TYPES_H
 #define TE_TYPES_H
 
+#include "multi_component.h"
+
 #include <SDL.h>
 #include <boost/container/flat_map.hpp>
 #include <glm/glm.hpp>
@@ -27,9 +29,6 @@ using component = boost::container::flat_map<K, V>;
 template <typename K, typename V>
 using flat_map = boost::container::flat_map<K, V>;
 
-template <typename K, typename V>
-using Multi_component = std::vector<std::pair<K, V>>;
-
 template <typename PositionVec, typename TexVec>
 using Vertex_array = std::vector<vertex<PositionVec, TexVec>>;
 
@@ -17,6 +17,19 @@ inline int pow2up(int x)
 	return ++x;
 }
 
+// Erases the entries of a sorted map whose keys are in the sorted range
+// [first, last), compacting the map once instead of once per key.
+template <typename Map, typename Iter>
+void erase_keys(Map& map, Iter first, Iter last)
+{
+	if (first == last) {
+		return;
+	}
+	map.erase(std::remove_if(map.begin(), map.end(), [first, last](const typename Map::value_type& pair) {
+		return std::binary_search(first, last, pair.first);
+	}), map.end());
+}
+
 inline std::string get_directory(const std::string& filename, const std::string& delimiter = "/")
 {
 	auto result = std::find_end(filename.begin(), filename.end(), delimiter.begin(), delimiter.end());
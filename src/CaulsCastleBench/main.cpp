@@ -0,0 +1,790 @@
+#include "game.h"
+#include "game_data.h"
+#include "level.h"
+#include "loaders.h"
+#include "entity.h"
+#include "system_scheduler.h"
+#include "asset_pack.h"
+#include "tmx.h"
+#include "level_streamer.h"
+#include "physics_manager.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "render_frame.h"
+
+#include <Box2D/Box2D.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Live and peak heap bytes and the allocation count, kept by the replaced
+// operator new/delete below so benchmarks can report memory on any platform.
+std::atomic<size_t> heap_bytes{ 0 };
+std::atomic<size_t> heap_peak_bytes{ 0 };
+std::atomic<size_t> heap_allocation_count{ 0 };
+const size_t heap_header_size = 16;
+
+} // namespace
+
+void* operator new(size_t size)
+{
+	auto* p = static_cast<char*>(std::malloc(size + heap_header_size));
+	if (p == nullptr) {
+		throw std::bad_alloc{};
+	}
+	*reinterpret_cast<size_t*>(p) = size;
+	++heap_allocation_count;
+	const auto bytes = heap_bytes += size;
+	auto peak = heap_peak_bytes.load();
+	while (bytes > peak && !heap_peak_bytes.compare_exchange_weak(peak, bytes)) {}
+	return p + heap_header_size;
+}
+
+void operator delete(void* p) noexcept
+{
+	if (p == nullptr) {
+		return;
+	}
+	auto* p_block = static_cast<char*>(p) - heap_header_size;
+	heap_bytes -= *reinterpret_cast<size_t*>(p_block);
+	std::free(p_block);
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete[](void* p) noexcept
+{
+	operator delete(p);
+}
+
+namespace {
+
+struct Options {
+	size_t entity_count = 1000;
+	size_t tick_count = 600;
+	std::string level = "assets/maps/arena.tmx";
+	bool serial = false;
+	bool stream = false;
+	size_t churn = 0;
+	size_t hitbox_count = 0;
+	size_t snapshot_ticks = 0;
+	size_t spawn_wave = 0;
+	bool animation_sweep = false;
+	std::string trace_file;
+	std::vector<std::string> tmx_files;
+	size_t tmx_repeat = 20;
+	// The positions checksum the run must end on, e.g. from a reference
+	// machine; any other checksum fails the run.
+	bool check_checksum = false;
+	std::uint64_t expected_checksum = 0;
+};
+
+Options parse_options(int argc, char** argv)
+{
+	Options options{};
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg{ argv[i] };
+		if (arg == "--serial") {
+			options.serial = true;
+		}
+		else if (arg == "--stream") {
+			options.stream = true;
+		}
+		else if (arg == "--entities" && i + 1 < argc) {
+			options.entity_count = std::stoul(argv[++i]);
+		}
+		else if (arg == "--ticks" && i + 1 < argc) {
+			options.tick_count = std::stoul(argv[++i]);
+		}
+		else if (arg == "--churn" && i + 1 < argc) {
+			options.churn = std::stoul(argv[++i]);
+		}
+		else if (arg == "--hitboxes" && i + 1 < argc) {
+			options.hitbox_count = std::stoul(argv[++i]);
+		}
+		else if (arg == "--spawn" && i + 1 < argc) {
+			options.spawn_wave = std::stoul(argv[++i]);
+		}
+		else if (arg == "--animation-sweep") {
+			options.animation_sweep = true;
+		}
+		else if (arg == "--snapshot" && i + 1 < argc) {
+			options.snapshot_ticks = std::stoul(argv[++i]);
+		}
+		else if (arg == "--profile" && i + 1 < argc) {
+			options.trace_file = argv[++i];
+		}
+		else if (arg == "--level" && i + 1 < argc) {
+			options.level = argv[++i];
+		}
+		else if (arg == "--tmx" && i + 1 < argc) {
+			options.tmx_files.push_back(argv[++i]);
+		}
+		else if (arg == "--tmx-repeat" && i + 1 < argc) {
+			options.tmx_repeat = std::stoul(argv[++i]);
+		}
+		else if (arg == "--checksum" && i + 1 < argc) {
+			options.check_checksum = true;
+			options.expected_checksum = std::stoull(argv[++i], nullptr, 16);
+		}
+		else {
+			std::fprintf(stderr, "Usage: %s [--entities N] [--ticks M] [--level file.tmx] [--serial] [--stream] [--churn N] [--profile trace.json] [--checksum HEX]\n"
+				     "       %s --snapshot N [--entities N] [--churn N] [--level file.tmx]\n"
+				     "       %s --spawn N [--entities N] [--ticks M] [--level file.tmx]\n"
+				     "       %s --hitboxes N [--ticks M] [--level file.tmx]\n"
+				     "       %s --animation-sweep [--ticks M] [--level file.tmx] [--serial]\n"
+				     "       %s --tmx file.tmx [--tmx other.tmx ...] [--tmx-repeat N]\n", argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+			std::exit(1);
+		}
+	}
+	return options;
+}
+
+const size_t spawn_columns = 32;
+
+te::vec2 get_spawn_position(size_t i)
+{
+	return{ 4.f + 2.f * (i % spawn_columns), 4.f + 2.f * (i / spawn_columns) };
+}
+
+// Spawns entities round-robin over the entity table on a grid, so every
+// run places the same entities at the same positions.
+std::vector<te::Entity_id> spawn_entities(te::Game_data& data, size_t count)
+{
+	std::vector<te::Entity_id> ids;
+	if (data.entity_table.empty()) {
+		return ids;
+	}
+	auto entity_it = data.entity_table.begin();
+	for (size_t i = 0; i < count; ++i) {
+		ids.push_back(te::make_entity(entity_it->second, data, get_spawn_position(i)));
+		if (++entity_it == data.entity_table.end()) {
+			entity_it = data.entity_table.begin();
+		}
+	}
+	return ids;
+}
+
+// Despawns the `count` oldest spawned entities and spawns as many
+// replacements in their grid slots; the despawns land at the end of the
+// next step_game.
+void churn_entities(te::Game_data& data, std::vector<te::Entity_id>& ids, size_t& cursor, size_t count)
+{
+	if (ids.empty()) {
+		return;
+	}
+	for (size_t i = 0; i < count; ++i) {
+		const auto slot = cursor++ % ids.size();
+		te::despawn(data, ids[slot]);
+		const auto& entity_xml = std::next(data.entity_table.begin(), slot % data.entity_table.size())->second;
+		ids[slot] = te::make_entity(entity_xml, data, get_spawn_position(slot));
+	}
+}
+
+// Scripted input for player 0: walk in each of the eight directions in
+// turn and light attack at a fixed interval.
+void script_input(te::Game_data& data, size_t tick)
+{
+	static const float diagonal = 0.70710678f;
+	static const te::vec2 directions[] = {
+		{ 1.f, 0.f }, { diagonal, diagonal }, { 0.f, 1.f }, { -diagonal, diagonal },
+		{ -1.f, 0.f }, { -diagonal, -diagonal }, { 0.f, -1.f }, { diagonal, -diagonal }
+	};
+	auto& input = data.inputs[0];
+	const auto direction = directions[(tick / 120) % 8];
+	input.x_movement = direction.x;
+	input.y_movement = direction.y;
+	input.light_attack.fire = tick % 90 == 0;
+}
+
+// FNV-1a over the bytes of the values mixed in.
+struct Fnv1a {
+	std::uint64_t hash = 14695981039346656037ull;
+
+	template <typename T>
+	void mix(const T& value)
+	{
+		const auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+		for (size_t i = 0; i < sizeof(T); ++i) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	}
+};
+
+// Over entity ids and the bit patterns of their positions.
+std::uint64_t checksum_positions(const te::Game_data& data)
+{
+	Fnv1a fnv;
+	for (const auto& position_pair : data.positions) {
+		fnv.mix(position_pair.first);
+		fnv.mix(position_pair.second.x);
+		fnv.mix(position_pair.second.y);
+	}
+	return fnv.hash;
+}
+
+// Over the positions and, per entity, the Entity_xml it was made from and
+// its body's transform, velocities and awake flag.
+std::uint64_t checksum_entity_state(const te::Game_data& data)
+{
+	Fnv1a fnv;
+	fnv.mix(checksum_positions(data));
+	for (const auto& entity_pair : data.entity_xmls) {
+		fnv.mix(entity_pair.first);
+		fnv.mix(entity_pair.second);
+		auto found = data.physics_manager.find_rigid_body(entity_pair.first);
+		if (found == data.physics_manager.end()) {
+			continue;
+		}
+		const b2Body* p_body = found->second.get();
+		fnv.mix(p_body->GetPosition().x);
+		fnv.mix(p_body->GetPosition().y);
+		fnv.mix(p_body->GetAngle());
+		fnv.mix(p_body->GetLinearVelocity().x);
+		fnv.mix(p_body->GetLinearVelocity().y);
+		fnv.mix(p_body->GetAngularVelocity());
+		fnv.mix(p_body->IsAwake());
+	}
+	return fnv.hash;
+}
+
+void print_timings(const std::string& name, std::vector<double> samples)
+{
+	if (samples.empty()) {
+		return;
+	}
+	std::sort(samples.begin(), samples.end());
+	double total = 0.0;
+	for (auto sample : samples) {
+		total += sample;
+	}
+	const auto p99_index = std::min(samples.size() - 1, samples.size() * 99 / 100);
+	std::printf("%-28s %10.2f %10.2f %10.2f\n",
+		    name.c_str(),
+		    total / samples.size() * 1e6,
+		    samples[samples.size() / 2] * 1e6,
+		    samples[p99_index] * 1e6);
+}
+
+// Parses each map `repeat` times and reports the mean parse time and the
+// peak heap growth while parsing.
+void run_tmx_benchmark(const std::vector<std::string>& filenames, size_t repeat)
+{
+	std::printf("%-32s %10s %10s %12s\n", "tmx", "mean ms", "min ms", "peak KiB");
+	for (const auto& filename : filenames) {
+		double total = 0.0;
+		double best = 0.0;
+		size_t peak = 0;
+		size_t tile_count = 0;
+		for (size_t i = 0; i < repeat; ++i) {
+			const auto baseline = heap_bytes.load();
+			heap_peak_bytes = baseline;
+			const auto start = std::chrono::high_resolution_clock::now();
+			{
+				te::Tmx tmx{ filename };
+				tile_count = 0;
+				for (const auto& layer : tmx.layers) {
+					tile_count += std::distance(layer.data.begin(), layer.data.end());
+				}
+			}
+			const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			total += elapsed.count();
+			best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+			peak = std::max(peak, heap_peak_bytes.load() - baseline);
+		}
+		std::printf("%-32s %10.3f %10.3f %12zu  (%zu tiles)\n",
+			    filename.c_str(),
+			    total / repeat * 1e3,
+			    best * 1e3,
+			    peak / 1024,
+			    tile_count);
+	}
+}
+
+struct Hit {
+	te::Entity_id attacker_id;
+	te::Entity_id target_id;
+
+	bool operator<(const Hit& rhs) const
+	{
+		return attacker_id != rhs.attacker_id ? attacker_id < rhs.attacker_id : target_id < rhs.target_id;
+	}
+	bool operator==(const Hit& rhs) const
+	{
+		return attacker_id == rhs.attacker_id && target_id == rhs.target_id;
+	}
+};
+
+// What step_attack_queries did before the hitbox broadphase: one world
+// query per attack, reporting every sensor whose fattened proxy it
+// overlaps.
+void find_hits_with_world_queries(const te::Game_data& data, const std::vector<te::Game_data::Attack_query>& attacks, std::vector<Hit>& hits)
+{
+	struct Callback : public b2QueryCallback {
+		te::Entity_id attacker_id;
+		b2AABB aabb;
+		const te::Game_data& data;
+		std::vector<Hit>& hits;
+
+		Callback(te::Entity_id attacker_id, const b2AABB& aabb, const te::Game_data& data, std::vector<Hit>& hits)
+			: attacker_id{ attacker_id }
+			, aabb(aabb)
+			, data{ data }
+			, hits{ hits }
+		{}
+
+		bool ReportFixture(b2Fixture* fixture) override
+		{
+			const auto id = te::Physics_manager::get_entity_id(*fixture->GetBody());
+			if (id == attacker_id || !fixture->IsSensor()) {
+				return true;
+			}
+			auto found = data.entity_team_masks.find(id);
+			if (found != data.entity_team_masks.end() && (found->second & data.team_masks.at(1))) {
+				hits.push_back({ attacker_id, id });
+			}
+			return true;
+		}
+	};
+
+	for (const auto& attack : attacks) {
+		Callback callback{ attack.entity_id, attack.aabb, data, hits };
+		data.physics_manager.query_aabb(callback, attack.aabb);
+	}
+}
+
+// Spawns waves of `wave_size` entities of one type next to the entities
+// already spawned and despawns them again; only the spawns are timed. Both
+// passes spawn from the compiled prefab, so they compare one-at-a-time
+// against batched spawning, not spawning without prefabs.
+void run_spawn_benchmark(te::Game_data& data, size_t wave_size, size_t repeat)
+{
+	const auto& entity_xml = data.entity_table.begin()->second;
+	const auto first_slot = data.positions.size();
+	std::vector<te::Entity_id> ids;
+	auto despawn_wave = [&data, &ids]() {
+		for (auto id : ids) {
+			te::despawn(data, id);
+		}
+		te::despawn_entities(data);
+		ids.clear();
+	};
+
+	std::vector<double> make_samples;
+	// The first wave creates the animations and compiles the prefab; it is
+	// left out of the timings.
+	for (size_t i = 0; i <= repeat; ++i) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (size_t j = 0; j < wave_size; ++j) {
+			ids.push_back(te::make_entity(entity_xml, data, get_spawn_position(first_slot + j)));
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		if (i > 0) {
+			make_samples.push_back(elapsed.count());
+		}
+		despawn_wave();
+	}
+
+	const auto& prefab = te::get_prefab(entity_xml, data);
+	std::vector<te::vec2> positions;
+	for (size_t j = 0; j < wave_size; ++j) {
+		positions.push_back(get_spawn_position(first_slot + j));
+	}
+	std::vector<double> batch_samples;
+	for (size_t i = 0; i < repeat; ++i) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		ids = te::spawn_batch(prefab, positions, data);
+		const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		batch_samples.push_back(elapsed.count());
+		despawn_wave();
+	}
+
+	std::printf("entities %zu, waves of %zu %s\n", data.positions.size(), wave_size, entity_xml.name.c_str());
+	std::printf("%-28s %10s %10s %10s\n", "wave (us)", "mean", "p50", "p99");
+	print_timings("make_entity (prefab)", make_samples);
+	print_timings("spawn_batch (prefab)", batch_samples);
+	auto print_rate = [wave_size](const char* name, const std::vector<double>& samples) {
+		const auto total = std::accumulate(samples.begin(), samples.end(), 0.0);
+		std::printf("%-28s %10.0f entities/s\n", name, wave_size * samples.size() / total);
+	};
+	print_rate("make_entity (prefab)", make_samples);
+	print_rate("spawn_batch (prefab)", batch_samples);
+}
+
+// Spawns `count` attackers on team 1 and as many targets on team 2 on
+// alternating grid slots, each attacker reaching its neighbours, and times
+// resolving one attack per attacker with world queries and with the
+// hitbox broadphase. Returns whether both found the same hits.
+bool run_hitbox_benchmark(te::Game_data& data, size_t count, size_t repeat)
+{
+	data.team_masks[1] = 0x2;
+	data.team_masks[2] = 0x1;
+	std::vector<te::Game_data::Attack_query> attacks;
+	const auto& entity_xml = data.entity_table.begin()->second;
+	std::vector<te::Entity_id> ids;
+	for (size_t i = 0; i < 2 * count; ++i) {
+		ids.push_back(te::make_entity(entity_xml, data, get_spawn_position(i)));
+		data.entity_team_masks[ids.back()] = i % 2 == 0 ? 0x1 : 0x2;
+	}
+	// Each attack reaches the target behind it and ends inside the target
+	// ahead, inside that target's proxy margin, or short of both, so hits
+	// decided by the margin are compared too.
+	const float gaps[] = { -0.5f * b2_aabbExtension, 0.5f * b2_aabbExtension, 1.5f * b2_aabbExtension };
+	for (size_t i = 0; i + 1 < ids.size(); i += 2) {
+		const auto position = get_spawn_position(i);
+		const auto* p_body = data.physics_manager.find_rigid_body(ids[i + 1])->second.get();
+		float target_min_x = position.x + 2.5f;
+		for (const auto* p_fixture = p_body->GetFixtureList(); p_fixture != nullptr; p_fixture = p_fixture->GetNext()) {
+			if (p_fixture->IsSensor()) {
+				b2AABB target_aabb;
+				p_fixture->GetShape()->ComputeAABB(&target_aabb, p_body->GetTransform(), 0);
+				target_min_x = std::min(target_min_x, target_aabb.lowerBound.x);
+			}
+		}
+		b2AABB aabb;
+		aabb.lowerBound = { position.x - 2.5f, position.y - 1.5f };
+		aabb.upperBound = { target_min_x - gaps[(i / 2) % 3], position.y + 1.5f };
+		attacks.push_back({ ids[i], aabb, 1 });
+	}
+
+	std::vector<Hit> world_hits;
+	std::vector<Hit> broadphase_hits;
+	std::vector<double> world_samples;
+	std::vector<double> broadphase_samples;
+	auto& broadphase = data.hitbox_broadphase;
+	for (size_t i = 0; i < repeat; ++i) {
+		world_hits.clear();
+		auto start = std::chrono::high_resolution_clock::now();
+		find_hits_with_world_queries(data, attacks, world_hits);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		world_samples.push_back(elapsed.count());
+
+		broadphase_hits.clear();
+		start = std::chrono::high_resolution_clock::now();
+		broadphase.gather_hurtboxes(data.physics_manager, data.entity_team_masks);
+		for (const auto& attack : attacks) {
+			broadphase.add_attack(attack.entity_id,
+					      { attack.aabb.lowerBound.x, attack.aabb.lowerBound.y },
+					      { attack.aabb.upperBound.x, attack.aabb.upperBound.y },
+					      data.team_masks[1],
+					      attack.damage);
+		}
+		broadphase.find_hits([&broadphase_hits](te::Entity_id attacker_id, te::Entity_id target_id, int) {
+			broadphase_hits.push_back({ attacker_id, target_id });
+		});
+		elapsed = std::chrono::high_resolution_clock::now() - start;
+		broadphase_samples.push_back(elapsed.count());
+	}
+
+	std::printf("attackers %zu, targets %zu, hurtboxes %zu, hits %zu\n",
+		    attacks.size(),
+		    data.entity_team_masks.size() - attacks.size(),
+		    broadphase.get_hurtbox_count(),
+		    broadphase_hits.size());
+	std::printf("%-28s %10s %10s %10s\n", "pass (us)", "mean", "p50", "p99");
+	print_timings("world QueryAABB", world_samples);
+	print_timings("hitbox broadphase", broadphase_samples);
+	std::sort(world_hits.begin(), world_hits.end());
+	std::sort(broadphase_hits.begin(), broadphase_hits.end());
+	const bool same = world_hits == broadphase_hits;
+	std::printf("hits %s\n", same ? "match" : "DIFFER");
+	return same;
+}
+
+// Steps `tick_count` ticks from `first_tick` with the scripted input and
+// churn, and returns the positions checksum.
+std::uint64_t step_ticks(te::Game_data& data, size_t first_tick, size_t tick_count, std::vector<te::Entity_id>& ids, size_t& cursor, size_t churn)
+{
+	const float dt = 1.f / 60.f;
+	for (size_t tick = first_tick; tick < first_tick + tick_count; ++tick) {
+		script_input(data, tick);
+		churn_entities(data, ids, cursor, churn);
+		te::step_game(data, dt);
+		te::stream_level(data);
+	}
+	return checksum_positions(data);
+}
+
+// Saves a snapshot, steps ahead, restores it and steps the same ticks
+// twice more. Every restore must bring back the saved entities and bodies
+// exactly, and every run must end on the same positions as the first.
+// Returns false otherwise.
+bool run_snapshot_check(te::Game_data& data, size_t tick_count, std::vector<te::Entity_id>& ids, size_t churn)
+{
+	const size_t repeat = 100;
+	te::Snapshot snapshot;
+	std::vector<double> save_samples;
+	for (size_t i = 0; i < repeat; ++i) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		snapshot.save(data);
+		const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		save_samples.push_back(elapsed.count());
+	}
+	const auto saved_ids = ids;
+	const auto saved_state = checksum_entity_state(data);
+
+	std::vector<double> restore_samples;
+	std::vector<std::uint64_t> restored_states;
+	std::vector<std::uint64_t> checksums;
+	std::vector<decltype(data.positions)> end_positions;
+	for (size_t run = 0; run < 3; ++run) {
+		if (run > 0) {
+			const auto start = std::chrono::high_resolution_clock::now();
+			snapshot.restore(data);
+			const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			restore_samples.push_back(elapsed.count());
+			restored_states.push_back(checksum_entity_state(data));
+		}
+		ids = saved_ids;
+		size_t cursor = 0;
+		checksums.push_back(step_ticks(data, 0, tick_count, ids, cursor, churn));
+		end_positions.push_back(data.positions);
+	}
+	float max_deviation = 0.f;
+	for (const auto& positions : end_positions) {
+		for (const auto& position_pair : positions) {
+			auto found = end_positions.front().find(position_pair.first);
+			max_deviation = found == end_positions.front().end()
+				? std::numeric_limits<float>::infinity()
+				: std::max(max_deviation, glm::length(position_pair.second - found->second));
+		}
+	}
+	// Restoring onto the state it was saved from.
+	for (size_t i = 0; i < repeat; ++i) {
+		snapshot.save(data);
+		const auto start = std::chrono::high_resolution_clock::now();
+		snapshot.restore(data);
+		const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		restore_samples.push_back(elapsed.count());
+	}
+
+	std::printf("entities %zu, snapshot %.1f KiB, churn %zu per tick\n", data.entity_xmls.size(), snapshot.size() / 1024.0, churn);
+	std::printf("%-28s %10s %10s %10s\n", "snapshot (us)", "mean", "p50", "p99");
+	print_timings("save", save_samples);
+	print_timings("restore", restore_samples);
+	for (size_t run = 0; run < checksums.size(); ++run) {
+		std::printf("%-28s %016llx\n", run == 0 ? "stepped" : "restored and stepped", static_cast<unsigned long long>(checksums[run]));
+	}
+	const bool restored = std::all_of(restored_states.begin(), restored_states.end(), [saved_state](std::uint64_t checksum) {
+		return checksum == saved_state;
+	});
+	const bool same = std::all_of(checksums.begin(), checksums.end(), [&checksums](std::uint64_t checksum) {
+		return checksum == checksums.front();
+	});
+	std::printf("round trip %s\n", restored ? "matches" : "DIFFERS");
+	std::printf("stepping after a restore %s, max position deviation %g\n", same ? "matches" : "DIFFERS", max_deviation);
+	return restored && same;
+}
+
+void print_region_stats(const te::Level_streamer& streamer)
+{
+	const auto stats = streamer.get_loaded_stats();
+	std::printf("regions loaded %zu of %zu\n", stats.size(), streamer.get_region_count());
+	std::printf("%-12s %12s %10s %10s %10s %12s\n", "region", "vertex KiB", "fixtures", "entities", "build ms", "finish ms");
+	for (const auto& region : stats) {
+		std::printf("%5d,%-6d %12.1f %10zu %10zu %10.3f %12.3f\n",
+			    region.x,
+			    region.y,
+			    region.vertex_bytes / 1024.0,
+			    region.fixture_count,
+			    region.entity_count,
+			    region.build_seconds * 1e3,
+			    region.finalize_seconds * 1e3);
+	}
+}
+
+// Loads the image data, entity types and level as the game does, but
+// without a GL context.
+void load_game_data(const Options& options, te::Game_data& data)
+{
+	data.headless = true;
+	data.serial_stepping = options.serial;
+	data.pixel_to_world_scale = { 16.f, 16.f };
+	data.resolution = { 480.f, 270.f };
+	data.image_root = "assets/spritesheets/";
+
+	te::load_image_data_or_pack("assets/spritesheets/image_data.xml", "assets/spritesheets/image_data.pack", data);
+	te::load_entities_xml("assets/entities/entities.xml", data);
+	if (options.stream) {
+		te::load_streamed_level(options.level, data);
+	}
+	else {
+		te::load_level(options.level, data);
+	}
+}
+
+// Times step_animations over `tick_count` ticks in a fresh game with 100,
+// 1000 and 10000 entities, to show it grows with the entity count alone.
+void run_animation_sweep(const Options& options)
+{
+	const float dt = 1.f / 60.f;
+	const size_t entity_counts[] = { 100, 1000, 10000 };
+	std::printf("step_animations, ticks %zu, %s\n", options.tick_count, options.serial ? "serial" : "parallel");
+	std::printf("%-10s %10s %10s %10s %10s %14s\n", "entities", "animated", "mean", "p50", "p99", "p50 ns/entity");
+	for (auto entity_count : entity_counts) {
+		auto p_data = std::make_unique<te::Game_data>();
+		auto& data = *p_data;
+		load_game_data(options, data);
+		spawn_entities(data, entity_count);
+		// The first step creates the scheduler; it is left out of the timings.
+		te::step_game(data, dt);
+		data.system_scheduler->set_timing(true);
+		size_t step_index = 0;
+		while (data.system_scheduler->get_step_name(step_index) != "step_animations") {
+			++step_index;
+		}
+
+		std::vector<double> samples;
+		samples.reserve(options.tick_count);
+		for (size_t tick = 0; tick < options.tick_count; ++tick) {
+			script_input(data, tick);
+			te::step_game(data, dt);
+			samples.push_back(data.system_scheduler->get_step_seconds(step_index));
+		}
+		if (samples.empty()) {
+			continue;
+		}
+		std::sort(samples.begin(), samples.end());
+		const auto p50 = samples[samples.size() / 2];
+		const auto animated = data.entity_animations2.size();
+		std::printf("%-10zu %10zu %10.2f %10.2f %10.2f %14.1f\n",
+			    entity_count,
+			    animated,
+			    std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size() * 1e6,
+			    p50 * 1e6,
+			    samples[std::min(samples.size() - 1, samples.size() * 99 / 100)] * 1e6,
+			    p50 * 1e9 / std::max<size_t>(animated, 1));
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	using namespace te;
+
+	const auto options = parse_options(argc, argv);
+	if (!options.tmx_files.empty()) {
+		run_tmx_benchmark(options.tmx_files, std::max<size_t>(options.tmx_repeat, 1));
+		return 0;
+	}
+	if (options.animation_sweep) {
+		run_animation_sweep(options);
+		return 0;
+	}
+	const float dt = 1.f / 60.f;
+
+	set_profiling(!options.trace_file.empty());
+	Game_data data{};
+	load_game_data(options, data);
+	if (options.hitbox_count > 0) {
+		return run_hitbox_benchmark(data, options.hitbox_count, std::max<size_t>(options.tick_count, 1)) ? 0 : 1;
+	}
+	auto spawned_ids = spawn_entities(data, options.entity_count);
+	size_t churn_cursor = 0;
+	if (options.spawn_wave > 0) {
+		run_spawn_benchmark(data, options.spawn_wave, std::max<size_t>(options.tick_count, 1));
+		return 0;
+	}
+
+	// The first step creates the scheduler; it is left out of the timings.
+	step_game(data, dt);
+	stream_level(data);
+	if (options.snapshot_ticks > 0) {
+		return run_snapshot_check(data, options.snapshot_ticks, spawned_ids, options.churn) ? 0 : 1;
+	}
+	data.system_scheduler->set_timing(true);
+
+	const auto step_count = data.system_scheduler->get_step_count();
+	std::vector<std::vector<double>> step_samples(step_count);
+	std::vector<double> tick_samples;
+	tick_samples.reserve(options.tick_count);
+	for (auto& samples : step_samples) {
+		samples.reserve(options.tick_count);
+	}
+
+	std::vector<double> churn_samples;
+	// What the render thread is handed each tick; built here as the game's
+	// simulation thread does, but never drawn.
+	Render_frames render_frames;
+	std::vector<double> publish_samples;
+	publish_samples.reserve(options.tick_count);
+	const auto allocation_baseline = heap_allocation_count.load();
+	for (size_t tick = 0; tick < options.tick_count; ++tick) {
+		script_input(data, tick);
+		if (options.churn > 0) {
+			const auto churn_start = std::chrono::high_resolution_clock::now();
+			churn_entities(data, spawned_ids, churn_cursor, options.churn);
+			const std::chrono::duration<double> churn_elapsed = std::chrono::high_resolution_clock::now() - churn_start;
+			churn_samples.push_back(churn_elapsed.count());
+		}
+		const auto start = std::chrono::high_resolution_clock::now();
+		step_game(data, dt);
+		const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		tick_samples.push_back(elapsed.count());
+		stream_level(data);
+		const auto publish_start = std::chrono::high_resolution_clock::now();
+		render_frames.publish(data, std::chrono::steady_clock::now());
+		const std::chrono::duration<double> publish_elapsed = std::chrono::high_resolution_clock::now() - publish_start;
+		publish_samples.push_back(publish_elapsed.count());
+		mark_profile_frame();
+		for (size_t i = 0; i < step_count; ++i) {
+			step_samples[i].push_back(data.system_scheduler->get_step_seconds(i));
+		}
+	}
+
+	std::printf("entities %zu, ticks %zu, %s\n",
+		    data.positions.size(),
+		    options.tick_count,
+		    options.serial ? "serial" : "parallel");
+	std::printf("%-28s %10s %10s %10s\n", "step (us)", "mean", "p50", "p99");
+	for (size_t i = 0; i < step_count; ++i) {
+		print_timings(data.system_scheduler->get_step_name(i), step_samples[i]);
+	}
+	print_timings("step_game", tick_samples);
+	print_timings("churn_entities", churn_samples);
+	print_timings("publish_render_frame", publish_samples);
+	std::printf("heap allocations per tick %.1f, pooled bodies %zu\n",
+		    static_cast<double>(heap_allocation_count.load() - allocation_baseline) / std::max<size_t>(options.tick_count, 1),
+		    data.physics_manager.get_pooled_count());
+	const auto checksum = checksum_positions(data);
+	std::printf("positions checksum %016llx\n", static_cast<unsigned long long>(checksum));
+	if (data.level_streamer) {
+		print_region_stats(*data.level_streamer);
+	}
+	if (!options.trace_file.empty()) {
+		const auto frame_times = get_frame_time_percentiles();
+		std::printf("frame ms over %zu frames: p50 %.3f, p95 %.3f, p99 %.3f\n",
+			    frame_times.frame_count,
+			    frame_times.p50 * 1e3,
+			    frame_times.p95 * 1e3,
+			    frame_times.p99 * 1e3);
+		if (!write_chrome_trace(options.trace_file)) {
+			std::fprintf(stderr, "could not write %s\n", options.trace_file.c_str());
+			return 1;
+		}
+	}
+	if (options.check_checksum && checksum != options.expected_checksum) {
+		std::fprintf(stderr, "positions checksum DIFFERS, expected %016llx\n", static_cast<unsigned long long>(options.expected_checksum));
+		return 1;
+	}
+
+	return 0;
+}
@@ -1,6 +1,7 @@
 #include "bounding_box_component.h"
 #include "transform_component.h"
 #include <array>
+#include <cmath>
 
 namespace te
 {
@@ -36,38 +37,44 @@ namespace te
         }
     }
 
+    // The box around a transformed rectangle: its centre moves with the
+    // transform and its half extents scale by the transform's absolute
+    // value, which bounds all four corners without transforming each.
+    static BoundingBox getWorldBoundingBox(const glm::mat4& transform, const BBInstance& instance)
+    {
+        glm::vec4 center = transform * glm::vec4{ instance.offset.x, instance.offset.y, 0, 1 };
+        glm::vec2 halfDimensions = glm::abs(instance.dimensions) / 2.f;
+        glm::vec2 halfExtents = {
+            std::abs(transform[0][0]) * halfDimensions.x + std::abs(transform[1][0]) * halfDimensions.y,
+            std::abs(transform[0][1]) * halfDimensions.x + std::abs(transform[1][1]) * halfDimensions.y
+        };
+
+        return {
+            center.x - halfExtents.x,
+            center.y - halfExtents.y,
+            2 * halfExtents.x,
+            2 * halfExtents.y
+        };
+    }
+
 	BoundingBox BoundingBoxComponent::getBoundingBox(const Entity& entity) const
 	{
         if (!hasInstance(entity)) { throw std::out_of_range("No bounding box instance for entity."); }
 
-        const BBInstance& instance = at(entity);
-
-        glm::mat4 transform = mpTransform->getWorldTransform(entity);
-
-        glm::vec4 vertices[4] = {
-            transform * glm::vec4{ -(instance.dimensions.x) / 2 + instance.offset.x, -(instance.dimensions.y) / 2 + instance.offset.y, 0, 1 },
-            transform * glm::vec4{  (instance.dimensions.x) / 2 + instance.offset.x, -(instance.dimensions.y) / 2 + instance.offset.y, 0, 1 },
-            transform * glm::vec4{  (instance.dimensions.x) / 2 + instance.offset.x,  (instance.dimensions.y) / 2 + instance.offset.y, 0, 1 },
-            transform * glm::vec4{ -(instance.dimensions.x) / 2 + instance.offset.x,  (instance.dimensions.y) / 2 + instance.offset.y, 0, 1 }
-        };
+        return getWorldBoundingBox(mpTransform->getWorldTransform(entity), at(entity));
+	}
 
-        glm::vec2 min = { vertices[0].x, vertices[0].y };
-        glm::vec2 max = { vertices[0].x, vertices[0].y };
-        for (unsigned i = 0; i < 4; ++i)
+    void BoundingBoxComponent::getBoundingBoxes(std::vector<Entity>& entities, std::vector<BoundingBox>& boxes)
+    {
+        entities.clear();
+        boxes.clear();
+        const TransformComponent& transform = *mpTransform;
+        forEach([&entities, &boxes, &transform](const Entity& entity, const BBInstance& instance)
         {
-            if (vertices[i].x < min.x) { min.x = vertices[i].x; }
-            if (vertices[i].y < min.y) { min.y = vertices[i].y; }
-            if (vertices[i].x > max.x) { max.x = vertices[i].x; }
-            if (vertices[i].y > max.y) { max.y = vertices[i].y; }
-        }
-
-        return {
-            min.x,
-            min.y,
-            max.x - min.x,
-            max.y - min.y
-        };
-	}
+            entities.push_back(entity);
+            boxes.push_back(getWorldBoundingBox(transform.getWorldTransform(entity), instance));
+        });
+    }
 
     //SDL_Rect BoundingBoxComponent::getBoundingBox(const Entity& entity) const
     //{
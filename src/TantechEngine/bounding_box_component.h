@@ -3,6 +3,7 @@
 
 #include <glm/glm.hpp>
 #include <memory>
+#include <vector>
 #include "component.h"
 
 struct SDL_Rect;
@@ -34,6 +35,9 @@ namespace te
 
         void setBoundingBox(const Entity& entity, const glm::vec2& dimensions, const glm::vec2& offset);
         BoundingBox getBoundingBox(const Entity& entity) const;
+        // Replaces the contents of both vectors with every entity and its
+        // world box, in matching order.
+        void getBoundingBoxes(std::vector<Entity>& entities, std::vector<BoundingBox>& boxes);
 	private:
 		friend class CollisionSystem;
 
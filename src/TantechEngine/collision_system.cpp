@@ -4,6 +4,7 @@
 #include "auxiliary.h"
 #include "tiled_map.h"
 #include <SDL_rect.h>
+#include <algorithm>
 
 namespace te
 {
@@ -14,28 +15,41 @@ namespace te
         ObserverList&& observers)
         : mpBoundingBox(pBoundingBox)
         , mObservers(std::move(observers))
+        , mEntities()
+        , mBoxes()
+        , mSweep()
     {}
 
     void CollisionSystem::update(float dt) const
     {
-        BoundingBoxComponent& bbcomponent = *mpBoundingBox;
-        const ObserverList& observers = mObservers;
+        mpBoundingBox->getBoundingBoxes(mEntities, mBoxes);
+
+        mSweep.clear();
+        for (unsigned i = 0; i < mBoxes.size(); ++i)
+        {
+            const BoundingBox& box = mBoxes[i];
+            mSweep.push_back({ box.x, box.x + box.w, box.y, box.y + box.h, i });
+        }
+        std::sort(std::begin(mSweep), std::end(mSweep), [](const SweepEntry& lhs, const SweepEntry& rhs)
+        {
+            return lhs.left < rhs.left;
+        });
 
-        bbcomponent.forEach([&bbcomponent, &observers, dt](const Entity& entityA, BBInstance instanceA)
+        // Same test as checkCollision: boxes that only touch do not collide.
+        for (auto itA = std::begin(mSweep); itA != std::end(mSweep); ++itA)
         {
-            bbcomponent.forEach([&entityA, &bbcomponent, &observers, dt](const Entity& entityB, BBInstance& instanceB)
+            for (auto itB = itA + 1; itB != std::end(mSweep) && itB->left < itA->right; ++itB)
             {
-                if (entityA != entityB &&
-                    checkCollision(bbcomponent.getBoundingBox(entityA),
-                                   bbcomponent.getBoundingBox(entityB)))
+                if (itA->top < itB->bottom && itB->top < itA->bottom)
                 {
-                    std::for_each(std::begin(observers), std::end(observers), [&entityA, &entityB, dt](std::shared_ptr<Observer<CollisionEvent>> pObserver)
+                    CollisionEvent evt{ mEntities[itA->index], mEntities[itB->index], dt };
+                    std::for_each(std::begin(mObservers), std::end(mObservers), [&evt](const std::shared_ptr<Observer<CollisionEvent>>& pObserver)
                     {
-                        pObserver->onNotify({entityA, entityB, dt});
+                        pObserver->onNotify(evt);
                     });
                 }
-            });
-        });
+            }
+        }
     }
 
     MapCollisionSystem::MapCollisionSystem(
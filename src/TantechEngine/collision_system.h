@@ -5,10 +5,10 @@
 #include <memory>
 #include "entity_manager.h"
 #include "observer.h"
+#include "bounding_box_component.h"
 
 namespace te
 {
-    class BoundingBoxComponent;
     class TransformComponent;
     class TiledMap;
 
@@ -19,6 +19,9 @@ namespace te
         float dt;
     };
 
+    // Reports each pair of overlapping bounding boxes once per update. The
+    // world boxes are computed once, sorted by left edge, and each box is
+    // only tested against the boxes that start before it ends.
     class CollisionSystem
     {
     public:
@@ -31,8 +34,22 @@ namespace te
         void update(float dt) const;
 
     private:
+        struct SweepEntry
+        {
+            float left;
+            float right;
+            float top;
+            float bottom;
+            unsigned index;
+        };
+
         std::shared_ptr<BoundingBoxComponent> mpBoundingBox;
         ObserverList mObservers;
+
+        // Reused between updates.
+        mutable std::vector<Entity> mEntities;
+        mutable std::vector<BoundingBox> mBoxes;
+        mutable std::vector<SweepEntry> mSweep;
     };
 
     struct MapCollisionEvent
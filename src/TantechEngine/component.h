@@ -1,15 +1,17 @@
 #ifndef TE_COMPONENT_H
 #define TE_COMPONENT_H
 
-#include <functional>
 #include <vector>
-#include <map>
 #include <algorithm>
+#include <stdexcept>
 #include "entity_manager.h"
 #include "observer.h"
 
 namespace te
 {
+    // Instances are packed in a dense array and found through a sparse
+    // array indexed by Entity::index. A dense entry keeps its entity, so a
+    // lookup with a recycled index but an older generation misses.
     template <class Instance>
     class Component : public Observer<DestroyEvent>
     {
@@ -22,9 +24,10 @@ namespace te
 
         Component(std::size_t capacity = 1024)
             : mData()
-            , mMap()
+            , mSparse()
         {
             mData.reserve(capacity);
+            mSparse.reserve(capacity);
         }
         virtual ~Component() {}
 
@@ -40,27 +43,33 @@ namespace te
                 throw std::runtime_error("Instance already exists for entity.");
             }
 
-            if (mData.size() == mData.capacity())
+            if (entity.index >= mSparse.size())
             {
-                mData.reserve(mData.capacity() + 1024);
+                mSparse.resize(entity.index + 1, InvalidSlot);
             }
-            unsigned i = mData.size();
-            mData.push_back(std::move(Entry{ entity, instance }));
-            mMap.insert(std::make_pair(entity, i));
-
-            return at(entity);
+            unsigned& slot = mSparse[entity.index];
+            // An instance left behind by an earlier generation is dead, so
+            // the new one takes its place.
+            if (slot != InvalidSlot)
+            {
+                mData[slot] = Entry{ entity, std::move(instance) };
+                return mData[slot].instance;
+            }
+            slot = mData.size();
+            mData.push_back(Entry{ entity, std::move(instance) });
+            return mData.back().instance;
         }
 
         bool hasInstance(const Entity& entity) const
         {
-            return mMap.find(entity) != mMap.end();
+            return findSlot(entity) != InvalidSlot;
         }
 
         const Instance& at(const Entity& entity) const
         {
-            auto it = mMap.find(entity);
-            if (it == mMap.end()) { throw std::out_of_range("No instance for entity."); }
-            return mData[it->second].instance;
+            unsigned slot = findSlot(entity);
+            if (slot == InvalidSlot) { throw std::out_of_range("No instance for entity."); }
+            return mData[slot].instance;
         }
 
         Instance& at(const Entity& entity)
@@ -70,36 +79,62 @@ namespace te
 
         virtual void destroyInstance(const Entity& entity)
         {
-            auto it = mMap.find(entity);
-            if (it == mMap.end()) { return; }
-
-            unsigned i = it->second;
-            unsigned lastI = mData.size() - 1;
-            Entity lastEntity = mData[lastI].entity;
-
-            mData[i] = mData[lastI];
-
-            mMap[lastEntity] = i;
+            unsigned slot = findSlot(entity);
+            if (slot == InvalidSlot) { return; }
 
-            mMap.erase(it);
+            unsigned lastSlot = mData.size() - 1;
+            if (slot != lastSlot)
+            {
+                mData[slot] = std::move(mData[lastSlot]);
+                mSparse[mData[slot].entity.index] = slot;
+            }
+            mSparse[entity.index] = InvalidSlot;
             mData.pop_back();
         }
 
+        // Reorders instances for forEach. Equal instances keep their order.
+        template <class Compare>
+        void sortInstances(Compare compare)
+        {
+            std::stable_sort(std::begin(mData), std::end(mData), [&compare](const Entry& lhs, const Entry& rhs)
+            {
+                return compare(lhs.instance, rhs.instance);
+            });
+            for (unsigned slot = 0; slot < mData.size(); ++slot)
+            {
+                mSparse[mData[slot].entity.index] = slot;
+            }
+        }
+
     public:
-        void forEach(std::function<void(const Entity&, Instance&)> f)
+        template <class Function>
+        void forEach(Function f)
         {
-            std::for_each(std::begin(mData), std::end(mData), [&f](Entry& entry)
+            for (Entry& entry : mData)
             {
                 f(entry.entity, entry.instance);
-            });
+            }
         }
     private:
         Component(const Component&) = delete;
         Component& operator=(const Component&) = delete;
 
+        static const unsigned InvalidSlot = ~0u;
+
+        unsigned findSlot(const Entity& entity) const
+        {
+            if (entity.index >= mSparse.size()) { return InvalidSlot; }
+            unsigned slot = mSparse[entity.index];
+            if (slot == InvalidSlot || mData[slot].entity.generation != entity.generation) { return InvalidSlot; }
+            return slot;
+        }
+
         std::vector<Entry> mData;
-        std::map<Entity, unsigned> mMap;
+        std::vector<unsigned> mSparse;
     };
+
+    template <class Instance>
+    const unsigned Component<Instance>::InvalidSlot;
 }
 
 #endif
@@ -17,6 +17,7 @@ namespace te
         friend std::ostream& operator<<(std::ostream&, const Entity&);
     private:
         friend class EntityManager;
+        template <class Instance> friend class Component;
         unsigned index;
         unsigned generation;
     };
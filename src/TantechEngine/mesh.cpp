@@ -1,12 +1,34 @@
 #include "mesh.h"
 
+#include <algorithm>
+
 namespace te
 {
     Mesh::Mesh(const std::vector<Vertex>& vertices,
         const std::vector<GLuint>& indices,
         const std::vector<std::shared_ptr<const Texture>>& textures)
-        : mVAO(0), mVBO(0), mEBO(0), mElementCount(indices.size()), mTextures(textures)
+        : mVAO(0), mVBO(0), mEBO(0), mElementCount(indices.size()), mBounds(), mTextures(textures)
     {
+        if (!vertices.empty()) {
+            const Vertex& first = vertices.front();
+            mBounds.position = { first.position.x, first.position.y, first.position.x, first.position.y };
+            mBounds.texCoords = { first.texCoords.s, first.texCoords.t, first.texCoords.s, first.texCoords.t };
+        }
+        std::for_each(std::begin(vertices), std::end(vertices), [this](const Vertex& vertex) {
+            mBounds.position = {
+                std::min(mBounds.position.x, vertex.position.x),
+                std::min(mBounds.position.y, vertex.position.y),
+                std::max(mBounds.position.z, vertex.position.x),
+                std::max(mBounds.position.w, vertex.position.y)
+            };
+            mBounds.texCoords = {
+                std::min(mBounds.texCoords.x, vertex.texCoords.s),
+                std::min(mBounds.texCoords.y, vertex.texCoords.t),
+                std::max(mBounds.texCoords.z, vertex.texCoords.s),
+                std::max(mBounds.texCoords.w, vertex.texCoords.t)
+            };
+        });
+
         glGenVertexArrays(1, &mVAO);
         glGenBuffers(1, &mVBO);
         glGenBuffers(1, &mEBO);
@@ -37,6 +59,7 @@ namespace te
         , mVBO(o.mVBO)
         , mEBO(o.mEBO)
         , mElementCount(o.mElementCount)
+        , mBounds(o.mBounds)
         , mTextures(std::move(o.mTextures))
     {
         o.mVAO = 0;
@@ -53,6 +76,7 @@ namespace te
         mVBO = o.mVBO;
         mEBO = o.mEBO;
         mElementCount = o.mElementCount;
+        mBounds = o.mBounds;
         mTextures = std::move(o.mTextures);
 
         o.mVAO = 0;
@@ -92,6 +116,11 @@ namespace te
         return mElementCount;
     }
 
+    const MeshBounds& Mesh::getBounds() const
+    {
+        return mBounds;
+    }
+
     std::shared_ptr<const Texture> Mesh::getTexture(unsigned i) const
     {
         return mTextures.at(i);
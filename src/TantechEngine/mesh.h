@@ -23,6 +23,13 @@ namespace te
         } texCoords;
     };
 
+    // The rect a mesh covers and the part of its texture it shows, each as
+    // (left, top, right, bottom). A sprite is exactly this quad.
+    struct MeshBounds {
+        glm::vec4 position;
+        glm::vec4 texCoords;
+    };
+
     class Mesh {
     public:
         Mesh(const std::vector<Vertex>& vertices,
@@ -36,6 +43,7 @@ namespace te
         GLuint getVBO() const;
         GLuint getEBO() const;
         GLsizei getElementCount() const;
+        const MeshBounds& getBounds() const;
         std::shared_ptr<const Texture> getTexture(unsigned i) const;
 
     private:
@@ -43,6 +51,7 @@ namespace te
 
         GLuint mVAO, mVBO, mEBO;
         GLsizei mElementCount;
+        MeshBounds mBounds;
         std::vector<std::shared_ptr<const Texture>> mTextures;
 
         Mesh(const Mesh&) = delete;
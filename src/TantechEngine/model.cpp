@@ -16,4 +16,9 @@ namespace te
             shader.draw(view, *pMesh);
         });
     }
+
+    const std::vector<std::shared_ptr<const Mesh>>& Model::getMeshes() const
+    {
+        return mMeshes;
+    }
 }
@@ -17,6 +17,7 @@ namespace te
         Model(std::vector<std::shared_ptr<const Mesh>>&& meshes);
 
         void draw(const Shader& shader, const glm::mat4& modelview) const;
+        const std::vector<std::shared_ptr<const Mesh>>& getMeshes() const;
     private:
         std::vector<std::shared_ptr<const Mesh>> mMeshes;
     };
@@ -20,38 +20,43 @@ namespace te
         , mGravityAcceleration(0, gravityAcceleration)
     {}
 
+    // Each contact takes the motion into one face away, so a box driven into
+    // a corner is done after a sweep per axis and one to confirm.
+    static const unsigned MaxSweeps = 3;
+
     void PlatformerPhysicsSystem::update(float dt, float padding)
     {
+        mpTransform->updateWorldTransforms();
         mpPhysics->forEach([dt, padding, this](const Entity& entity, PhysicsInstance& instance)
         {
             instance.velocity += dt * mGravityAcceleration;
-            glm::vec3 directionVector(dt * glm::vec3(instance.velocity.x, instance.velocity.y, 0));
-            mpTransform->setLocalTransform(
-                entity,
-                glm::translate(mpTransform->getLocalTransform(entity), directionVector));
+            glm::vec2 displacement = dt * instance.velocity;
+            BoundingBox bb = mpBoundingBox->getBoundingBox(entity);
+            glm::vec2 moved(0.f);
 
-            while (mpTiledMap->getIntersections(mpBoundingBox->getBoundingBox(entity), mIntersections).size() > 0)
+            for (unsigned i = 0; i < MaxSweeps && displacement != glm::vec2(0.f); ++i)
             {
-                instance.velocity.y = 0;
-                BoundingBox& intersection = mIntersections[0];
-                float translateX = 0, translateY = 0;
-                if (intersection.w < intersection.h)
+                TileSweep sweep = mpTiledMap->sweep(bb, displacement);
+                glm::vec2 step = sweep.time * displacement;
+                if (sweep.hit)
                 {
-                    translateX = directionVector.x > 0 ?
-                        -intersection.w - padding: // padding prevents floating point errors
-                        intersection.w + padding;
+                    step += padding * sweep.normal; // padding prevents floating point errors
+                    displacement *= 1.f - sweep.time;
+                    displacement -= glm::dot(displacement, sweep.normal) * sweep.normal;
+                    instance.velocity -= glm::dot(instance.velocity, sweep.normal) * sweep.normal;
                 }
                 else
                 {
-                    translateY = directionVector.y > 0 ?
-                        -intersection.h - padding :
-                        intersection.h + padding;
+                    displacement = glm::vec2(0.f);
                 }
-                mpTransform->setLocalTransform(
-                    entity,
-                    glm::translate(mpTransform->getLocalTransform(entity), glm::vec3(translateX, translateY, 0)));
-                mIntersections.clear();
+                bb.x += step.x;
+                bb.y += step.y;
+                moved += step;
             }
+
+            mpTransform->setLocalTransform(
+                entity,
+                glm::translate(mpTransform->getLocalTransform(entity), glm::vec3(moved, 0)));
         });
     }
 }
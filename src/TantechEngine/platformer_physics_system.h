@@ -22,6 +22,7 @@ namespace te
             std::shared_ptr<TiledMap> pTiledMap,
             float gravityAcceleration);
 
+        // Sweeps each box through the map, sliding along what it hits.
         void update(float dt, float padding = 0.001);
 
     private:
@@ -30,7 +31,6 @@ namespace te
         std::shared_ptr<BoundingBoxComponent> mpBoundingBox;
         std::shared_ptr<TiledMap> mpTiledMap;
         glm::vec2 mGravityAcceleration;
-        std::vector<BoundingBox> mIntersections;
     };
 }
 
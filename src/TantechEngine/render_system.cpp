@@ -5,6 +5,7 @@
 #include "shader.h"
 #include "texture.h"
 #include "model.h"
+#include "sprite_batch.h"
 
 #include <glm/gtc/type_ptr.hpp>
 
@@ -15,10 +16,16 @@ namespace te
         std::shared_ptr<const Shader> pShader)
         : System(ecs)
         , mpShader(pShader)
+        , mpSpriteBatch(new SpriteBatch())
     {}
 
+    RenderSystem::~RenderSystem() {}
+
     void RenderSystem::update(float dt) const
     {
+        // Settles everything commands moved this frame before it is drawn.
+        get<TransformComponent>().updateWorldTransforms();
+
         get<AnimationComponent>().forEach([dt](const Entity& entity, AnimationInstance& instance) {
             // Frozen animations require no update
             if (instance.currAnimation->frozen) { return; }
@@ -36,8 +43,14 @@ namespace te
 
     void RenderSystem::draw(const glm::mat4& viewTransform) const
     {
+        const TransformComponent& transform = get<TransformComponent>();
         get<AnimationComponent>().forEach([&, this](const Entity& entity, AnimationInstance& instance) {
-            instance.currAnimation->frames[instance.currFrameIndex].model->draw(*mpShader, viewTransform * get<TransformComponent>().getWorldTransform(entity));
+            glm::mat4 modelView = viewTransform * transform.getWorldTransform(entity);
+            const Model& model = *instance.currAnimation->frames[instance.currFrameIndex].model;
+            for (const std::shared_ptr<const Mesh>& pMesh : model.getMeshes()) {
+                mpSpriteBatch->add(*pMesh, modelView);
+            }
         });
+        mpSpriteBatch->flush(mpShader->getProjection());
     }
 }
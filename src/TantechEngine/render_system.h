@@ -13,6 +13,7 @@ namespace te
     class SimpleRenderComponent;
     class AnimationComponent;
     class TransformComponent;
+    class SpriteBatch;
 
     class RenderSystem : public System
     {
@@ -20,12 +21,15 @@ namespace te
         RenderSystem(
             const ECS& ecs,
             std::shared_ptr<const Shader> pShader);
+        ~RenderSystem();
 
         void update(float dt) const;
+        // Draws the current frame of every animation, batched by texture.
         void draw(const glm::mat4& viewTransform = glm::mat4()) const;
 
     private:
         std::shared_ptr<const Shader> mpShader;
+        std::unique_ptr<SpriteBatch> mpSpriteBatch;
     };
 }
 
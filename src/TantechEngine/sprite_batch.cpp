@@ -0,0 +1,142 @@
+#include "sprite_batch.h"
+#include "shader.h"
+#include "mesh.h"
+#include "texture.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace te
+{
+    SpriteBatch::SpriteBatch()
+        : mProgram(loadProgram("assets/shaders/sprite.glvs", "assets/shaders/basic.glfs"))
+        , mProjectionLocation(glGetUniformLocation(mProgram, "te_ProjectionMatrix"))
+        , mVAO(0)
+        , mQuadVBO(0)
+        , mEBO(0)
+        , mInstanceVBO(0)
+        , mInstanceCapacity(0)
+        , mInstances()
+        , mDrawCallCount(0)
+        , mInstanceCount(0)
+    {
+        if (mProjectionLocation == -1) {
+            glDeleteProgram(mProgram);
+            throw std::runtime_error("te_ProjectionMatrix: not a valid program variable.");
+        }
+
+        const GLfloat corners[] = { 0.f, 0.f, 1.f, 0.f, 1.f, 1.f, 0.f, 1.f };
+        const GLuint indices[] = { 0, 1, 2, 0, 2, 3 };
+
+        glGenVertexArrays(1, &mVAO);
+        glGenBuffers(1, &mQuadVBO);
+        glGenBuffers(1, &mEBO);
+        glGenBuffers(1, &mInstanceVBO);
+
+        glBindVertexArray(mVAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, mQuadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+        // Bounds, texture bounds and the four columns of the modelview,
+        // advancing once per instance.
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+        for (GLuint location = 1; location <= 6; ++location) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        setInstanceOffset(0);
+
+        glBindVertexArray(0);
+    }
+
+    SpriteBatch::~SpriteBatch()
+    {
+        glDeleteBuffers(1, &mInstanceVBO);
+        glDeleteBuffers(1, &mEBO);
+        glDeleteBuffers(1, &mQuadVBO);
+        glDeleteVertexArrays(1, &mVAO);
+        glDeleteProgram(mProgram);
+    }
+
+    void SpriteBatch::add(const Mesh& mesh, const glm::mat4& modelView)
+    {
+        const MeshBounds& bounds = mesh.getBounds();
+        mInstances.push_back({ bounds.position, bounds.texCoords, modelView, mesh.getTexture(0)->getID() });
+    }
+
+    void SpriteBatch::flush(const glm::mat4& projection)
+    {
+        mDrawCallCount = 0;
+        mInstanceCount = mInstances.size();
+        if (mInstances.empty()) { return; }
+
+        // Instances of a texture become one contiguous run, in the order
+        // they were added.
+        std::stable_sort(std::begin(mInstances), std::end(mInstances), [](const Instance& lhs, const Instance& rhs) {
+            return lhs.texture < rhs.texture;
+        });
+
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+        if (mInstances.size() > mInstanceCapacity) {
+            mInstanceCapacity = std::max(mInstances.size(), 2 * mInstanceCapacity);
+        }
+        // Orphans last frame's storage rather than waiting on draws from it.
+        glBufferData(GL_ARRAY_BUFFER, mInstanceCapacity * sizeof(Instance), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mInstances.size() * sizeof(Instance), mInstances.data());
+
+        glUseProgram(mProgram);
+        glUniformMatrix4fv(mProjectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(mVAO);
+
+        for (std::size_t first = 0; first < mInstances.size();) {
+            GLuint texture = mInstances[first].texture;
+            std::size_t last = first + 1;
+            while (last < mInstances.size() && mInstances[last].texture == texture) { ++last; }
+
+            setInstanceOffset(first);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, (GLsizei)(last - first));
+            ++mDrawCallCount;
+            first = last;
+        }
+
+        glBindVertexArray(0);
+        glUseProgram(0);
+
+        mInstances.clear();
+    }
+
+    unsigned SpriteBatch::getDrawCallCount() const
+    {
+        return mDrawCallCount;
+    }
+
+    unsigned SpriteBatch::getInstanceCount() const
+    {
+        return mInstanceCount;
+    }
+
+    // GL 3.3 has no base instance, so each run is drawn from instance 0 with
+    // the instance attributes pointed at its start. Expects the instance
+    // buffer bound to GL_ARRAY_BUFFER.
+    void SpriteBatch::setInstanceOffset(std::size_t first) const
+    {
+        const GLsizei stride = sizeof(Instance);
+        const char* base = (const char*)0 + first * sizeof(Instance);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, base + offsetof(Instance, position));
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, base + offsetof(Instance, texCoords));
+        for (GLuint column = 0; column < 4; ++column) {
+            glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, stride,
+                                  base + offsetof(Instance, modelView) + column * sizeof(glm::vec4));
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef TE_SPRITE_BATCH_H
+#define TE_SPRITE_BATCH_H
+
+#include "gl.h"
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace te
+{
+    class Mesh;
+
+    // Collects sprites over a frame and draws them as instances of a single
+    // unit quad, with one draw call per texture. Each instance carries the
+    // bounds of its mesh and its modelview, so any number of frames cut from
+    // one tileset share a call.
+    class SpriteBatch
+    {
+    public:
+        SpriteBatch();
+        ~SpriteBatch();
+
+        // Queues a quad mesh, as made by MeshManager.
+        void add(const Mesh& mesh, const glm::mat4& modelView);
+        // Draws and clears everything queued since the last flush.
+        void flush(const glm::mat4& projection);
+
+        // Of the last flush.
+        unsigned getDrawCallCount() const;
+        unsigned getInstanceCount() const;
+
+    private:
+        SpriteBatch(const SpriteBatch&) = delete;
+        SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+        struct Instance
+        {
+            glm::vec4 position;
+            glm::vec4 texCoords;
+            glm::mat4 modelView;
+            GLuint texture;
+        };
+
+        void setInstanceOffset(std::size_t first) const;
+
+        GLuint mProgram;
+        GLint mProjectionLocation;
+        GLuint mVAO;
+        GLuint mQuadVBO;
+        GLuint mEBO;
+        GLuint mInstanceVBO;
+        std::size_t mInstanceCapacity;
+        std::vector<Instance> mInstances;
+        unsigned mDrawCallCount;
+        unsigned mInstanceCount;
+    };
+}
+
+#endif
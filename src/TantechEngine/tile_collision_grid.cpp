@@ -0,0 +1,259 @@
+#include "tile_collision_grid.h"
+#include "auxiliary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace te
+{
+    TileCollisionGrid::TileCollisionGrid()
+        : mWidth(0)
+        , mHeight(0)
+        , mSolid()
+        , mRectIndices()
+        , mRects()
+        , mRectGids()
+    {}
+
+    TileCollisionGrid::TileCollisionGrid(const TMX::Layer& layer, const std::map<unsigned, BoundingBox>& collisionRects)
+        : mWidth(layer.width)
+        , mHeight(layer.height)
+        , mSolid((layer.width * layer.height + 31) / 32, 0)
+        , mRectIndices(layer.width * layer.height, 0)
+        , mRects()
+        , mRectGids()
+    {
+        std::map<unsigned, std::uint16_t> rectIndices;
+        std::size_t count = std::min<std::size_t>(layer.data.size(), mRectIndices.size());
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            unsigned gid = layer.data[i];
+            if (gid == 0) { continue; }
+            auto rectIt = collisionRects.find(gid);
+            if (rectIt == collisionRects.end()) { continue; }
+
+            auto indexIt = rectIndices.find(gid);
+            if (indexIt == rectIndices.end())
+            {
+                indexIt = rectIndices.insert({ gid, getRectIndex(gid, rectIt->second) }).first;
+            }
+            mSolid[i / 32] |= 1u << (i % 32);
+            mRectIndices[i] = indexIt->second;
+        }
+    }
+
+    void TileCollisionGrid::setTile(unsigned x, unsigned y, unsigned gid, const std::map<unsigned, BoundingBox>& collisionRects)
+    {
+        if (x >= mWidth || y >= mHeight)
+        {
+            throw std::out_of_range("TileCollisionGrid::setTile: Tile is outside the grid.");
+        }
+        unsigned i = y * mWidth + x;
+        auto rectIt = collisionRects.find(gid);
+        if (gid == 0 || rectIt == collisionRects.end())
+        {
+            mSolid[i / 32] &= ~(1u << (i % 32));
+            mRectIndices[i] = 0;
+            return;
+        }
+        mSolid[i / 32] |= 1u << (i % 32);
+        mRectIndices[i] = getRectIndex(gid, rectIt->second);
+    }
+
+    // Adds the rect for a gid not seen before. Only edits search, and there
+    // are few distinct gids.
+    std::uint16_t TileCollisionGrid::getRectIndex(unsigned gid, const BoundingBox& rect)
+    {
+        auto it = std::find(std::begin(mRectGids), std::end(mRectGids), gid);
+        if (it != std::end(mRectGids)) { return (std::uint16_t)(it - std::begin(mRectGids)); }
+        if (mRects.size() > std::numeric_limits<std::uint16_t>::max())
+        {
+            throw std::runtime_error("TileCollisionGrid: Too many collision rects.");
+        }
+        mRects.push_back(rect);
+        mRectGids.push_back(gid);
+        return (std::uint16_t)(mRects.size() - 1);
+    }
+
+    bool TileCollisionGrid::isSolid(int x, int y) const
+    {
+        if (x < 0 || (unsigned)x >= mWidth || y < 0 || (unsigned)y >= mHeight) { return false; }
+        unsigned i = y * mWidth + x;
+        return (mSolid[i / 32] >> (i % 32) & 1u) != 0;
+    }
+
+    BoundingBox TileCollisionGrid::getRect(int x, int y) const
+    {
+        const BoundingBox& rect = mRects[mRectIndices[y * mWidth + x]];
+        return { x + rect.x, y + rect.y, rect.w, rect.h };
+    }
+
+    // The cells a box covers, clamped to the grid. A box edge lying on a
+    // cell boundary still counts the cell past it, as rects may start there.
+    static void getCellRange(float min, float max, unsigned size, int& first, int& last)
+    {
+        first = std::max((int)std::floor(min), 0);
+        last = std::min((int)std::floor(max), (int)size - 1);
+    }
+
+    bool TileCollisionGrid::checkCollision(const BoundingBox& unitBB) const
+    {
+        int x0, x1, y0, y1;
+        getCellRange(unitBB.x, unitBB.x + unitBB.w, mWidth, x0, x1);
+        getCellRange(unitBB.y, unitBB.y + unitBB.h, mHeight, y0, y1);
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                if (isSolid(x, y) && te::checkCollision(unitBB, getRect(x, y))) { return true; }
+            }
+        }
+        return false;
+    }
+
+    void TileCollisionGrid::getIntersections(const BoundingBox& unitBB, std::vector<BoundingBox>& intersections) const
+    {
+        int x0, x1, y0, y1;
+        getCellRange(unitBB.x, unitBB.x + unitBB.w, mWidth, x0, x1);
+        getCellRange(unitBB.y, unitBB.y + unitBB.h, mHeight, y0, y1);
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                if (!isSolid(x, y)) { continue; }
+                BoundingBox rect = getRect(x, y);
+                if (te::checkCollision(unitBB, rect))
+                {
+                    intersections.push_back(te::getIntersection(unitBB, rect));
+                }
+            }
+        }
+    }
+
+    // Slab test of a moving box against a resting rect. Touching is not
+    // overlapping, and a rect the box already overlaps is never hit.
+    static bool sweepRect(const BoundingBox& box, const glm::vec2& displacement, const BoundingBox& rect, float& time, glm::vec2& normal)
+    {
+        const float boxMin[2] = { box.x, box.y };
+        const float boxMax[2] = { box.x + box.w, box.y + box.h };
+        const float rectMin[2] = { rect.x, rect.y };
+        const float rectMax[2] = { rect.x + rect.w, rect.y + rect.h };
+        const float delta[2] = { displacement.x, displacement.y };
+        const float infinity = std::numeric_limits<float>::infinity();
+
+        float entry[2], exit[2];
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            if (delta[axis] == 0.f)
+            {
+                if (boxMax[axis] <= rectMin[axis] || boxMin[axis] >= rectMax[axis]) { return false; }
+                entry[axis] = -infinity;
+                exit[axis] = infinity;
+            }
+            else if (delta[axis] > 0.f)
+            {
+                entry[axis] = (rectMin[axis] - boxMax[axis]) / delta[axis];
+                exit[axis] = (rectMax[axis] - boxMin[axis]) / delta[axis];
+            }
+            else
+            {
+                entry[axis] = (rectMax[axis] - boxMin[axis]) / delta[axis];
+                exit[axis] = (rectMin[axis] - boxMax[axis]) / delta[axis];
+            }
+        }
+
+        float entryTime = std::max(entry[0], entry[1]);
+        float exitTime = std::min(exit[0], exit[1]);
+        if (entryTime >= exitTime || entryTime < 0.f || entryTime > 1.f) { return false; }
+
+        time = entryTime;
+        // On a tie, as at a corner, land on the floor rather than the wall.
+        normal = entry[0] > entry[1] ?
+            glm::vec2(delta[0] > 0.f ? -1.f : 1.f, 0.f) :
+            glm::vec2(0.f, delta[1] > 0.f ? -1.f : 1.f);
+        return true;
+    }
+
+    void TileCollisionGrid::sweepCells(const BoundingBox& unitBB, const glm::vec2& displacement,
+                                       int x0, int x1, int y0, int y1, TileSweep& result) const
+    {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, (int)mWidth - 1);
+        y1 = std::min(y1, (int)mHeight - 1);
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                float time;
+                glm::vec2 normal;
+                if (!isSolid(x, y) || !sweepRect(unitBB, displacement, getRect(x, y), time, normal)) { continue; }
+                // Ties go to the floor here too, whichever cell came first.
+                if (!result.hit || time < result.time ||
+                    (time == result.time && normal.y != 0.f && result.normal.y == 0.f))
+                {
+                    result = { true, time, normal };
+                }
+            }
+        }
+    }
+
+    TileSweep TileCollisionGrid::sweep(const BoundingBox& unitBB, const glm::vec2& displacement) const
+    {
+        TileSweep result{ false, 1.f, glm::vec2(0.f) };
+        if (mWidth == 0 || mHeight == 0) { return result; }
+
+        const float left = unitBB.x, right = unitBB.x + unitBB.w;
+        const float top = unitBB.y, bottom = unitBB.y + unitBB.h;
+        const float infinity = std::numeric_limits<float>::infinity();
+
+        // A sub-tile rect may lie ahead of the box within the cells it
+        // starts in.
+        sweepCells(unitBB, displacement,
+                   (int)std::floor(left), (int)std::floor(right),
+                   (int)std::floor(top), (int)std::floor(bottom), result);
+
+        // Then each column and row the leading faces enter, in the order
+        // they enter them, tested across the span the box covers then.
+        int stepX = displacement.x > 0.f ? 1 : displacement.x < 0.f ? -1 : 0;
+        int stepY = displacement.y > 0.f ? 1 : displacement.y < 0.f ? -1 : 0;
+        int column = stepX > 0 ? (int)std::floor(right) : (int)std::floor(left);
+        int row = stepY > 0 ? (int)std::floor(bottom) : (int)std::floor(top);
+        float nextX = stepX > 0 ? (column + 1 - right) / displacement.x :
+                      stepX < 0 ? (column - left) / displacement.x : infinity;
+        float nextY = stepY > 0 ? (row + 1 - bottom) / displacement.y :
+                      stepY < 0 ? (row - top) / displacement.y : infinity;
+        float deltaX = stepX != 0 ? 1.f / std::abs(displacement.x) : infinity;
+        float deltaY = stepY != 0 ? 1.f / std::abs(displacement.y) : infinity;
+
+        while (true)
+        {
+            float time = std::min(nextX, nextY);
+            // Nothing entered later can be hit sooner, and past the edge
+            // of the grid in the direction of travel there is nothing.
+            if (time > 1.f || (result.hit && time > result.time)) { break; }
+
+            if (nextX <= nextY)
+            {
+                column += stepX;
+                if ((stepX < 0 && column < 0) || (stepX > 0 && column >= (int)mWidth)) { nextX = infinity; continue; }
+                float y = top + time * displacement.y;
+                sweepCells(unitBB, displacement, column, column,
+                           (int)std::floor(y), (int)std::floor(y + unitBB.h), result);
+                nextX += deltaX;
+            }
+            else
+            {
+                row += stepY;
+                if ((stepY < 0 && row < 0) || (stepY > 0 && row >= (int)mHeight)) { nextY = infinity; continue; }
+                float x = left + time * displacement.x;
+                sweepCells(unitBB, displacement, (int)std::floor(x), (int)std::floor(x + unitBB.w),
+                           row, row, result);
+                nextY += deltaY;
+            }
+        }
+        return result;
+    }
+}
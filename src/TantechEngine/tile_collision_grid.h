@@ -0,0 +1,66 @@
+#ifndef TE_TILE_COLLISION_GRID_H
+#define TE_TILE_COLLISION_GRID_H
+
+#include "tmx.h"
+#include "bounding_box_component.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace te
+{
+    struct TileSweep
+    {
+        bool hit;
+        // Fraction of the displacement moved before contact, 1 without a hit.
+        float time;
+        // Face of the tile that was hit, pointing back at the box.
+        glm::vec2 normal;
+    };
+
+    // The collision rects of one tile layer, in tile units: cell (x, y)
+    // spans [x, x + 1) x [y, y + 1). A bit per cell says whether it is
+    // solid, and solid cells index a table of sub-tile rects shared by every
+    // cell with the same gid.
+    class TileCollisionGrid
+    {
+    public:
+        TileCollisionGrid();
+        // Rects are keyed by gid, relative to the tile, in tile units.
+        TileCollisionGrid(const TMX::Layer& layer, const std::map<unsigned, BoundingBox>& collisionRects);
+
+        // Takes the gid's rect from the same table as the constructor.
+        void setTile(unsigned x, unsigned y, unsigned gid, const std::map<unsigned, BoundingBox>& collisionRects);
+
+        bool isSolid(int x, int y) const;
+        // The rect of a solid cell, translated to the cell.
+        BoundingBox getRect(int x, int y) const;
+
+        bool checkCollision(const BoundingBox& unitBB) const;
+        void getIntersections(const BoundingBox& unitBB, std::vector<BoundingBox>& intersections) const;
+
+        // Moves unitBB by displacement and stops at the first rect it
+        // touches. Cells are visited in the order the box's leading faces
+        // reach them, so a long move cannot skip a thin wall. Rects the box
+        // already overlaps are ignored so that it can move out of them.
+        TileSweep sweep(const BoundingBox& unitBB, const glm::vec2& displacement) const;
+
+    private:
+        std::uint16_t getRectIndex(unsigned gid, const BoundingBox& rect);
+        void sweepCells(const BoundingBox& unitBB, const glm::vec2& displacement,
+                        int x0, int x1, int y0, int y1, TileSweep& result) const;
+
+        unsigned mWidth;
+        unsigned mHeight;
+        std::vector<std::uint32_t> mSolid;
+        std::vector<std::uint16_t> mRectIndices;
+        std::vector<BoundingBox> mRects;
+        // The gid each rect came from.
+        std::vector<unsigned> mRectGids;
+    };
+}
+
+#endif
@@ -0,0 +1,200 @@
+#include "tile_index_renderer.h"
+#include "shader.h"
+#include "texture.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <stdexcept>
+
+namespace te
+{
+    static GLint getUniformLocation(GLuint program, const char* name)
+    {
+        GLint location = glGetUniformLocation(program, name);
+        if (location == -1) {
+            throw std::runtime_error{ std::string(name) + ": not a valid program variable." };
+        }
+        return location;
+    }
+
+    TileIndexRenderer::TileIndexRenderer(const TMX& tmx, const std::vector<std::shared_ptr<const Texture>>& tilesetTextures)
+        : mProgram(loadProgram("assets/shaders/tile_index.glvs", "assets/shaders/tile_index.glfs"))
+        , mProjectionLocation(-1)
+        , mModelViewLocation(-1)
+        , mLayerSizeLocation(-1)
+        , mDepthLocation(-1)
+        , mFirstGidLocation(-1)
+        , mEndGidLocation(-1)
+        , mColumnsLocation(-1)
+        , mTileSizeLocation(-1)
+        , mTileStrideLocation(-1)
+        , mMarginLocation(-1)
+        , mTextureSizeLocation(-1)
+        , mVAO(0)
+        , mVBO(0)
+        , mEBO(0)
+        , mTilesets()
+        , mLayers()
+    {
+        try {
+            mProjectionLocation = getUniformLocation(mProgram, "te_ProjectionMatrix");
+            mModelViewLocation = getUniformLocation(mProgram, "te_ModelViewMatrix");
+            mLayerSizeLocation = getUniformLocation(mProgram, "te_LayerSize");
+            mDepthLocation = getUniformLocation(mProgram, "te_Depth");
+            mFirstGidLocation = getUniformLocation(mProgram, "te_FirstGid");
+            mEndGidLocation = getUniformLocation(mProgram, "te_EndGid");
+            mColumnsLocation = getUniformLocation(mProgram, "te_Columns");
+            mTileSizeLocation = getUniformLocation(mProgram, "te_TileSize");
+            mTileStrideLocation = getUniformLocation(mProgram, "te_TileStride");
+            mMarginLocation = getUniformLocation(mProgram, "te_Margin");
+            mTextureSizeLocation = getUniformLocation(mProgram, "te_TextureSize");
+            glUseProgram(mProgram);
+            glUniform1i(getUniformLocation(mProgram, "te_Tileset"), 0);
+            glUniform1i(getUniformLocation(mProgram, "te_Gids"), 1);
+            glUseProgram(0);
+        } catch (const std::runtime_error&) {
+            glDeleteProgram(mProgram);
+            throw;
+        }
+
+        if (tilesetTextures.size() != tmx.tilesets.size()) {
+            glDeleteProgram(mProgram);
+            throw std::runtime_error{ "TileIndexRenderer ctor: requires a texture per tileset." };
+        }
+        for (auto it = tmx.tilesets.begin(); it != tmx.tilesets.end(); ++it) {
+            const TMX::Tileset& tileset = *it;
+            std::shared_ptr<const Texture> pTexture = tilesetTextures.at(it - tmx.tilesets.begin());
+            mTilesets.push_back(Tileset{
+                tileset.firstgid,
+                tileset.firstgid + tileset.tilecount,
+                (tileset.imagewidth + tileset.spacing) / (tileset.tilewidth + tileset.spacing),
+                { (float)tileset.tilewidth, (float)tileset.tileheight },
+                { (float)(tileset.tilewidth + tileset.spacing), (float)(tileset.tileheight + tileset.spacing) },
+                { (float)tileset.margin, (float)tileset.margin },
+                { (float)pTexture->getTexWidth(), (float)pTexture->getTexHeight() },
+                pTexture
+            });
+        }
+
+        for (const TMX::Layer& tmxLayer : tmx.layers) {
+            Layer layer{ 0, tmxLayer.width, tmxLayer.height, std::vector<bool>(mTilesets.size(), false) };
+            if (tmxLayer.type == TMX::Layer::Type::TILELAYER) {
+                std::vector<GLuint> gids(tmxLayer.data.begin(), tmxLayer.data.end());
+                gids.resize(layer.width * layer.height, 0);
+                for (GLuint gid : gids) {
+                    if (gid != 0) { layer.usesTileset[getTilesetIndex(gid)] = true; }
+                }
+
+                glGenTextures(1, &layer.texture);
+                glBindTexture(GL_TEXTURE_2D, layer.texture);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, layer.width, layer.height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, gids.data());
+                // Integer textures cannot be filtered.
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glBindTexture(GL_TEXTURE_2D, 0);
+            }
+            mLayers.push_back(std::move(layer));
+        }
+
+        const GLfloat corners[] = { 0.f, 0.f, 1.f, 0.f, 1.f, 1.f, 0.f, 1.f };
+        const GLuint indices[] = { 0, 1, 2, 0, 2, 3 };
+
+        glGenVertexArrays(1, &mVAO);
+        glGenBuffers(1, &mVBO);
+        glGenBuffers(1, &mEBO);
+
+        glBindVertexArray(mVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
+        glBindVertexArray(0);
+    }
+
+    TileIndexRenderer::~TileIndexRenderer()
+    {
+        for (const Layer& layer : mLayers) {
+            glDeleteTextures(1, &layer.texture);
+        }
+        glDeleteBuffers(1, &mEBO);
+        glDeleteBuffers(1, &mVBO);
+        glDeleteVertexArrays(1, &mVAO);
+        glDeleteProgram(mProgram);
+    }
+
+    void TileIndexRenderer::draw(const glm::mat4& projection, const glm::mat4& modelView) const
+    {
+        glUseProgram(mProgram);
+        glUniformMatrix4fv(mProjectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+        glUniformMatrix4fv(mModelViewLocation, 1, GL_FALSE, glm::value_ptr(modelView));
+        glBindVertexArray(mVAO);
+
+        for (auto layerIt = mLayers.begin(); layerIt != mLayers.end(); ++layerIt) {
+            if (layerIt->texture == 0) { continue; }
+
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, layerIt->texture);
+            glUniform2f(mLayerSizeLocation, (GLfloat)layerIt->width, (GLfloat)layerIt->height);
+            // Layers stack in z as in the mesh path.
+            glUniform1f(mDepthLocation, (GLfloat)(layerIt - mLayers.begin()));
+
+            glActiveTexture(GL_TEXTURE0);
+            for (auto it = mTilesets.begin(); it != mTilesets.end(); ++it) {
+                if (!layerIt->usesTileset[it - mTilesets.begin()]) { continue; }
+
+                glBindTexture(GL_TEXTURE_2D, it->pTexture->getID());
+                glUniform1ui(mFirstGidLocation, it->firstgid);
+                glUniform1ui(mEndGidLocation, it->endgid);
+                glUniform1ui(mColumnsLocation, it->columns);
+                glUniform2fv(mTileSizeLocation, 1, glm::value_ptr(it->tileSize));
+                glUniform2fv(mTileStrideLocation, 1, glm::value_ptr(it->tileStride));
+                glUniform2fv(mMarginLocation, 1, glm::value_ptr(it->margin));
+                glUniform2fv(mTextureSizeLocation, 1, glm::value_ptr(it->textureSize));
+                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            }
+        }
+
+        glBindVertexArray(0);
+        glUseProgram(0);
+    }
+
+    void TileIndexRenderer::setTile(unsigned layerIndex, unsigned x, unsigned y, unsigned gid)
+    {
+        Layer& layer = mLayers.at(layerIndex);
+        if (layer.texture == 0) {
+            throw std::runtime_error{ "TileIndexRenderer::setTile: layer is not a tile layer." };
+        }
+        if (x >= layer.width || y >= layer.height) {
+            throw std::out_of_range{ "TileIndexRenderer::setTile: tile is outside the layer." };
+        }
+        if (gid != 0) { layer.usesTileset[getTilesetIndex(gid)] = true; }
+
+        GLuint texel = gid;
+        glBindTexture(GL_TEXTURE_2D, layer.texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, &texel);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    std::size_t TileIndexRenderer::getTextureSize() const
+    {
+        std::size_t size = 0;
+        for (const Layer& layer : mLayers) {
+            if (layer.texture != 0) { size += layer.width * layer.height * sizeof(GLuint); }
+        }
+        return size;
+    }
+
+    unsigned TileIndexRenderer::getTilesetIndex(unsigned gid) const
+    {
+        for (auto it = mTilesets.begin(); it != mTilesets.end(); ++it) {
+            if (gid >= it->firstgid && gid < it->endgid) {
+                return it - mTilesets.begin();
+            }
+        }
+        throw std::out_of_range("No tileset for given tile ID.");
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef TE_TILE_INDEX_RENDERER_H
+#define TE_TILE_INDEX_RENDERER_H
+
+#include "tmx.h"
+
+#include "gl.h"
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace te
+{
+    class Texture;
+
+    // Keeps each tile layer on the GPU as an integer texture of gids, one
+    // texel per cell, and draws a layer as one quad per tileset it uses. The
+    // fragment shader looks each pixel's gid up and samples the tileset.
+    // A layer costs 4 bytes a cell however full it is, and editing a tile
+    // uploads a single texel.
+    class TileIndexRenderer
+    {
+    public:
+        // One texture per tileset, in TMX order.
+        TileIndexRenderer(const TMX& tmx, const std::vector<std::shared_ptr<const Texture>>& tilesetTextures);
+        ~TileIndexRenderer();
+
+        void draw(const glm::mat4& projection, const glm::mat4& modelView) const;
+        void setTile(unsigned layerIndex, unsigned x, unsigned y, unsigned gid);
+
+        // Bytes of gid textures on the GPU.
+        std::size_t getTextureSize() const;
+
+    private:
+        TileIndexRenderer(const TileIndexRenderer&) = delete;
+        TileIndexRenderer& operator=(const TileIndexRenderer&) = delete;
+
+        struct Tileset
+        {
+            GLuint firstgid;
+            GLuint endgid;
+            GLuint columns;
+            glm::vec2 tileSize;
+            glm::vec2 tileStride;
+            glm::vec2 margin;
+            glm::vec2 textureSize;
+            std::shared_ptr<const Texture> pTexture;
+        };
+
+        // Object layers keep texture 0 and are skipped.
+        struct Layer
+        {
+            GLuint texture;
+            unsigned width;
+            unsigned height;
+            // Whether any cell refers to each tileset.
+            std::vector<bool> usesTileset;
+        };
+
+        unsigned getTilesetIndex(unsigned gid) const;
+
+        GLuint mProgram;
+        GLint mProjectionLocation;
+        GLint mModelViewLocation;
+        GLint mLayerSizeLocation;
+        GLint mDepthLocation;
+        GLint mFirstGidLocation;
+        GLint mEndGidLocation;
+        GLint mColumnsLocation;
+        GLint mTileSizeLocation;
+        GLint mTileStrideLocation;
+        GLint mMarginLocation;
+        GLint mTextureSizeLocation;
+        GLuint mVAO;
+        GLuint mVBO;
+        GLuint mEBO;
+        std::vector<Tileset> mTilesets;
+        std::vector<Layer> mLayers;
+    };
+}
+
+#endif
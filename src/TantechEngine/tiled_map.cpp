@@ -7,6 +7,7 @@
 #include "texture.h"
 #include "texture_manager.h"
 #include "auxiliary.h"
+#include "tile_index_renderer.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/transform.hpp>
@@ -16,22 +17,30 @@
 
 namespace te
 {
-    TiledMap::TiledMap(const std::string& path, const std::string& file, std::shared_ptr<const Shader> pShader, const glm::mat4& model, TextureManager* tm)
+    TiledMap::TiledMap(const std::string& path, const std::string& file, std::shared_ptr<const Shader> pShader, const glm::mat4& model, TextureManager* tm, RenderMode mode)
         : mModelMatrix(model)
         , mpShader(pShader)
         , mpTMX(new TMX{path, file})
         , mLayers()
+        , mRenderMode(mode)
+        , mpTileIndexRenderer()
+        , mUnitMatrix()
         , mCollisionRects()
+        , mCollisionGrids()
     {
         init(*mpTMX, tm);
     }
 
-    TiledMap::TiledMap(std::shared_ptr<const TMX> pTMX, std::shared_ptr<const Shader> pShader, const glm::mat4& model, TextureManager* tm)
+    TiledMap::TiledMap(std::shared_ptr<const TMX> pTMX, std::shared_ptr<const Shader> pShader, const glm::mat4& model, TextureManager* tm, RenderMode mode)
         : mModelMatrix(model)
         , mpShader(pShader)
         , mpTMX(pTMX)
         , mLayers()
+        , mRenderMode(mode)
+        , mpTileIndexRenderer()
+        , mUnitMatrix()
         , mCollisionRects()
+        , mCollisionGrids()
     {
         init(*mpTMX, tm);
     }
@@ -53,7 +62,7 @@ namespace te
             std::for_each(std::begin(tileset.tiles), std::end(tileset.tiles), [&, this](const TMX::Tileset::Tile& tile) {
                 std::for_each(std::begin(tile.objectGroup.objects), std::end(tile.objectGroup.objects), [&, this](const TMX::Tileset::Tile::ObjectGroup::Object& object) {
                     if (object.shape == TMX::Tileset::Tile::ObjectGroup::Object::Shape::RECTANGLE) {
-                        mCollisionRects.insert(std::pair<unsigned, const BoundingBox>{
+                        mCollisionRects.insert(std::pair<unsigned, BoundingBox>{
                             tileset.firstgid + tile.id,
                             {
                                 object.x / tileset.tilewidth,
@@ -67,6 +76,20 @@ namespace te
             });
         });
 
+        mUnitMatrix = glm::scale(glm::vec3(1.f / tmx.tilewidth, 1.f / tmx.tileheight, 1.f)) * glm::inverse(mModelMatrix);
+        std::for_each(std::begin(tmx.layers), std::end(tmx.layers), [&, this](const TMX::Layer& layer) {
+            if (layer.type == TMX::Layer::Type::TILELAYER) {
+                mCollisionGrids.push_back(TileCollisionGrid{ layer, mCollisionRects });
+            } else {
+                mCollisionGrids.push_back(TileCollisionGrid{});
+            }
+        });
+
+        if (mRenderMode == RenderMode::TILE_INDEX) {
+            mpTileIndexRenderer.reset(new TileIndexRenderer{ tmx, textures });
+            return;
+        }
+
         struct ProtoMesh {
             std::vector<Vertex> vertices;
             std::vector<GLuint> indices;
@@ -155,16 +178,30 @@ namespace te
     }
 
     TiledMap::TiledMap(TiledMap&& o)
-        : mpShader(std::move(o.mpShader))
+        : mModelMatrix(o.mModelMatrix)
+        , mpShader(std::move(o.mpShader))
+        , mpTMX(std::move(o.mpTMX))
         , mLayers(std::move(o.mLayers))
+        , mRenderMode(o.mRenderMode)
+        , mpTileIndexRenderer(std::move(o.mpTileIndexRenderer))
+        , mUnitMatrix(o.mUnitMatrix)
+        , mCollisionRects(std::move(o.mCollisionRects))
+        , mCollisionGrids(std::move(o.mCollisionGrids))
     {}
 
     TiledMap& TiledMap::operator=(TiledMap&& o)
     {
         destroy();
 
+        mModelMatrix = o.mModelMatrix;
         mpShader = std::move(o.mpShader);
+        mpTMX = std::move(o.mpTMX);
         mLayers = std::move(o.mLayers);
+        mRenderMode = o.mRenderMode;
+        mpTileIndexRenderer = std::move(o.mpTileIndexRenderer);
+        mUnitMatrix = o.mUnitMatrix;
+        mCollisionRects = std::move(o.mCollisionRects);
+        mCollisionGrids = std::move(o.mCollisionGrids);
 
         return *this;
     }
@@ -177,124 +214,111 @@ namespace te
     void TiledMap::destroy()
     {
         mLayers.clear();
+        mpTileIndexRenderer.reset();
     }
 
     void TiledMap::draw(const glm::mat4& viewTransform) const
     {
+        if (mpTileIndexRenderer) {
+            mpTileIndexRenderer->draw(mpShader->getProjection(), viewTransform * mModelMatrix);
+            return;
+        }
         std::for_each(std::begin(mLayers), std::end(mLayers), [&, this](const Model& layer) {
             layer.draw(*mpShader, viewTransform * mModelMatrix);
         });
     }
 
-    static unsigned getTileData(const TMX::Layer layer, int x, int y)
+    void TiledMap::setTile(unsigned layerIndex, unsigned x, unsigned y, unsigned gid)
     {
-        int index = y * layer.width + x;
-        if (x < 0 || (unsigned)x >= layer.width || y < 0 || (unsigned)y >= layer.height || index < 0 || (unsigned)index >= layer.data.size()) {
-            return 0;
+        if (!mpTileIndexRenderer) {
+            throw std::runtime_error{ "TiledMap::setTile: requires RenderMode::TILE_INDEX." };
         }
-        return layer.data[index];
+        mpTileIndexRenderer->setTile(layerIndex, x, y, gid);
+        mCollisionGrids.at(layerIndex).setTile(x, y, gid, mCollisionRects);
     }
 
-    bool TiledMap::checkUnitCollision(const BoundingBox& unitBB, const TMX::Layer& layer) const
+    // A flipping model matrix would otherwise give a negative width or height.
+    static BoundingBox normalize(BoundingBox bb)
     {
-        for (int x = (int)unitBB.x; x < (int)(unitBB.x + unitBB.w) + 1; ++x) {
-            for (int y = (int)unitBB.y; y < (int)(unitBB.y + unitBB.h) + 1; ++y) {
-                unsigned gid = getTileData(layer, x, y);
-
-                if (gid == 0) { continue; }
-
-                auto collisionRectIt = mCollisionRects.find(gid);
-                if (collisionRectIt != mCollisionRects.end()) {
-                    bool collision = te::checkCollision(
-                        unitBB,
-                        glm::translate(glm::vec3(x, y, 0)) * collisionRectIt->second);
-                    if (collision) {
-                        return true;
-                    }
-                }
-            }
+        if (bb.w < 0) { bb.x += bb.w; bb.w = -bb.w; }
+        if (bb.h < 0) { bb.y += bb.h; bb.h = -bb.h; }
+        return bb;
+    }
+
+    BoundingBox TiledMap::toUnit(const BoundingBox& worldBB) const
+    {
+        return normalize(mUnitMatrix * worldBB);
+    }
+
+    BoundingBox TiledMap::toWorld(const BoundingBox& unitBB) const
+    {
+        return normalize(mModelMatrix * glm::scale(glm::vec3((float)mpTMX->tilewidth, (float)mpTMX->tileheight, 1.f)) * unitBB);
+    }
+
+    const TileCollisionGrid& TiledMap::getCollisionGrid(unsigned layerIndex) const
+    {
+        if (mpTMX->layers.at(layerIndex).type != TMX::Layer::Type::TILELAYER) {
+            throw std::runtime_error{ "TiledMap: layer is not a tile layer." };
         }
-        return false;
+        return mCollisionGrids.at(layerIndex);
     }
 
-    //bool TiledMap::checkCollision(const BoundingBox& worldBB) const
-    //{
-    //    BoundingBox unitBB = glm::scale(glm::vec3(1.f/mpTMX->tilewidth, 1.f/mpTMX->tileheight, 1)) *
-    //        glm::inverse(mpShader->getModel()) * worldBB;
-
-    //    bool collision = false;
-    //    for (auto it = mpTMX->layers.begin(); it != mpTMX->layers.end(); ++it) {
-    //        if (it->type != TMX::Layer::Type::TILELAYER) {
-    //            continue;
-    //        }
-    //        collision = checkUnitCollision(unitBB, *it);
-    //        if (collision) {
-    //            break;
-    //        }
-    //    };
-    //    return collision;
-    //}
-
-    //bool TiledMap::checkCollision(const BoundingBox& worldBB, unsigned layerIndex) const
-    //{
-    //    BoundingBox unitBB = glm::scale(glm::vec3(1.f/mpTMX->tilewidth, 1.f/mpTMX->tileheight, 1)) *
-    //        glm::inverse(mpShader->getModel()) * worldBB;
-
-    //    const TMX::Layer& layer = mpTMX->layers.at(layerIndex);
-    //    if (layer.type != TMX::Layer::Type::TILELAYER) {
-    //        throw std::runtime_error{ "getTileData: layer is not a tile data." };
-    //    }
-
-    //    return checkUnitCollision(unitBB, layer);
-    //}
-
-    //std::vector<BoundingBox>& TiledMap::getIntersections(const BoundingBox& worldBB, std::vector<BoundingBox>& bbs) const
-    //{
-    //    BoundingBox unitBB = glm::scale(glm::vec3(1.f/mpTMX->tilewidth, 1.f/mpTMX->tileheight, 1)) *
-    //        glm::inverse(mpShader->getModel()) * worldBB;
-
-    //    for (auto it = mpTMX->layers.begin(); it != mpTMX->layers.end(); ++it) {
-    //        if (it->type != TMX::Layer::Type::TILELAYER) {
-    //            continue;
-    //        }
-    //        getUnitIntersections(unitBB, *it, bbs);
-    //    };
-
-    //    return bbs;
-    //}
-
-    //std::vector<BoundingBox>& TiledMap::getIntersections(const BoundingBox& worldBB, unsigned layerIndex, std::vector<BoundingBox>& bbs) const
-    //{
-    //    BoundingBox unitBB = glm::scale(glm::vec3(1.f/mpTMX->tilewidth, 1.f/mpTMX->tileheight, 1)) *
-    //        glm::inverse(mpShader->getModel()) * worldBB;
-
-    //    const TMX::Layer& layer = mpTMX->layers.at(layerIndex);
-    //    if (layer.type != TMX::Layer::Type::TILELAYER) {
-    //        throw std::runtime_error{ "getTileData: layer is not a tile data." };
-    //    }
-
-    //    getUnitIntersections(unitBB, layer, bbs);
-    //    return bbs;
-    //}
-
-    //void TiledMap::getUnitIntersections(const BoundingBox& unitBB, const TMX::Layer& layer, std::vector<BoundingBox>& bbs) const
-    //{
-    //    for (int x = (int)unitBB.x; x < (int)(unitBB.x + unitBB.w) + 1; ++x) {
-    //        for (int y = (int)unitBB.y; y < (int)(unitBB.y + unitBB.h) + 1; ++y) {
-    //            unsigned gid = getTileData(layer, x, y);
-
-    //            if (gid == 0) { continue; }
-
-    //            auto collisionRectIt = mCollisionRects.find(gid);
-    //            if (collisionRectIt != mCollisionRects.end()) {
-    //                BoundingBox translatedBB = glm::translate(glm::vec3(x, y, 0)) * collisionRectIt->second;
-    //                if (te::checkCollision(unitBB, translatedBB)) {
-    //                    bbs.push_back(mpShader->getModel() * glm::scale(glm::vec3(16.f, 16.f, 1.f)) * te::getIntersection(unitBB, translatedBB));
-    //                }
-    //            }
-    //        }
-    //    }
-    //}
+    bool TiledMap::checkCollision(const BoundingBox& worldBB) const
+    {
+        BoundingBox unitBB = toUnit(worldBB);
+        return std::any_of(std::begin(mCollisionGrids), std::end(mCollisionGrids), [&unitBB](const TileCollisionGrid& grid) {
+            return grid.checkCollision(unitBB);
+        });
+    }
+
+    bool TiledMap::checkCollision(const BoundingBox& worldBB, unsigned layerIndex) const
+    {
+        return getCollisionGrid(layerIndex).checkCollision(toUnit(worldBB));
+    }
+
+    std::vector<BoundingBox>& TiledMap::getIntersections(const BoundingBox& worldBB, std::vector<BoundingBox>& bbs) const
+    {
+        std::size_t first = bbs.size();
+        BoundingBox unitBB = toUnit(worldBB);
+        std::for_each(std::begin(mCollisionGrids), std::end(mCollisionGrids), [&](const TileCollisionGrid& grid) {
+            grid.getIntersections(unitBB, bbs);
+        });
+        std::transform(std::begin(bbs) + first, std::end(bbs), std::begin(bbs) + first, [this](const BoundingBox& bb) {
+            return toWorld(bb);
+        });
+        return bbs;
+    }
+
+    std::vector<BoundingBox>& TiledMap::getIntersections(const BoundingBox& worldBB, unsigned layerIndex, std::vector<BoundingBox>& bbs) const
+    {
+        std::size_t first = bbs.size();
+        getCollisionGrid(layerIndex).getIntersections(toUnit(worldBB), bbs);
+        std::transform(std::begin(bbs) + first, std::end(bbs), std::begin(bbs) + first, [this](const BoundingBox& bb) {
+            return toWorld(bb);
+        });
+        return bbs;
+    }
+
+    TileSweep TiledMap::sweep(const BoundingBox& worldBB, const glm::vec2& displacement) const
+    {
+        // Fractions of the displacement are the same in tile units.
+        BoundingBox unitBB = toUnit(worldBB);
+        glm::vec2 unitDisplacement(mUnitMatrix * glm::vec4(displacement, 0.f, 0.f));
+
+        TileSweep result{ false, 1.f, glm::vec2(0.f) };
+        std::for_each(std::begin(mCollisionGrids), std::end(mCollisionGrids), [&](const TileCollisionGrid& grid) {
+            TileSweep layerResult = grid.sweep(unitBB, unitDisplacement);
+            if (layerResult.hit && (!result.hit || layerResult.time < result.time)) {
+                result = layerResult;
+            }
+        });
+
+        // Normals go back to world space by the transpose.
+        if (result.hit) {
+            result.normal = glm::normalize(glm::vec2(glm::transpose(mUnitMatrix) * glm::vec4(result.normal, 0.f, 0.f)));
+        }
+        return result;
+    }
 
     void* TiledMap::operator new(std::size_t sz)
     {
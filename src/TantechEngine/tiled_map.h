@@ -2,6 +2,7 @@
 #define TE_TILED_MAP_H
 
 #include "tmx.h"
+#include "tile_collision_grid.h"
 
 #include "gl.h"
 #include <glm/glm.hpp>
@@ -14,25 +15,37 @@
 namespace te
 {
     class TextureManager;
-    struct BoundingBox;
     class Mesh;
     class Model;
     class Shader;
+    class TileIndexRenderer;
 
     class TiledMap {
     public:
-        TiledMap(const std::string& path, const std::string& file, std::shared_ptr<const Shader> pShader, const glm::mat4& model, TextureManager* tm = nullptr);
-        TiledMap(std::shared_ptr<const TMX> pTMX, std::shared_ptr<const Shader> pShader, const glm::mat4& model, TextureManager* tm = nullptr);
+        // MESH builds a quad per tile; TILE_INDEX keeps the gids of each
+        // layer in a texture and draws a layer in one quad per tileset.
+        enum class RenderMode
+        { MESH, TILE_INDEX };
+
+        TiledMap(const std::string& path, const std::string& file, std::shared_ptr<const Shader> pShader, const glm::mat4& model, TextureManager* tm = nullptr, RenderMode mode = RenderMode::MESH);
+        TiledMap(std::shared_ptr<const TMX> pTMX, std::shared_ptr<const Shader> pShader, const glm::mat4& model, TextureManager* tm = nullptr, RenderMode mode = RenderMode::MESH);
         ~TiledMap();
         TiledMap(TiledMap&&);
         TiledMap& operator=(TiledMap&&);
 
         void draw(const glm::mat4& viewTransform = glm::mat4()) const;
 
+        // Replaces a tile for drawing and collision. Only TILE_INDEX maps can
+        // be edited, since a mesh would have to be rebuilt.
+        void setTile(unsigned layerIndex, unsigned x, unsigned y, unsigned gid);
+
         bool checkCollision(const BoundingBox&) const;
         bool checkCollision(const BoundingBox&, unsigned layerIndex) const;
         std::vector<BoundingBox>& getIntersections(const BoundingBox&, std::vector<BoundingBox>& intersections) const;
         std::vector<BoundingBox>& getIntersections(const BoundingBox&, unsigned layerIndex, std::vector<BoundingBox>& intersections) const;
+        // Moves a world space box by a world space displacement through every
+        // tile layer. The normal is in world space.
+        TileSweep sweep(const BoundingBox& worldBB, const glm::vec2& displacement) const;
 
         static void* operator new(std::size_t);
         static void operator delete(void*);
@@ -42,14 +55,21 @@ namespace te
 
         void init(const TMX& tmx, TextureManager* tm);
         void destroy();
-        bool checkUnitCollision(const BoundingBox& unitBB, const TMX::Layer& layer) const;
-        void getUnitIntersections(const BoundingBox& unitBB, const TMX::Layer& layer, std::vector<BoundingBox>& intersections) const;
+        BoundingBox toUnit(const BoundingBox& worldBB) const;
+        BoundingBox toWorld(const BoundingBox& unitBB) const;
+        const TileCollisionGrid& getCollisionGrid(unsigned layerIndex) const;
 
         glm::mat4 mModelMatrix;
         std::shared_ptr<const Shader> mpShader;
         std::shared_ptr<const TMX> mpTMX;
         std::vector<Model> mLayers;
-        std::map<unsigned, const BoundingBox> mCollisionRects;
+        RenderMode mRenderMode;
+        std::unique_ptr<TileIndexRenderer> mpTileIndexRenderer;
+        // From world space to tile units.
+        glm::mat4 mUnitMatrix;
+        std::map<unsigned, BoundingBox> mCollisionRects;
+        // One per layer, empty for object layers.
+        std::vector<TileCollisionGrid> mCollisionGrids;
     };
 }
 
@@ -5,7 +5,10 @@ namespace te
 {
     TransformComponent::TransformComponent(std::vector<std::shared_ptr<Observer<TransformUpdateEvent>>>&& observers, std::size_t capacity)
         : Component(capacity)
-        , Notifier(std::move(observers)) {}
+        , Notifier(std::move(observers))
+        , mHierarchyChanged(false)
+        , mHasDirty(false)
+        , mEvents() {}
 
     static TransformInstance createTransformInstance(const Entity& entity)
     {
@@ -15,17 +18,41 @@ namespace te
             entity,
             entity,
             entity,
-            entity
+            entity,
+            0,
+            false
         };
     }
 
     void TransformComponent::setParent(const Entity& child, const Entity& parent)
     {
         if (!hasInstance(child)) { createInstance(child, createTransformInstance(child)); }
+        if (!hasInstance(parent)) { createInstance(parent, createTransformInstance(parent)); }
+        for (Entity ancestor = parent; ancestor != child; ancestor = at(ancestor).parent)
+        {
+            if (at(ancestor).parent == ancestor) { break; }
+            if (at(ancestor).parent == child)
+            {
+                throw std::runtime_error("TransformComponent::setParent: Parent is a descendant of child.");
+            }
+        }
+
+        unlink(child);
         TransformInstance& childInstance = at(child);
-        childInstance.parent = parent;
-        glm::mat4 parentTransform = at(parent).world;
-        transformTree(childInstance, parentTransform);
+        if (parent != child)
+        {
+            TransformInstance& parentInstance = at(parent);
+            childInstance.parent = parent;
+            if (parentInstance.firstChild != parent)
+            {
+                childInstance.nextSibling = parentInstance.firstChild;
+                at(parentInstance.firstChild).prevSibling = child;
+            }
+            parentInstance.firstChild = child;
+        }
+        setDepth(child, parent != child ? at(parent).depth + 1 : 0);
+        markDirty(childInstance);
+        mHierarchyChanged = true;
     }
 
     glm::mat4 TransformComponent::setLocalTransform(const Entity& entity, const glm::mat4& transform)
@@ -33,12 +60,7 @@ namespace te
         if (!hasInstance(entity)) { createInstance(entity, createTransformInstance(entity)); }
         TransformInstance& instance = at(entity);
         instance.local = transform;
-        glm::mat4 parentTransform =
-            instance.parent != entity ?
-            at(instance.parent).world :
-            glm::mat4();
-        transformTree(instance, parentTransform);
-        notify({ entity, instance.world });
+        markDirty(instance);
         return instance.local;
     }
 
@@ -47,28 +69,69 @@ namespace te
         if (!hasInstance(entity)) { createInstance(entity, createTransformInstance(entity)); }
         TransformInstance& instance = at(entity);
 
-        glm::mat4 parentTransform =
-            instance.parent != entity ?
-            at(instance.parent).world :
-            glm::mat4();
-
         switch (relativeTo)
         {
         case Space::SELF:
             instance.local *= transform;
             break;
         case Space::WORLD:
+        {
+            // The parent may have moved since the last update.
+            glm::mat4 parentTransform =
+                instance.parent != entity ?
+                computeWorldTransform(instance.parent) :
+                glm::mat4();
             instance.local = (glm::inverse(parentTransform) * transform) * instance.local;
             break;
+        }
         default:
             throw std::runtime_error("TransformComponent::multiplyTransform: Invalid space.");
         }
 
-        transformTree(instance, parentTransform);
-        notify({ entity, instance.world });
+        markDirty(instance);
         return instance.local;
     }
 
+    void TransformComponent::updateWorldTransforms()
+    {
+        if (mHierarchyChanged)
+        {
+            sortInstances([](const TransformInstance& lhs, const TransformInstance& rhs)
+            {
+                return lhs.depth < rhs.depth;
+            });
+            mHierarchyChanged = false;
+        }
+        if (!mHasDirty) { return; }
+        mHasDirty = false;
+
+        // Sorted by depth, so a parent is final before its children are
+        // reached.
+        forEach([this](const Entity& entity, TransformInstance& instance)
+        {
+            if (!instance.dirty) { return; }
+            instance.dirty = false;
+            instance.world =
+                instance.parent != entity ?
+                at(instance.parent).world * instance.local :
+                instance.local;
+
+            for (Entity child = instance.firstChild; child != entity;)
+            {
+                TransformInstance& childInstance = at(child);
+                childInstance.dirty = true;
+                child = childInstance.nextSibling != child ? childInstance.nextSibling : entity;
+            }
+            mEvents.push_back({ entity, instance.world });
+        });
+
+        for (const TransformUpdateEvent& evt : mEvents)
+        {
+            notify(evt);
+        }
+        mEvents.clear();
+    }
+
     glm::mat4 TransformComponent::getWorldTransform(const Entity& entity) const
     {
         if (hasInstance(entity))
@@ -93,22 +156,76 @@ namespace te
         }
     }
 
-    void TransformComponent::transformTree(TransformInstance& instance, const glm::mat4& parentTransform)
+    void TransformComponent::destroyInstance(const Entity& entity)
     {
-        instance.world = parentTransform * instance.local;
+        if (!hasInstance(entity)) { return; }
 
-        TransformInstance& childInstance = at(instance.firstChild);
-        while (&instance != &childInstance)
+        // Children are left in place as roots.
+        unlink(entity);
+        for (Entity child = at(entity).firstChild; child != entity;)
         {
-            transformTree(childInstance, instance.world);
-            if (&at(childInstance.nextSibling) != &childInstance)
-            {
-                childInstance = at(childInstance.nextSibling);
-            }
-            else
-            {
-                childInstance = instance;
-            }
+            TransformInstance& childInstance = at(child);
+            Entity next = childInstance.nextSibling != child ? childInstance.nextSibling : entity;
+            childInstance.local = childInstance.world;
+            childInstance.parent = child;
+            childInstance.nextSibling = child;
+            childInstance.prevSibling = child;
+            setDepth(child, 0);
+            markDirty(childInstance);
+            child = next;
+        }
+        Component::destroyInstance(entity);
+        mHierarchyChanged = true;
+    }
+
+    void TransformComponent::markDirty(TransformInstance& instance)
+    {
+        instance.dirty = true;
+        mHasDirty = true;
+    }
+
+    void TransformComponent::unlink(const Entity& entity)
+    {
+        TransformInstance& instance = at(entity);
+        if (instance.parent == entity) { return; }
+
+        if (instance.prevSibling != entity)
+        {
+            at(instance.prevSibling).nextSibling =
+                instance.nextSibling != entity ? instance.nextSibling : instance.prevSibling;
         }
+        else
+        {
+            at(instance.parent).firstChild =
+                instance.nextSibling != entity ? instance.nextSibling : instance.parent;
+        }
+        if (instance.nextSibling != entity)
+        {
+            at(instance.nextSibling).prevSibling =
+                instance.prevSibling != entity ? instance.prevSibling : instance.nextSibling;
+        }
+        instance.parent = entity;
+        instance.nextSibling = entity;
+        instance.prevSibling = entity;
+    }
+
+    void TransformComponent::setDepth(const Entity& entity, unsigned depth)
+    {
+        TransformInstance& instance = at(entity);
+        instance.depth = depth;
+        for (Entity child = instance.firstChild; child != entity;)
+        {
+            setDepth(child, depth + 1);
+            const TransformInstance& childInstance = at(child);
+            child = childInstance.nextSibling != child ? childInstance.nextSibling : entity;
+        }
+    }
+
+    glm::mat4 TransformComponent::computeWorldTransform(const Entity& entity) const
+    {
+        const TransformInstance& instance = at(entity);
+        return instance.parent != entity ?
+            computeWorldTransform(instance.parent) * instance.local :
+            instance.local;
     }
 }
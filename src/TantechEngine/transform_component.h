@@ -4,6 +4,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <vector>
 #include <glm/glm.hpp>
 #include "entity_manager.h"
 #include "component.h"
@@ -18,6 +19,8 @@ namespace te
         Entity firstChild;
         Entity nextSibling;
         Entity prevSibling;
+        unsigned depth;
+        bool dirty;
     };
 
     struct TransformUpdateEvent
@@ -26,6 +29,9 @@ namespace te
         const glm::mat4 worldTransform;
     };
 
+    // Setting a local transform only marks the instance dirty. World
+    // transforms, and the TransformUpdateEvents for them, are brought up to
+    // date once per frame by updateWorldTransforms.
     class TransformComponent : public Component<TransformInstance>,
                                public Notifier<TransformUpdateEvent>
     {
@@ -36,19 +42,36 @@ namespace te
         TransformComponent(std::vector<std::shared_ptr<Observer<TransformUpdateEvent>>>&& observers = {},
                            std::size_t capacity = 1024);
 
+        // A child whose parent is itself is detached.
         void setParent(const Entity& child, const Entity& parent);
 
         glm::mat4 setLocalTransform(const Entity& entity, const glm::mat4& transform);
         glm::mat4 multiplyTransform(const Entity& entity, const glm::mat4& transform, Space relativeTo = Space::SELF);
 
+        // Recomputes the world transforms of dirty instances and their
+        // descendants, parents first, then notifies observers of each.
+        void updateWorldTransforms();
+
+        // As of the last updateWorldTransforms.
         glm::mat4 getWorldTransform(const Entity& entity) const;
         glm::mat4 getLocalTransform(const Entity& entity) const;
 
+    protected:
+        void destroyInstance(const Entity& entity);
+
     private:
         TransformComponent(const TransformComponent&) = delete;
         TransformComponent& operator=(const TransformComponent&) = delete;
 
-        void transformTree(TransformInstance& instance, const glm::mat4& parentTransform);
+        void markDirty(TransformInstance& instance);
+        void unlink(const Entity& entity);
+        void setDepth(const Entity& entity, unsigned depth);
+        glm::mat4 computeWorldTransform(const Entity& entity) const;
+
+        // Set when instances are no longer sorted by depth.
+        bool mHierarchyChanged;
+        bool mHasDirty;
+        std::vector<TransformUpdateEvent> mEvents;
     };
 
     typedef std::shared_ptr<TransformComponent> TransformPtr;
@@ -0,0 +1,130 @@
+#include <collision_system.h>
+#include <bounding_box_component.h>
+#include <transform_component.h>
+#include <entity_manager.h>
+#include <auxiliary.h>
+
+#include <gtest/gtest.h>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace te
+{
+    typedef std::pair<Entity, Entity> EntityPair;
+
+    static EntityPair makeOrderedPair(const Entity& a, const Entity& b)
+    {
+        return a < b ? EntityPair(a, b) : EntityPair(b, a);
+    }
+
+    class PairRecorder : public Observer<CollisionEvent>
+    {
+    public:
+        void onNotify(const CollisionEvent& evt) { pairs.push_back(makeOrderedPair(evt.a, evt.b)); }
+        std::vector<EntityPair> pairs;
+    };
+
+    struct CollisionScene
+    {
+        CollisionScene(unsigned count, float worldSize)
+            : em({}, count)
+            , pTransform(std::make_shared<TransformComponent>())
+            , pBoundingBox(std::make_shared<BoundingBoxComponent>(pTransform, count))
+            , pRecorder(std::make_shared<PairRecorder>())
+            , system(pBoundingBox, { pRecorder })
+        {
+            std::mt19937 rng(1);
+            std::uniform_real_distribution<float> position(0.f, worldSize);
+            std::uniform_real_distribution<float> size(0.5f, 2.f);
+            for (unsigned i = 0; i < count; ++i) {
+                Entity entity = em.create();
+                entities.push_back(entity);
+                pTransform->setLocalTransform(entity, glm::translate(glm::vec3(position(rng), position(rng), 0.f)));
+                pBoundingBox->setBoundingBox(entity, { size(rng), size(rng) }, { 0.f, 0.f });
+            }
+            pTransform->updateWorldTransforms();
+        }
+
+        // What CollisionSystem::update did before the broadphase: every box
+        // against every other, each pair seen from both sides.
+        std::vector<EntityPair> getAllPairs() const
+        {
+            std::vector<EntityPair> pairs;
+            for (const Entity& a : entities) {
+                for (const Entity& b : entities) {
+                    if (a != b && checkCollision(pBoundingBox->getBoundingBox(a), pBoundingBox->getBoundingBox(b))) {
+                        pairs.push_back(makeOrderedPair(a, b));
+                    }
+                }
+            }
+            return pairs;
+        }
+
+        EntityManager em;
+        std::shared_ptr<TransformComponent> pTransform;
+        std::shared_ptr<BoundingBoxComponent> pBoundingBox;
+        std::shared_ptr<PairRecorder> pRecorder;
+        CollisionSystem system;
+        std::vector<Entity> entities;
+    };
+
+    TEST(CollisionSystem, ReportsEachPairOnce) {
+        CollisionScene scene(500, 40.f);
+        scene.system.update(0.f);
+        std::vector<EntityPair> pairs = scene.pRecorder->pairs;
+        std::sort(pairs.begin(), pairs.end());
+        EXPECT_EQ(pairs.end(), std::adjacent_find(pairs.begin(), pairs.end()));
+
+        std::vector<EntityPair> expected = scene.getAllPairs();
+        std::sort(expected.begin(), expected.end());
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+        EXPECT_FALSE(expected.empty());
+        EXPECT_EQ(expected, pairs);
+    }
+
+    TEST(CollisionSystem, TouchingBoxesDoNotCollide) {
+        CollisionScene scene(0, 0.f);
+        Entity a = scene.em.create();
+        Entity b = scene.em.create();
+        scene.pBoundingBox->setBoundingBox(a, { 2.f, 2.f }, { 0.f, 0.f });
+        scene.pBoundingBox->setBoundingBox(b, { 2.f, 2.f }, { 2.f, 0.f });
+        scene.system.update(0.f);
+        EXPECT_TRUE(scene.pRecorder->pairs.empty());
+
+        scene.pBoundingBox->setBoundingBox(b, { 2.f, 2.f }, { 1.5f, 1.5f });
+        scene.system.update(0.f);
+        EXPECT_EQ(1u, scene.pRecorder->pairs.size());
+    }
+
+    // Run with --gtest_also_run_disabled_tests.
+    TEST(CollisionSystem, DISABLED_Benchmark) {
+        using Clock = std::chrono::steady_clock;
+        auto ms = [](Clock::duration d) {
+            return std::chrono::duration<double, std::milli>(d).count();
+        };
+        for (unsigned count : { 100u, 1000u, 5000u, 20000u }) {
+            // About as crowded at every size.
+            CollisionScene scene(count, 2.f * std::sqrt(float(count)));
+
+            auto start = Clock::now();
+            scene.system.update(0.f);
+            auto swept = Clock::now();
+            std::cout << count << " boxes, " << scene.pRecorder->pairs.size() << " pairs: "
+                << "sweep and prune " << ms(swept - start) << " ms";
+            // All pairs takes seconds past this.
+            if (count <= 5000) {
+                scene.getAllPairs();
+                std::cout << ", all pairs " << ms(Clock::now() - swept) << " ms";
+            }
+            std::cout << "\n";
+        }
+    }
+}
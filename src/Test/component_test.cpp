@@ -0,0 +1,123 @@
+#include <component.h>
+#include <entity_manager.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace te
+{
+    template <class Instance>
+    class TestComponent : public Component<Instance>
+    {
+    public:
+        TestComponent(std::size_t capacity = 1024) : Component<Instance>(capacity) {}
+
+        using Component<Instance>::createInstance;
+        using Component<Instance>::hasInstance;
+        using Component<Instance>::at;
+        using Component<Instance>::destroyInstance;
+    };
+
+    TEST(Component, CreateAndLookup) {
+        EntityManager em;
+        TestComponent<int> component;
+        Entity a = em.create();
+        Entity b = em.create();
+        component.createInstance(a, 1);
+        component.createInstance(b, 2);
+        EXPECT_TRUE(component.hasInstance(a));
+        EXPECT_EQ(1, component.at(a));
+        EXPECT_EQ(2, component.at(b));
+        EXPECT_THROW(component.createInstance(a, 3), std::runtime_error);
+        EXPECT_THROW(component.at(em.create()), std::out_of_range);
+    }
+
+    TEST(Component, DestroyKeepsOthers) {
+        EntityManager em;
+        TestComponent<int> component;
+        std::vector<Entity> entities;
+        for (int i = 0; i < 5; ++i) {
+            entities.push_back(em.create());
+            component.createInstance(entities.back(), int(i));
+        }
+        component.destroyInstance(entities[1]);
+        component.destroyInstance(entities[4]);
+        component.destroyInstance(entities[4]);
+        EXPECT_FALSE(component.hasInstance(entities[1]));
+        EXPECT_FALSE(component.hasInstance(entities[4]));
+        EXPECT_EQ(0, component.at(entities[0]));
+        EXPECT_EQ(2, component.at(entities[2]));
+        EXPECT_EQ(3, component.at(entities[3]));
+
+        int count = 0;
+        component.forEach([&count](const Entity&, int&) { ++count; });
+        EXPECT_EQ(3, count);
+    }
+
+    TEST(Component, RecycledEntity) {
+        auto pComponent = std::make_shared<TestComponent<int>>();
+        EntityManager em({ pComponent }, 1);
+        Entity old = em.create();
+        pComponent->createInstance(old, 1);
+        em.destroy(old);
+        EXPECT_FALSE(pComponent->hasInstance(old));
+
+        Entity recycled = em.create();
+        EXPECT_FALSE(pComponent->hasInstance(recycled));
+        pComponent->createInstance(recycled, 2);
+        EXPECT_FALSE(pComponent->hasInstance(old));
+        EXPECT_EQ(2, pComponent->at(recycled));
+        pComponent->destroyInstance(old);
+        EXPECT_TRUE(pComponent->hasInstance(recycled));
+    }
+
+    TEST(Component, MovesInstance) {
+        EntityManager em;
+        TestComponent<std::unique_ptr<int>> component;
+        Entity entity = em.create();
+        component.createInstance(entity, std::make_unique<int>(7));
+        EXPECT_EQ(7, *component.at(entity));
+    }
+
+    // Run with --gtest_also_run_disabled_tests.
+    TEST(Component, DISABLED_Benchmark) {
+        using Clock = std::chrono::steady_clock;
+        const unsigned count = 100000;
+        EntityManager em({}, count);
+        TestComponent<float> component(count);
+        std::vector<Entity> entities;
+        entities.reserve(count);
+        for (unsigned i = 0; i < count; ++i) {
+            entities.push_back(em.create());
+        }
+
+        auto start = Clock::now();
+        for (const Entity& entity : entities) {
+            component.createInstance(entity, 1.f);
+        }
+        auto created = Clock::now();
+        float sum = 0.f;
+        for (int pass = 0; pass < 10; ++pass) {
+            for (const Entity& entity : entities) {
+                sum += component.at(entity);
+            }
+        }
+        auto lookedUp = Clock::now();
+        for (unsigned i = 0; i < count; ++i) {
+            component.destroyInstance(entities[(i * 7919) % count]);
+        }
+        auto destroyed = Clock::now();
+        EXPECT_EQ(10.f * count, sum);
+
+        auto ns = [](Clock::duration d) {
+            return std::chrono::duration<double, std::nano>(d).count();
+        };
+        std::cout << "create " << ns(created - start) / count << " ns, "
+            << "at " << ns(lookedUp - created) / (10.0 * count) << " ns, "
+            << "destroy " << ns(destroyed - lookedUp) / count << " ns per entity\n";
+    }
+}
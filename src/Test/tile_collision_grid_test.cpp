@@ -0,0 +1,171 @@
+#include <tile_collision_grid.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace te
+{
+    static const std::map<unsigned, BoundingBox> CollisionRects{
+        { 1, { 0.f, 0.f, 1.f, 1.f } },
+        { 2, { 0.f, 0.5f, 1.f, 0.5f } }
+    };
+
+    // '#' is a full tile, '_' the bottom half of one, anything else empty.
+    static TileCollisionGrid makeGrid(const std::vector<std::string>& rows)
+    {
+        TMX::Layer layer{};
+        layer.type = TMX::Layer::Type::TILELAYER;
+        layer.width = rows.front().size();
+        layer.height = rows.size();
+        for (const std::string& row : rows) {
+            for (char c : row) {
+                layer.data.push_back(c == '#' ? 1 : c == '_' ? 2 : c == '.' ? 0 : 3);
+            }
+        }
+        return TileCollisionGrid(layer, CollisionRects);
+    }
+
+    TEST(TileCollisionGrid, BuildsFromLayer) {
+        TileCollisionGrid grid = makeGrid({
+            "#.x",
+            "._#"
+        });
+        EXPECT_TRUE(grid.isSolid(0, 0));
+        EXPECT_FALSE(grid.isSolid(1, 0));
+        // A tile without a collision rect.
+        EXPECT_FALSE(grid.isSolid(2, 0));
+        EXPECT_TRUE(grid.isSolid(1, 1));
+        EXPECT_FALSE(grid.isSolid(-1, 0));
+        EXPECT_FALSE(grid.isSolid(0, 2));
+        EXPECT_FLOAT_EQ(1.5f, grid.getRect(1, 1).y);
+
+        EXPECT_TRUE(grid.checkCollision({ 0.5f, 0.5f, 0.2f, 0.2f }));
+        EXPECT_FALSE(grid.checkCollision({ 1.f, 1.f, 1.f, 0.5f }));
+        std::vector<BoundingBox> intersections;
+        grid.getIntersections({ 0.5f, 0.75f, 1.f, 1.f }, intersections);
+        EXPECT_EQ(2u, intersections.size());
+    }
+
+    TEST(TileCollisionGrid, SetTile) {
+        TileCollisionGrid grid = makeGrid({
+            "#.",
+            ".."
+        });
+        grid.setTile(1, 1, 2, CollisionRects);
+        EXPECT_TRUE(grid.isSolid(1, 1));
+        EXPECT_FLOAT_EQ(1.5f, grid.getRect(1, 1).y);
+        grid.setTile(0, 0, 0, CollisionRects);
+        EXPECT_FALSE(grid.isSolid(0, 0));
+        // A gid without a collision rect.
+        grid.setTile(1, 1, 3, CollisionRects);
+        EXPECT_FALSE(grid.isSolid(1, 1));
+        EXPECT_THROW(grid.setTile(2, 0, 1, CollisionRects), std::out_of_range);
+
+        TileSweep sweep = grid.sweep({ 0.f, 0.f, 0.5f, 0.5f }, { 1.f, 0.f });
+        EXPECT_FALSE(sweep.hit);
+        grid.setTile(1, 0, 1, CollisionRects);
+        sweep = grid.sweep({ 0.f, 0.f, 0.5f, 0.5f }, { 1.f, 0.f });
+        EXPECT_TRUE(sweep.hit);
+        EXPECT_FLOAT_EQ(0.5f, sweep.time);
+    }
+
+    TEST(TileCollisionGrid, LandsOnFloor) {
+        TileCollisionGrid grid = makeGrid({
+            "....",
+            "....",
+            "....",
+            "####"
+        });
+        TileSweep sweep = grid.sweep({ 1.f, 0.f, 1.f, 1.f }, { 0.f, 4.f });
+        EXPECT_TRUE(sweep.hit);
+        EXPECT_FLOAT_EQ(0.5f, sweep.time);
+        EXPECT_EQ(glm::vec2(0.f, -1.f), sweep.normal);
+
+        // Resting on the floor, sliding is free and falling is not.
+        sweep = grid.sweep({ 1.f, 2.f, 1.f, 1.f }, { 2.f, 0.f });
+        EXPECT_FALSE(sweep.hit);
+        EXPECT_FLOAT_EQ(1.f, sweep.time);
+        sweep = grid.sweep({ 1.f, 2.f, 1.f, 1.f }, { 1.f, 1.f });
+        EXPECT_TRUE(sweep.hit);
+        EXPECT_FLOAT_EQ(0.f, sweep.time);
+        EXPECT_EQ(glm::vec2(0.f, -1.f), sweep.normal);
+    }
+
+    TEST(TileCollisionGrid, HitsSubTileRect) {
+        TileCollisionGrid grid = makeGrid({
+            "..",
+            "._"
+        });
+        TileSweep sweep = grid.sweep({ 1.25f, 0.f, 0.5f, 0.5f }, { 0.f, 2.f });
+        EXPECT_TRUE(sweep.hit);
+        EXPECT_FLOAT_EQ(0.5f, sweep.time);
+
+        // Within the rect's own cell.
+        sweep = grid.sweep({ 1.25f, 1.f, 0.25f, 0.25f }, { 0.f, 1.f });
+        EXPECT_TRUE(sweep.hit);
+        EXPECT_FLOAT_EQ(0.25f, sweep.time);
+    }
+
+    TEST(TileCollisionGrid, DoesNotTunnel) {
+        TileCollisionGrid grid = makeGrid({
+            ".........#..........",
+            ".........#.........."
+        });
+        TileSweep sweep = grid.sweep({ 0.f, 0.f, 0.5f, 0.5f }, { 19.f, 1.f });
+        EXPECT_TRUE(sweep.hit);
+        EXPECT_FLOAT_EQ(8.5f / 19.f, sweep.time);
+        EXPECT_EQ(glm::vec2(-1.f, 0.f), sweep.normal);
+
+        sweep = grid.sweep({ 19.5f, 1.f, 0.5f, 0.5f }, { -19.5f, -1.f });
+        EXPECT_TRUE(sweep.hit);
+        EXPECT_FLOAT_EQ(9.5f / 19.5f, sweep.time);
+        EXPECT_EQ(glm::vec2(1.f, 0.f), sweep.normal);
+    }
+
+    TEST(TileCollisionGrid, FirstHitAcrossCorner) {
+        TileCollisionGrid grid = makeGrid({
+            "...",
+            "..#",
+            "###"
+        });
+        // Reaches the wall's left face before the floor below it.
+        TileSweep sweep = grid.sweep({ 0.5f, 0.5f, 1.f, 1.f }, { 2.f, 1.f });
+        EXPECT_TRUE(sweep.hit);
+        EXPECT_FLOAT_EQ(0.25f, sweep.time);
+        EXPECT_EQ(glm::vec2(-1.f, 0.f), sweep.normal);
+
+        // Into the wall and the floor at once: land on the floor.
+        sweep = grid.sweep({ 0.f, 0.f, 1.f, 1.f }, { 2.f, 2.f });
+        EXPECT_TRUE(sweep.hit);
+        EXPECT_FLOAT_EQ(0.5f, sweep.time);
+        EXPECT_EQ(glm::vec2(0.f, -1.f), sweep.normal);
+
+        // Exactly onto a corner.
+        grid = makeGrid({
+            "...",
+            "...",
+            "..#"
+        });
+        sweep = grid.sweep({ 0.f, 0.f, 0.5f, 0.5f }, { 2.f, 2.f });
+        EXPECT_TRUE(sweep.hit);
+        EXPECT_FLOAT_EQ(0.75f, sweep.time);
+        EXPECT_EQ(glm::vec2(0.f, -1.f), sweep.normal);
+    }
+
+    TEST(TileCollisionGrid, LeavesOverlappedRect) {
+        TileCollisionGrid grid = makeGrid({
+            "#.."
+        });
+        TileSweep sweep = grid.sweep({ 0.5f, 0.f, 1.f, 1.f }, { 1.f, 0.f });
+        EXPECT_FALSE(sweep.hit);
+
+        // Moving in from outside the grid.
+        sweep = grid.sweep({ -3.f, 0.f, 1.f, 1.f }, { 4.f, 0.f });
+        EXPECT_TRUE(sweep.hit);
+        EXPECT_FLOAT_EQ(0.5f, sweep.time);
+    }
+}
@@ -0,0 +1,115 @@
+#include <transform_component.h>
+#include <entity_manager.h>
+
+#include <gtest/gtest.h>
+#include <glm/gtx/transform.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace te
+{
+    class CountingObserver : public Observer<TransformUpdateEvent>
+    {
+    public:
+        void onNotify(const TransformUpdateEvent& evt) { ++count; }
+        int count = 0;
+    };
+
+    static glm::vec3 getPosition(const TransformComponent& transform, const Entity& entity)
+    {
+        return glm::vec3(transform.getWorldTransform(entity)[3]);
+    }
+
+    TEST(TransformComponent, ParentMovesChildren) {
+        auto pObserver = std::make_shared<CountingObserver>();
+        TransformComponent transform({ pObserver });
+        EntityManager em;
+        Entity parent = em.create();
+        std::vector<Entity> children;
+        for (int i = 0; i < 10; ++i) {
+            children.push_back(em.create());
+            transform.setParent(children.back(), parent);
+            transform.setLocalTransform(children.back(), glm::translate(glm::vec3(float(i), 0.f, 0.f)));
+        }
+        transform.setLocalTransform(parent, glm::translate(glm::vec3(0.f, 5.f, 0.f)));
+        transform.updateWorldTransforms();
+        EXPECT_EQ(11, pObserver->count);
+        EXPECT_EQ(glm::vec3(3.f, 5.f, 0.f), getPosition(transform, children[3]));
+
+        transform.multiplyTransform(parent, glm::translate(glm::vec3(1.f, 0.f, 0.f)));
+        EXPECT_EQ(glm::vec3(3.f, 5.f, 0.f), getPosition(transform, children[3]));
+        transform.updateWorldTransforms();
+        EXPECT_EQ(22, pObserver->count);
+        EXPECT_EQ(glm::vec3(4.f, 5.f, 0.f), getPosition(transform, children[3]));
+
+        transform.updateWorldTransforms();
+        EXPECT_EQ(22, pObserver->count);
+    }
+
+    TEST(TransformComponent, OnlyDirtySubtreeUpdates) {
+        auto pObserver = std::make_shared<CountingObserver>();
+        TransformComponent transform({ pObserver });
+        EntityManager em;
+        Entity a = em.create();
+        Entity b = em.create();
+        Entity grandchild = em.create();
+        // Parented before its parent exists, so storage must be reordered.
+        transform.setParent(grandchild, b);
+        transform.setParent(b, a);
+        transform.setLocalTransform(a, glm::translate(glm::vec3(1.f, 0.f, 0.f)));
+        transform.setLocalTransform(b, glm::translate(glm::vec3(0.f, 1.f, 0.f)));
+        transform.setLocalTransform(grandchild, glm::translate(glm::vec3(0.f, 0.f, 1.f)));
+        transform.updateWorldTransforms();
+        EXPECT_EQ(glm::vec3(1.f, 1.f, 1.f), getPosition(transform, grandchild));
+
+        pObserver->count = 0;
+        transform.setLocalTransform(b, glm::translate(glm::vec3(0.f, 2.f, 0.f)));
+        transform.updateWorldTransforms();
+        EXPECT_EQ(2, pObserver->count);
+        EXPECT_EQ(glm::vec3(1.f, 2.f, 1.f), getPosition(transform, grandchild));
+    }
+
+    TEST(TransformComponent, Reparent) {
+        TransformComponent transform;
+        EntityManager em;
+        Entity a = em.create();
+        Entity b = em.create();
+        Entity child = em.create();
+        transform.setLocalTransform(a, glm::translate(glm::vec3(1.f, 0.f, 0.f)));
+        transform.setLocalTransform(b, glm::translate(glm::vec3(2.f, 0.f, 0.f)));
+        transform.setParent(child, a);
+        transform.setParent(child, b);
+        transform.updateWorldTransforms();
+        EXPECT_EQ(glm::vec3(2.f, 0.f, 0.f), getPosition(transform, child));
+
+        transform.setLocalTransform(a, glm::translate(glm::vec3(3.f, 0.f, 0.f)));
+        transform.updateWorldTransforms();
+        EXPECT_EQ(glm::vec3(2.f, 0.f, 0.f), getPosition(transform, child));
+
+        transform.setParent(child, child);
+        transform.updateWorldTransforms();
+        EXPECT_EQ(glm::vec3(0.f, 0.f, 0.f), getPosition(transform, child));
+
+        transform.setParent(b, a);
+        EXPECT_THROW(transform.setParent(a, b), std::runtime_error);
+    }
+
+    TEST(TransformComponent, DestroyedParentLeavesChildInPlace) {
+        auto pTransform = std::make_shared<TransformComponent>();
+        EntityManager em({ pTransform });
+        Entity parent = em.create();
+        Entity child = em.create();
+        pTransform->setParent(child, parent);
+        pTransform->setLocalTransform(parent, glm::translate(glm::vec3(1.f, 0.f, 0.f)));
+        pTransform->setLocalTransform(child, glm::translate(glm::vec3(1.f, 0.f, 0.f)));
+        pTransform->updateWorldTransforms();
+
+        em.destroy(parent);
+        pTransform->updateWorldTransforms();
+        EXPECT_EQ(glm::vec3(2.f, 0.f, 0.f), getPosition(*pTransform, child));
+        pTransform->multiplyTransform(child, glm::translate(glm::vec3(1.f, 0.f, 0.f)), TransformComponent::Space::WORLD);
+        pTransform->updateWorldTransforms();
+        EXPECT_EQ(glm::vec3(3.f, 0.f, 0.f), getPosition(*pTransform, child));
+    }
+}